@@ -0,0 +1,90 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Bump allocator for data that lives and dies together, like the nodes of a
+// syntax tree. Objects are carved out of large blocks and all of them are
+// released at once by reset() or the destructor. Nothing placed in an arena
+// is destroyed individually, so only trivially destructible types fit.
+class Arena {
+public:
+    // Fixed size array placed in an arena.
+    template <typename T>
+    struct Array {
+        T *data = nullptr;
+        size_t count = 0;
+
+        size_t size() const { return count; }
+        bool empty() const { return count == 0; }
+        T* begin() const { return data; }
+        T* end() const { return data + count; }
+        T& operator[](const size_t &i) const { return data[i]; }
+    };
+
+    static constexpr size_t block_size = 64 * 1024;
+
+    Arena();
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    template <typename T, typename... Args>
+    T* make(Args&&... args) {
+        static_assert(std::is_trivially_destructible<T>::value, "Arena objects are never destroyed.");
+        ++objects;
+        return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+
+    template <typename T>
+    const Array<T> copy(const T *first, const size_t &count) {
+        static_assert(std::is_trivially_copyable<T>::value, "Arena arrays are copied bytewise.");
+        Array<T> array;
+        if (count == 0) return array;
+        array.data = static_cast<T*>(allocate(sizeof(T) * count, alignof(T)));
+        array.count = count;
+        std::memcpy(array.data, first, sizeof(T) * count);
+        return array;
+    }
+
+    const std::string_view copy(const std::string_view &text);
+
+    void reset();
+    // Takes over the blocks of 'other', which is left empty. Objects keep
+    // their addresses, allocation carries on in this arena's current block.
+    void adopt(Arena &other);
+
+    const size_t& get_objects() const;
+    const size_t& get_bytes() const;
+    const size_t get_blocks() const;
+
+private:
+    void* allocate(const size_t &size, const size_t &align) {
+        size_t at = (used + align - 1) & ~(align - 1);
+        if (at + size > capacity) {
+            grow(size);
+            at = 0;
+        }
+        used = at + size;
+        bytes += size;
+        return blocks.back().get() + at;
+    }
+
+    void grow(const size_t &size);
+
+    // Every block comes from a single allocation aligned for any type.
+    std::vector<std::unique_ptr<char[]>> blocks;
+    size_t used;
+    size_t capacity;
+
+    size_t objects;
+    size_t bytes;
+};
\ No newline at end of file
@@ -6,6 +6,7 @@
 #include <string>
 
 #include <program/ir_generator.h>
+#include <program/peephole.h>
 #include <program/utils.h>
 
 class Compiler {
@@ -14,13 +15,15 @@ public:
     ~Compiler();
 
     const bool& get_success() const;
+    const Peephole& get_peephole() const;
 
 private:
     void compile(const IRGenerator &ir_generator);
 
-    void compile_instruction(const IRGenerator::Instruction *instruction);
+    void compile_instruction(const IRGenerator::Instruction &instruction);
 
     std::ofstream file_stream;
+    Peephole peephole;
 
     bool success;
 };
\ No newline at end of file
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include <program/lexer.h>
+#include <program/parser.h>
+#include <program/source.h>
+
+// Front end for a source that is edited in place, as by an editor or a watch
+// mode. Each edit relexes only the damaged token span and reparses only the
+// global statements it touches. After an edit fails to lex or parse, the
+// next one rebuilds everything, since the partial result cannot be trusted.
+class Document {
+public:
+    Document(const std::string &fp);
+
+    void edit(const size_t &offset, const size_t &removed, const std::string_view &text);
+
+    const Source& get_source() const;
+    const Lexer& get_lexer() const;
+    const Parser& get_parser() const;
+
+    const bool& get_success() const;
+    const bool& get_incremental() const;
+    const double& get_elapsed() const;
+
+    void log() const;
+
+private:
+    void rebuild();
+
+    Source source;
+    std::unique_ptr<Lexer> lexer;
+    std::unique_ptr<Parser> parser;
+
+    bool success;
+    bool incremental;
+    double elapsed;
+};
\ No newline at end of file
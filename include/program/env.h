@@ -47,7 +47,8 @@ private:
 public:
     static Env& get_instance();
 
-    void build();
+    // 'stats' is passed on to every object built.
+    void build(const bool &stats = false);
     void run();
 
     Object* request(const std::string &id);
@@ -57,6 +58,8 @@ public:
 private:
     Env();
     ~Env();
+
+    bool stats;
     Env(const Env&) = delete;
     Env& operator= (const Env&) = delete;
 };
\ No newline at end of file
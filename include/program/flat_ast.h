@@ -0,0 +1,213 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <program/arena.h>
+#include <program/parser.h>
+#include <program/source.h>
+
+// The syntax tree of a parser laid out as flat arrays. A node takes 8 bytes,
+// refers to other nodes by 32-bit index and keeps the rest of its fields in
+// the side table of its kind. Nodes are stored children first, so a node's
+// children always have lower indices and a bottom up pass is a single loop
+// over 'nodes'. Names and literals are copied into one text buffer owned by
+// the tree, which holds no pointers and does not depend on the parser. That
+// also makes it the on-disk cache format: save() writes the tables as they
+// are and loading copies them back out of a mapped file.
+class FlatAst {
+public:
+    using Index = uint32_t;
+
+    // Bumped whenever the tables or the file layout change.
+    static constexpr uint32_t format = 2;
+
+    struct Node {
+        Parser::Node::Kind kind;
+        // Value of a BooleanLiteral, access of a ClassMember, whether a
+        // VariableDeclaration is final.
+        uint8_t flag = 0;
+        // Entry in the side table of the kind. Nodes that only hold a name
+        // store the name, nodes that only hold a child store the child.
+        Index data = 0;
+    };
+
+    // Span of 'text'.
+    struct Name {
+        uint32_t offset;
+        uint32_t length;
+    };
+    // Span of 'lists'.
+    struct List {
+        Index first;
+        Index count;
+    };
+
+    struct Binary {
+        Index left;
+        Index op;
+        Index right;
+    };
+    struct Cast {
+        Index left;
+        Index type;
+    };
+    struct Unary {
+        Index op;
+        Index value;
+    };
+    struct Declaration {
+        Index type;
+        Index identifier;
+        Index expr;
+    };
+    struct Assignment {
+        Index identifier;
+        Index expr;
+    };
+    // Argument types and identifiers alternate in 'names' from 'args' on.
+    struct Function {
+        Index type;
+        Index identifier;
+        Index args;
+        Index count;
+        Index statement;
+    };
+    struct Call {
+        Index identifier;
+        List args;
+    };
+    struct Conditional {
+        Index condition;
+        Index pass;
+        Index fail;
+    };
+    struct Loop {
+        Index condition;
+        Index statement;
+    };
+    // Class declarations and modules.
+    struct Block {
+        Index identifier;
+        Index statement;
+    };
+
+    FlatAst(const Parser &parser);
+    // Loads a tree saved under 'key', fails if the cache holds another key
+    // or is damaged.
+    FlatAst(const Source &cache, const uint64_t &key);
+
+    // Key of the tree this compiler builds from 'text', a hash of the text,
+    // the compiler version and the format.
+    static const uint64_t get_key(const std::string_view &text, const std::string &version);
+
+    // Writes the tree to 'fp' through a temporary file, so readers never see
+    // a partial cache.
+    const bool save(const std::string &fp, const uint64_t &key) const;
+
+    const bool& get_success() const;
+
+    const std::vector<Node>& get_nodes() const;
+    const std::vector<Index>& get_roots() const;
+    const std::string_view get_name(const Index &i) const;
+    const size_t get_bytes() const;
+
+    // Calls 'f' with the index of every child of node 'i'.
+    template <typename F>
+    void for_each_child(const Index &i, const F &f) const {
+        const Node &node = nodes[i];
+        switch (node.kind) {
+            case Parser::Node::BINARY_OPERATION:
+                f(binaries[node.data].left);
+                f(binaries[node.data].right);
+                break;
+            case Parser::Node::CAST_OPERATION:
+                f(casts[node.data].left);
+                break;
+            case Parser::Node::UNARY_OPERATION:
+                f(unaries[node.data].value);
+                break;
+            case Parser::Node::VARIABLE_DECLARATION:
+                f(declarations[node.data].expr);
+                break;
+            case Parser::Node::VARIABLE_ASSIGNMENT:
+                f(assignments[node.data].expr);
+                break;
+            case Parser::Node::FUNCTION_DECLARATION:
+                f(functions[node.data].statement);
+                break;
+            case Parser::Node::RETURN_STATEMENT:
+            case Parser::Node::CLASS_MEMBER:
+                f(node.data);
+                break;
+            case Parser::Node::FUNCTION_CALL:
+                for (Index k = 0; k < calls[node.data].args.count; ++k) f(lists[calls[node.data].args.first + k]);
+                break;
+            case Parser::Node::CONDITIONAL_STATEMENT:
+                f(conditionals[node.data].condition);
+                f(conditionals[node.data].pass);
+                f(conditionals[node.data].fail);
+                break;
+            case Parser::Node::SCOPE_DECLARATION:
+                for (Index k = 0; k < scopes[node.data].count; ++k) f(lists[scopes[node.data].first + k]);
+                break;
+            case Parser::Node::WHILE_LOOP_STATEMENT:
+                f(loops[node.data].condition);
+                f(loops[node.data].statement);
+                break;
+            case Parser::Node::CLASS_DECLARATION:
+            case Parser::Node::MODULE:
+                f(blocks[node.data].statement);
+                break;
+            default:
+                break;
+        }
+    }
+
+    // Builds parser nodes for the tree in 'arena' and returns the global
+    // statements, so code written against Parser::Node keeps working. The
+    // nodes refer to this tree's text, which has to outlive them.
+    const std::vector<Parser::Node*> expand(Arena &arena) const;
+
+    void log() const;
+
+private:
+    const Index flatten(const Parser::Node *root);
+    const Index build(const Parser::Node *node);
+    const Index take();
+    const List collect(const size_t &base);
+    const Index add(const std::string_view &name);
+    const Index push(const Parser::Node::Kind &kind, const Index &data, const uint8_t &flag = 0);
+    const bool load(const std::string_view &raw, const uint64_t &key);
+    const bool validate() const;
+
+    std::vector<Node> nodes;
+    std::vector<Index> roots;
+
+    std::vector<Binary> binaries;
+    std::vector<Cast> casts;
+    std::vector<Unary> unaries;
+    std::vector<Declaration> declarations;
+    std::vector<Assignment> assignments;
+    std::vector<Function> functions;
+    std::vector<Call> calls;
+    std::vector<Conditional> conditionals;
+    std::vector<List> scopes;
+    std::vector<Loop> loops;
+    std::vector<Block> blocks;
+
+    std::vector<Index> lists;
+    std::vector<Name> names;
+    std::string text;
+
+    // Nodes flattened but not yet taken by their parent, see flatten().
+    std::vector<Index> pending;
+
+    bool success;
+};
\ No newline at end of file
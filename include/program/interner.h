@@ -0,0 +1,213 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+// Maps names to small integer ids. Keywords, boolean literals, operators and
+// punctuators are interned up front with the fixed ids below so the lexer and
+// parser can refer to them directly, identifiers get ids from DYNAMIC onwards.
+// Interned text is copied into storage owned by the interner and stays valid
+// for its lifetime.
+class Interner {
+public:
+    enum Symbol : uint32_t {
+        NONE,
+
+        KEYWORD_USE,
+        KEYWORD_MODULE,
+        KEYWORD_CLASS,
+        KEYWORD_CONSTRUCTOR,
+        KEYWORD_DESTRUCTOR,
+        KEYWORD_IF,
+        KEYWORD_ELSE,
+        KEYWORD_FOR,
+        KEYWORD_WHILE,
+        KEYWORD_RETURN,
+        KEYWORD_BREAK,
+        KEYWORD_CONTINUE,
+        KEYWORD_SECURE,
+        KEYWORD_LIMITED,
+        KEYWORD_OPEN,
+        KEYWORD_VIRTUAL,
+        KEYWORD_OVERRIDE,
+        KEYWORD_EXTENDS,
+        KEYWORD_PUBLIC,
+        KEYWORD_PRIVATE,
+        KEYWORD_STATIC,
+        KEYWORD_FINAL,
+        KEYWORD_PERSISTENT,
+        KEYWORD_NEW,
+        KEYWORD_DELETE,
+        KEYWORD_IN,
+        KEYWORD_AS,
+
+        LITERAL_TRUE,
+        LITERAL_FALSE,
+
+        OPERATOR_ASSIGN,
+        OPERATOR_NOT,
+        OPERATOR_ADD,
+        OPERATOR_ADD_ASSIGN,
+        OPERATOR_SUB,
+        OPERATOR_SUB_ASSIGN,
+        OPERATOR_MUL,
+        OPERATOR_MUL_ASSIGN,
+        OPERATOR_POW,
+        OPERATOR_POW_ASSIGN,
+        OPERATOR_DIV,
+        OPERATOR_DIV_ASSIGN,
+        OPERATOR_FLOOR_DIV,
+        OPERATOR_FLOOR_DIV_ASSIGN,
+        OPERATOR_MOD,
+        OPERATOR_MOD_ASSIGN,
+        OPERATOR_EQUAL,
+        OPERATOR_NOT_EQUAL,
+        OPERATOR_LESS,
+        OPERATOR_LESS_EQUAL,
+        OPERATOR_GREATER,
+        OPERATOR_GREATER_EQUAL,
+        OPERATOR_AND,
+        OPERATOR_AND_ASSIGN,
+        OPERATOR_OR,
+        OPERATOR_OR_ASSIGN,
+        OPERATOR_XOR,
+        OPERATOR_XOR_ASSIGN,
+        OPERATOR_SHL,
+        OPERATOR_SHL_ASSIGN,
+        OPERATOR_SHR,
+        OPERATOR_SHR_ASSIGN,
+        OPERATOR_LOGICAL_AND,
+        OPERATOR_LOGICAL_OR,
+        OPERATOR_COMPLEMENT,
+
+        PUNCTUATOR_SEMICOLON,
+        PUNCTUATOR_DOT,
+        PUNCTUATOR_COMMA,
+        PUNCTUATOR_LEFT_PAREN,
+        PUNCTUATOR_RIGHT_PAREN,
+        PUNCTUATOR_LEFT_BRACE,
+        PUNCTUATOR_RIGHT_BRACE,
+        PUNCTUATOR_LEFT_BRACKET,
+        PUNCTUATOR_RIGHT_BRACKET,
+
+        NAME_PROTECTED,
+
+        DYNAMIC,
+    };
+
+    // Names of the fixed symbols indexed by id, kept in the header so compares
+    // against them fold to constants.
+    static constexpr std::array<std::string_view, DYNAMIC> fixed = {
+        "",
+
+        "use",
+        "module",
+        "class",
+        "constructor",
+        "destructor",
+        "if",
+        "else",
+        "for",
+        "while",
+        "return",
+        "break",
+        "continue",
+        "secure",
+        "limited",
+        "open",
+        "virtual",
+        "override",
+        "extends",
+        "public",
+        "private",
+        "static",
+        "final",
+        "persistent",
+        "new",
+        "delete",
+        "in",
+        "as",
+
+        "true",
+        "false",
+
+        "=",
+        "!",
+        "+",
+        "+=",
+        "-",
+        "-=",
+        "*",
+        "*=",
+        "**",
+        "**=",
+        "/",
+        "/=",
+        "//",
+        "//=",
+        "%",
+        "%=",
+        "==",
+        "!=",
+        "<",
+        "<=",
+        ">",
+        ">=",
+        "&",
+        "&=",
+        "|",
+        "|=",
+        "^",
+        "^=",
+        "<<",
+        "<<=",
+        ">>",
+        ">>=",
+        "&&",
+        "||",
+        "~",
+
+        ";",
+        ".",
+        ",",
+        "(",
+        ")",
+        "{",
+        "}",
+        "[",
+        "]",
+
+        "protected",
+    };
+
+    Interner();
+
+    const uint32_t intern(const std::string_view &text);
+    const uint32_t find(const std::string_view &text) const;
+    const std::string_view get(const uint32_t &id) const;
+    const size_t size() const;
+
+private:
+    struct Slot {
+        uint32_t hash;
+        uint32_t id;
+    };
+
+    static const uint32_t hash(const std::string_view &text);
+
+    const size_t locate(const std::string_view &text, const uint32_t &h) const;
+    void insert(const uint32_t &h, const uint32_t &id);
+    void grow();
+    const char* store(const std::string_view &text);
+
+    // Open addressing, an id of NONE marks an empty slot.
+    std::vector<Slot> slots;
+    std::vector<std::string_view> names;
+
+    std::vector<std::unique_ptr<char[]>> blocks;
+    size_t block_used;
+    size_t block_size;
+};
\ No newline at end of file
@@ -1,14 +1,19 @@
 #pragma once
 
 #include <algorithm>
+#include <chrono>
 #include <iomanip>
 #include <iostream>
 #include <map>
 #include <memory>
 #include <string>
 #include <sstream>
+#include <unordered_map>
 #include <vector>
 
+#include <program/arena.h>
+#include <program/mir.h>
+#include <program/operand.h>
 #include <program/parser.h>
 
 class IRGenerator {
@@ -31,6 +36,9 @@ public:
         StackEntry();
         TypeInfo type;
         int offset;
+        // MIR slot of a local or argument, none for class members.
+        uint32_t slot;
+        bool is_final;
     };
     struct StackInfo {
         StackInfo();
@@ -40,7 +48,7 @@ public:
         StackEntry get(const std::string &id);
         int get_bottom();
         bool exists(const std::string &id);
-        void push(const std::string &id, const TypeInfo &type);
+        void push(const std::string &id, const TypeInfo &type, const uint32_t &slot = Mir::none, const bool &is_final = false);
     };
     struct Statement {
         Statement();
@@ -89,159 +97,223 @@ public:
         std::vector<std::unique_ptr<Declaration>> declarations;
         virtual void log() const override;
     };
+    // An opcode and up to two operands in NASM order, instructions with a
+    // single operand keep it in 'dst'. The structs deriving from it only name
+    // its constructors and add no members, so instructions are kept by value.
     struct Instruction : public Statement {
-        Instruction();
-        virtual void log() const override;
+        enum Opcode : uint8_t {
+            PUSH,
+            MOV,
+            MOVSX,
+            MOVSXD,
+            MOVZX,
+            LEA,
+            NEG,
+            NOT,
+            IMUL,
+            IDIV,
+            DIV,
+            CDQ,
+            CQO,
+            ADD,
+            SUB,
+            CMP,
+            SETE,
+            SETNE,
+            SETG,
+            SETGE,
+            SETL,
+            SETLE,
+            SETA,
+            SETAE,
+            SETB,
+            SETBE,
+            CMOVE,
+            CMOVNE,
+            XOR,
+            AND,
+            OR,
+            SHL,
+            SHR,
+            SAR,
+            LABEL,
+            JMP,
+            JE,
+            JNE,
+            JG,
+            JGE,
+            JL,
+            JLE,
+            JA,
+            JAE,
+            JB,
+            JBE,
+            LEAVE,
+            RET,
+            CALL,
+        };
+
+        Instruction(const Opcode &op, const Operand &dst = Operand(), const Operand &src = Operand());
+        const char* get_mnemonic() const;
+        void log() const override;
+
+        Opcode op;
+        Operand dst;
+        Operand src;
     };
     struct Entry : public Declaration {
         Entry();
         Entry(const std::string &id);
         std::string id;
-        StackInfo args_stack;
-        std::vector<std::unique_ptr<Instruction>> instructions;
+        std::vector<Instruction> instructions;
         virtual void log() const override;
     };
     struct Push : public Instruction {
-        Push();
-        Push(const std::string &src);
-        std::string src;
-        void log() const override;
+        Push(const Operand &src);
     };
     struct Mov : public Instruction {
-        Mov();
-        Mov(const std::string &dst, const std::string &src);
-        std::string dst, src;
-        void log() const override;
+        Mov(const Operand &dst, const Operand &src);
     };
     struct Movsx : public Instruction {
-        Movsx();
-        Movsx(const std::string &dst, const std::string &src);
-        std::string dst, src;
-        void log() const override;
+        Movsx(const Operand &dst, const Operand &src);
+    };
+    struct Movsxd : public Instruction {
+        Movsxd(const Operand &dst, const Operand &src);
+    };
+    struct Movzx : public Instruction {
+        Movzx(const Operand &dst, const Operand &src);
     };
     struct Lea : public Instruction {
-        Lea();
-        Lea(const std::string &dst, const std::string &src);
-        std::string dst, src;
-        void log() const override;
+        Lea(const Operand &dst, const Operand &src);
     };
     struct Neg : public Instruction {
-        Neg();
-        Neg(const std::string &dst);
-        std::string dst;
-        void log() const override;
+        Neg(const Operand &dst);
+    };
+    struct Not : public Instruction {
+        Not(const Operand &dst);
     };
     struct Imul : public Instruction {
-        Imul();
-        Imul(const std::string &dst, const std::string &src);
-        std::string dst, src;
-        void log() const override;
+        Imul(const Operand &dst, const Operand &src);
     };
     struct Idiv : public Instruction {
-        Idiv();
-        Idiv(const std::string &src);
-        std::string src;
-        void log() const override;
+        Idiv(const Operand &src);
+    };
+    struct Div : public Instruction {
+        Div(const Operand &src);
+    };
+    struct Cdq : public Instruction {
+        Cdq();
+    };
+    struct Cqo : public Instruction {
+        Cqo();
     };
     struct Add : public Instruction {
-        Add();
-        Add(const std::string &dst, const std::string &src);
-        std::string dst, src;
-        void log() const override;
+        Add(const Operand &dst, const Operand &src);
     };
     struct Sub : public Instruction {
-        Sub();
-        Sub(const std::string &dst, const std::string &src);
-        std::string dst, src;
-        void log() const override;
+        Sub(const Operand &dst, const Operand &src);
     };
     struct Cmp : public Instruction {
-        Cmp();
-        Cmp(const std::string &left, const std::string &right);
-        std::string left, right;
-        void log() const override;
+        Cmp(const Operand &left, const Operand &right);
     };
     struct Sete : public Instruction {
-        Sete();
-        Sete(const std::string &dst);
-        std::string dst;
-        void log() const override;
+        Sete(const Operand &dst);
     };
     struct Setne : public Instruction {
-        Setne();
-        Setne(const std::string &dst);
-        std::string dst;
-        void log() const override;
+        Setne(const Operand &dst);
     };
     struct Setg : public Instruction {
-        Setg();
-        Setg(const std::string &dst);
-        std::string dst;
-        void log() const override;
+        Setg(const Operand &dst);
     };
     struct Setge : public Instruction {
-        Setge();
-        Setge(const std::string &dst);
-        std::string dst;
-        void log() const override;
+        Setge(const Operand &dst);
     };
     struct Setl : public Instruction {
-        Setl();
-        Setl(const std::string &dst);
-        std::string dst;
-        void log() const override;
+        Setl(const Operand &dst);
     };
     struct Setle : public Instruction {
-        Setle();
-        Setle(const std::string &dst);
-        std::string dst;
-        void log() const override;
+        Setle(const Operand &dst);
+    };
+    struct Seta : public Instruction {
+        Seta(const Operand &dst);
+    };
+    struct Setae : public Instruction {
+        Setae(const Operand &dst);
+    };
+    struct Setb : public Instruction {
+        Setb(const Operand &dst);
+    };
+    struct Setbe : public Instruction {
+        Setbe(const Operand &dst);
     };
     struct Cmove : public Instruction {
-        Cmove();
-        Cmove(const std::string &dst, const std::string &src);
-        std::string dst, src;
-        void log() const override;
+        Cmove(const Operand &dst, const Operand &src);
+    };
+    struct Cmovne : public Instruction {
+        Cmovne(const Operand &dst, const Operand &src);
     };
     struct Xor : public Instruction {
-        Xor();
-        Xor(const std::string &dst, const std::string &src);
-        std::string dst, src;
-        void log() const override;
+        Xor(const Operand &dst, const Operand &src);
+    };
+    struct And : public Instruction {
+        And(const Operand &dst, const Operand &src);
+    };
+    struct Or : public Instruction {
+        Or(const Operand &dst, const Operand &src);
+    };
+    struct Shl : public Instruction {
+        Shl(const Operand &dst, const Operand &src);
+    };
+    struct Shr : public Instruction {
+        Shr(const Operand &dst, const Operand &src);
+    };
+    struct Sar : public Instruction {
+        Sar(const Operand &dst, const Operand &src);
     };
     struct Label : public Instruction {
-        Label(const std::string &id);
-        void log() const override;
-        std::string id;
+        Label(const Operand &id);
     };
     struct Jmp : public Instruction {
-        Jmp(const std::string &dst);
-        void log() const override;
-        std::string dst;
+        Jmp(const Operand &dst);
     };
     struct Je : public Instruction {
-        Je(const std::string &dst);
-        void log() const override;
-        std::string dst;
+        Je(const Operand &dst);
     };
     struct Jne : public Instruction {
-        Jne(const std::string &dst);
-        void log() const override;
-        std::string dst;
+        Jne(const Operand &dst);
+    };
+    struct Jg : public Instruction {
+        Jg(const Operand &dst);
+    };
+    struct Jge : public Instruction {
+        Jge(const Operand &dst);
+    };
+    struct Jl : public Instruction {
+        Jl(const Operand &dst);
+    };
+    struct Jle : public Instruction {
+        Jle(const Operand &dst);
+    };
+    struct Ja : public Instruction {
+        Ja(const Operand &dst);
+    };
+    struct Jae : public Instruction {
+        Jae(const Operand &dst);
+    };
+    struct Jb : public Instruction {
+        Jb(const Operand &dst);
+    };
+    struct Jbe : public Instruction {
+        Jbe(const Operand &dst);
     };
     struct Leave : public Instruction {
         Leave();
-        void log() const override;
     };
     struct Ret : public Instruction {
         Ret();
-        void log() const override;
     };
     struct Call : public Instruction {
-        Call();
-        Call(const std::string &id);
-        std::string id;
-        void log() const override;
+        Call(const Operand &id);
     };
 
     struct ClassInfo {
@@ -249,44 +321,93 @@ public:
 
         std::string id;
         StackInfo stack;
-        std::vector<std::unique_ptr<IRGenerator::Entry>> functions;
     };
 
-    IRGenerator(const Parser &parser);
+    // 'level' is the optimization level, see Utils::get_optimization().
+    IRGenerator(const Parser &parser, const int &level = 1);
+    // Generates from global statements that did not come from a parser,
+    // such as a tree loaded from the cache.
+    IRGenerator(const std::vector<Parser::Node*> &ast, const int &level = 1);
 
     const std::vector<std::string>& get_ext_libs() const;
     const Segment& get_data() const;
     const Segment& get_bss() const;
     const Segment& get_text() const;
-    const std::vector<std::unique_ptr<Declaration>>& get_labels() const;
+    const Mir& get_mir() const;
 
     const bool& get_success() const;
+    const double& get_elapsed() const;
+    const int& get_level() const;
     void log() const;
 
 private:
-    void generate_ir(const std::vector<std::unique_ptr<Parser::Node>> &ast);
+    // Types of the nodes of one expression, see get_type_info().
+    using TypeCache = std::unordered_map<const Parser::Node*, TypeInfo>;
+
+    // Operation of evaluate_expr() waiting for its operands. Each step of an
+    // operation either returns the next operand to evaluate, whose value the
+    // following step gets, or adds the operation and returns null.
+    struct ExprFrame {
+        const Parser::Node *expr;
+        int stage;
+        // Type and value of the left operand.
+        TypeInfo type;
+        uint32_t left;
+        uint32_t value;
+        // Slot and joining block of a short-circuit operation.
+        uint32_t slot;
+        uint32_t end;
+
+        explicit ExprFrame(const Parser::Node *expr);
+    };
+
+    void generate_ir(const std::vector<Parser::Node*> &ast);
 
     void evaluate_global_statement(const Parser::Node *statement);
     void evaluate_module(const Parser::Module *mod);
     void evaluate_function_declaration(const Parser::FunctionDeclaration *decl);
     void evaluate_class_declaration(const Parser::ClassDeclaration *decl);
 
-    void evaluate_wrapper_statement(const Parser::Node *statement, Entry *entry);
+    void evaluate_wrapper_statement(const Parser::Node *statement, Mir::Function &function, StackInfo &stack_info);
 
-    void evaluate_statement(const Parser::Node *statement, Entry *entry, StackInfo &stack_info);
-    void evaluate_class_statement(const Parser::Node *statement, Entry *declarator, ClassInfo *class_info);
-    void evaluate_function_call(const Parser::FunctionCall *call, Entry *entry, const std::string &target, StackInfo &stack_info);
-    void evaluate_while_statement(const Parser::WhileLoopStatement *statement, Entry *entry, StackInfo &stack_info);
-    void evaluate_conditional_statement(const Parser::ConditionalStatement *statement, Entry *entry, StackInfo &stack_info);
-    void evaluate_variable_declaration(const Parser::VariableDeclaration *decl, Entry *entry, StackInfo &stack_info);
-    void evaluate_variable_assignment(const Parser::VariableAssignment *assign, Entry *entry, StackInfo &stack_info);
+    void evaluate_statement(const Parser::Node *statement, Mir::Function &function, StackInfo &stack_info);
+    void evaluate_class_statement(const Parser::Node *statement, ClassInfo *class_info);
+    uint32_t evaluate_function_call(const Parser::FunctionCall *call, Mir::Function &function, StackInfo &stack_info);
+    void evaluate_while_statement(const Parser::WhileLoopStatement *statement, Mir::Function &function, StackInfo &stack_info);
+    void evaluate_conditional_statement(const Parser::ConditionalStatement *statement, Mir::Function &function, StackInfo &stack_info);
+    void evaluate_variable_declaration(const Parser::VariableDeclaration *decl, Mir::Function &function, StackInfo &stack_info);
+    void evaluate_variable_assignment(const Parser::VariableAssignment *assign, Mir::Function &function, StackInfo &stack_info);
 
-    void evaluate_expr(const Parser::Node *expr, Entry *entry, const std::string &target, StackInfo &stack_info);
-    void evaluate_unary_operation(const Parser::UnaryOperation *operation, Entry *entry, const std::string &target, StackInfo &stack_info);
-    void evaluate_binary_operation(const Parser::BinaryOperation *operation, Entry *entry, const std::string &target, StackInfo &stack_info);
-    void evaluate_cast_operation(const Parser::CastOperation *operation, Entry *entry, const std::string &target, StackInfo &stack_info);
+    uint32_t evaluate_expr(const Parser::Node *expr, Mir::Function &function, StackInfo &stack_info);
+    const Parser::Node *evaluate_unary_operation(ExprFrame &frame, const uint32_t &operand, Mir::Function &function, StackInfo &stack_info, TypeCache &types);
+    const Parser::Node *evaluate_binary_operation(ExprFrame &frame, const uint32_t &operand, Mir::Function &function, StackInfo &stack_info, TypeCache &types);
+    const Parser::Node *evaluate_cast_operation(ExprFrame &frame, const uint32_t &operand, Mir::Function &function, StackInfo &stack_info, TypeCache &types);
 
-    void evaluate_variable_call(const Parser::VariableCall *call, Entry *entry, const std::string &target, StackInfo &stack_info);
+    // Branches to 'pass' if 'condition' holds and to 'fail' if not.
+    void evaluate_condition(const Parser::Node *condition, const uint32_t &pass, const uint32_t &fail, Mir::Function &function, StackInfo &stack_info);
+    uint32_t evaluate_variable_call(const Parser::VariableCall *call, Mir::Function &function, StackInfo &stack_info);
+
+    // 'value' of type 'from' as a value of type 'to'.
+    uint32_t convert(Mir::Function &function, const uint32_t &value, const TypeInfo &from, const TypeInfo &to);
+    uint32_t add_constant(Mir::Function &function, const int64_t &value, const TypeInfo &type);
+    uint32_t add_string(Mir::Function &function, const std::string &value);
+    const std::string add_data(const std::string &value);
+
+    void lower_function(Mir::Function &function, Entry *entry);
+    void lower_instruction(const Mir::Function &function, const uint32_t &id, Entry *entry);
+    // Sets the flags for comparison 'inst'.
+    void compare(const Mir::Function &function, const Mir::Inst &inst, Entry *entry);
+    void lower_copies(const Mir::Function &function, const uint32_t &pred, const uint32_t &succ, Entry *entry);
+    void lower_exit(const Mir::Function &function, const uint32_t &block, const uint32_t &next, Entry *entry);
+    // 'value' as an operand, loading constants and addresses into 'scratch'
+    // when they can not be one.
+    Operand get_operand(const Mir::Function &function, const uint32_t &value, const Operand::Register &scratch, Entry *entry);
+    // 'value' in register 'reg', widened to 'size' bytes by its sign.
+    Operand load(const Mir::Function &function, const uint32_t &value, const Operand::Register &reg, const int &size, Entry *entry);
+    void move(const Operand &dst, const Operand &src, Entry *entry);
+    // Register instruction 'id' computes its value in: its own, unless an
+    // operand other than the first lives there, or else rax.
+    Operand::Register get_accumulator(const Mir::Function &function, const uint32_t &id) const;
 
     void push_unique(std::unique_ptr<Declaration> decl, Segment &target);
     void add_extern(const std::string &id);
@@ -295,12 +416,20 @@ private:
     const bool is_integral(const std::string &name);
 
     const TypeInfo get_type_info(const std::string &name);
-    const TypeInfo get_type_info(const Parser::Node *expr, Entry *entry, StackInfo &stack_info);
+    const TypeInfo get_type_info(const Parser::Node *expr, StackInfo &stack_info);
+    const TypeInfo& get_type_info(const Parser::Node *expr, StackInfo &stack_info, TypeCache &types);
+    const TypeInfo deduce_type_info(const Parser::Node *expr, StackInfo &stack_info, const TypeCache &types);
+    // Type both operands of a comparison are brought to.
+    const TypeInfo get_common_type(const TypeInfo &left, const TypeInfo &right);
     const std::string get_hash(const std::string &src, const std::string &prefix = "d") const;
     const bool match_type(const std::string &id, const std::initializer_list<std::string> &types) const;
 
-    std::string get_registry(const std::string &top_name, const int &size);
-    std::string get_word(const int &size);
+    Operand get_registry(const Operand::Register &reg, const int &size);
+    Operand get_registry(const Operand &reg, const int &size);
+    int64_t get_integer(const std::string_view &value);
+    // Label or address of 'id', whose text the generator keeps in 'symbols'.
+    Operand get_label(const std::string &id);
+    Operand get_address(const std::string &id);
     IntegralType get_integral_type(const std::string &name);
     int get_data_size(const std::string &name);
     int align_by(const int &src, const int &size);
@@ -311,10 +440,28 @@ private:
     Segment bss;
     Segment text;
 
-    std::vector<std::unique_ptr<Declaration>> labels;
+    Mir mir;
+    Arena symbols;
+    // Type the function being built returns, none for void functions.
+    TypeInfo return_type;
+    // Location of every value of the function being lowered and the label
+    // of every block.
+    std::vector<Operand> locations;
+    std::vector<Operand> labels;
+    // Comparisons lowered by the branch that ends their block instead of
+    // to a value.
+    std::vector<uint8_t> fused;
+    // Callee saved registers the function being lowered restores on return.
+    std::vector<Operand::Register> saved;
+    // Instructions the dead code pass removed from each function, in the
+    // order of 'mir.functions'.
+    std::vector<uint32_t> removed;
+
+    int level;
 
-    int cnd_ix;
-    int while_ix;
+    int label_ix;
+    int pow_ix;
 
     bool success;
+    double elapsed;
 };
\ No newline at end of file
@@ -1,22 +1,25 @@
 #pragma once
 
+#include <program/interner.h>
+#include <program/scanner.h>
 #include <program/source.h>
+#include <program/thread_pool.h>
 
-#include <cctype>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
 #include <fstream>
 #include <iostream>
+#include <memory>
 #include <sstream>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 
 class Lexer {
 public:
-    static const std::vector<std::string> keywords;
-    static const std::vector<std::string> operators;
-    static const std::vector<std::string> punctuators;
-
-    enum TokenCategory {
+    enum TokenCategory : uint8_t {
         PUNCTUATOR,
         KEYWORD,
         IDENTIFIER,
@@ -30,30 +33,122 @@ public:
         UNKNOWN,
     };
 
+    // A token assembled on demand from the token arrays, the value is a
+    // view into the lexed Source which has to outlive the Lexer.
     struct Token {
+        std::string_view value;
+        uint32_t offset = 0;
+        uint32_t symbol = Interner::NONE;
         TokenCategory category = TokenCategory::UNKNOWN;
-        size_t line;
-        std::string value = "";
         void log() const;
     };
 
+    // Tokens replaced by an edit: 'removed' tokens starting at index 'first'
+    // were replaced by 'inserted' new ones.
+    struct Splice {
+        size_t first = 0;
+        size_t removed = 0;
+        size_t inserted = 0;
+    };
+
+    static constexpr size_t default_window = 256;
+    static constexpr size_t parallel_threshold = 8 * 1024 * 1024;
+    static constexpr size_t parallel_chunk = 1024 * 1024;
+
+    // Lexes the whole source up front.
     Lexer(const Source &source);
+    // Lexes the whole source up front, splitting sources of at least
+    // 'parallel_threshold' bytes into chunks lexed on the pool.
+    Lexer(const Source &source, const ThreadPool &pool);
+    // Lexes on demand into a ring of 'window' tokens, rounded up to a power of
+    // two. Tokens are produced as they are asked for, and at least half the
+    // window behind the furthest token asked for stays readable.
+    Lexer(const Source &source, const size_t &window);
+
+    // Brings the tokens up to date after the source had 'removed' bytes at
+    // 'offset' replaced by 'inserted' new ones, relexing only the damaged span.
+    const Splice relex(const size_t &offset, const size_t &removed, const size_t &inserted);
+
+    const bool is_end(const size_t &i) const;
+    const bool is_streaming() const;
+    const size_t size() const;
+    const Token get(const size_t &i) const;
+    const std::string_view get_value(const size_t &i) const;
+
+    // The parser asks for these on every token, so they are kept inline.
+    const TokenCategory get_category(const size_t &i) const {
+        return fetch(i) ? categories[i & mask] : UNKNOWN;
+    }
+
+    const uint32_t get_symbol(const size_t &i) const {
+        if (fetch(i) && has_symbol(categories[i & mask])) return symbols[i & mask];
+        return Interner::NONE;
+    }
 
-    const std::vector<Token>& get() const;
+    const size_t get_line(const size_t &offset) const;
+    const size_t get_column(const size_t &offset) const;
+
+    const Source& get_source() const;
+    const Interner& get_interner() const;
 
     const bool& get_success() const;
+    const double& get_elapsed() const;
+    const double get_throughput() const;
 
     void log() const;
 
+    static const Interner::Symbol match_keyword(const std::string_view &value);
+    static const size_t match_operator(const std::string_view &raw, const size_t &i, Interner::Symbol &symbol);
+    static const Interner::Symbol match_punctuator(const char &c);
+    static const bool has_symbol(const TokenCategory &category) {
+        return category != INTEGER_LITERAL && category != FLOAT_LITERAL && category != STRING_LITERAL;
+    }
+
 private:
-    void lex(const std::string &raw);
-    const bool is_keyword(const std::string &value) const;
-    const bool is_operator(const std::string &value) const;
-    const bool is_punctuator(const std::string &value) const;
+    Lexer(const Source &source, const size_t &begin, const size_t &end);
+
+    void init(const size_t &begin, const size_t &end);
+    const bool lex(const size_t &limit) const;
+    void lex_parallel(const ThreadPool &pool);
+    void unknown_token() const;
+    const size_t get_start(const size_t &i) const;
+    void push(const TokenCategory &category, const size_t &offset, const uint32_t &data) const;
+    const bool fetch(const size_t &i) const {
+        return (i < produced && i >= oldest) || refill(i);
+    }
+
+    const bool refill(const size_t &i) const;
+    const size_t first() const;
+    const uint32_t get_length(const size_t &i) const;
+    void index_lines() const;
+
+    const Source &source;
+
+    // Tokens are stored as parallel arrays so walking categories touches one
+    // byte per token. A token's text is the interned name of its symbol, so
+    // only number and string literals, which carry no symbol, store their
+    // length, in the slot the symbol would take. When streaming the arrays
+    // are a ring indexed by token index & mask that the const accessors
+    // refill on demand, so lexing state is mutable.
+    mutable Interner interner;
+    mutable std::vector<TokenCategory> categories;
+    mutable std::vector<uint32_t> symbols;
+    mutable std::vector<uint32_t> offsets;
+
+    bool streaming;
+    size_t mask;
+    mutable size_t produced;
+    mutable size_t oldest;
+    mutable size_t cursor;
+    size_t bound;
+    mutable size_t release_at;
 
-    std::vector<Token> tokens;
+    // Offsets of every '\n' in the source, built on the first line lookup.
+    mutable std::vector<uint32_t> newlines;
+    mutable bool lines_indexed;
 
-    int line;
+    size_t bytes;
+    mutable double elapsed;
 
-    bool success;
+    mutable bool success;
 };
\ No newline at end of file
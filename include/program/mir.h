@@ -0,0 +1,177 @@
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Mid-level IR between the syntax tree and the x86 instructions, in SSA form.
+// Every instruction of a function defines at most one value, named by the
+// instruction's index, and every value is defined exactly once. Instructions
+// are grouped into basic blocks ending in a single exit that names the blocks
+// control continues in, so the blocks form the control flow graph the passes
+// work on. Locals are built as loads and stores of slots and turned into
+// values by Function::promote().
+class Mir {
+public:
+    enum Opcode : uint8_t {
+        // Instruction removed by a pass.
+        NOP,
+        // Value of a slot on paths that never stored it.
+        UNDEF,
+        CONST,
+        // Address of the data labelled 'symbol'.
+        STRING,
+        // Argument number 'value' of the function.
+        ARG,
+        // Value of slot 'value' from each predecessor, in the order of the
+        // block's 'preds'.
+        PHI,
+        // Slot number 'value'.
+        LOAD,
+        STORE,
+        ADD,
+        SUB,
+        MUL,
+        DIV,
+        MOD,
+        POW,
+        AND,
+        OR,
+        XOR,
+        SHL,
+        SHR,
+        // Comparisons yield a bool, signed when their operands are.
+        EQ,
+        NE,
+        LT,
+        LE,
+        GT,
+        GE,
+        NEG,
+        NOT,
+        // Operand 'a' converted to the size and sign of the instruction.
+        CAST,
+        // The second of 'args' if the first is true, else the third.
+        SELECT,
+        // Format string 'symbol' for printing 'a', see PRINT.
+        FORMAT,
+        // Call of function 'symbol' with 'args'.
+        CALL,
+        // printf of a string, the operand of a FORMAT is passed along with it.
+        PRINT,
+    };
+    enum Exit : uint8_t {
+        JUMP,
+        BRANCH,
+        RETURN,
+    };
+
+    static constexpr uint32_t none = UINT32_MAX;
+
+    struct Inst {
+        Inst(const Opcode &op, const uint8_t &size = 0, const bool &sign = false, const uint32_t &a = none, const uint32_t &b = none);
+        Opcode op;
+        // Width of the value in bytes, 0 for instructions without a value.
+        uint8_t size;
+        bool sign;
+        uint32_t a;
+        uint32_t b;
+        uint32_t block;
+        int64_t value;
+        std::string_view symbol;
+        std::vector<uint32_t> args;
+    };
+    struct Block {
+        Block();
+        // Instructions in order, phis first.
+        std::vector<uint32_t> insts;
+        Exit exit;
+        // Condition of a branch or value returned, none for a plain return.
+        uint32_t value;
+        // A branch continues in succs[0] when its condition holds.
+        std::vector<uint32_t> succs;
+        // One entry per incoming edge, also from blocks found unreachable.
+        std::vector<uint32_t> preds;
+        // Immediate dominator, none for the entry and unreachable blocks.
+        uint32_t idom;
+        std::vector<uint32_t> frontier;
+        // Number of loops the block is in.
+        uint32_t depth;
+    };
+    struct Slot {
+        uint8_t size;
+        bool sign;
+    };
+    struct Function {
+        Function(const std::string &id);
+
+        // Instructions are added to the end of block 'current', which the
+        // exits leave in place.
+        uint32_t add_block();
+        uint32_t add_slot(const uint8_t &size, const bool &sign);
+        uint32_t add(const Inst &inst);
+        void jump(const uint32_t &target);
+        void branch(const uint32_t &condition, const uint32_t &pass, const uint32_t &fail);
+        void ret(const uint32_t &value = none);
+
+        // Orders the reachable blocks and computes their dominator tree,
+        // dominance frontiers and loop depths.
+        void analyze();
+        const bool dominates(const uint32_t &a, const uint32_t &b) const;
+        // Blocks of the loop headed by 'header', the header first, or none
+        // if it heads no loop.
+        std::vector<uint32_t> get_loop(const uint32_t &header) const;
+        // Replaces the loads and stores of slots with values and phis.
+        void promote();
+        // Gives every edge into a block with phis a block of its own when its
+        // source has other successors, leaving a place for the phis' copies.
+        void split_edges();
+        // Orders the blocks for lowering in 'layout'.
+        void place_blocks();
+        // Folds the values found constant along the edges found executable
+        // and turns branches on constants into jumps.
+        void propagate_constants();
+        // Drops the blocks that cannot be reached and the instructions whose
+        // values go unused, and joins blocks to a successor only they reach.
+        // Returns the number of instructions removed.
+        uint32_t remove_dead_code();
+        // Removes an edge from 'pred' to 'succ' and the phi operands coming
+        // in over it.
+        void remove_edge(const uint32_t &pred, const uint32_t &succ);
+        // Calls 'f' with a reference to every operand of 'inst'.
+        template <typename F>
+        void for_each_operand(Inst &inst, F f) {
+            if (inst.a != none) f(inst.a);
+            if (inst.b != none) f(inst.b);
+            for (auto &arg : inst.args) {
+                if (arg != none) f(arg);
+            }
+        }
+
+        void log() const;
+
+        std::string id;
+        std::vector<Inst> insts;
+        std::vector<Block> blocks;
+        std::vector<Slot> slots;
+        // Reachable blocks in reverse post-order, the entry first.
+        std::vector<uint32_t> order;
+        // Position of each block in 'order', none for blocks not reached.
+        std::vector<uint32_t> rank;
+        // Reachable blocks in the order they are lowered, the entry first.
+        std::vector<uint32_t> layout;
+        uint32_t current;
+    };
+
+    Mir();
+
+    // 'value' cut to a 'size' byte integer and extended back by 'sign', the
+    // value a constant of that type holds.
+    static int64_t normalize(const int64_t &value, const int &size, const bool &sign);
+
+    void log() const;
+
+    std::vector<Function> functions;
+};
\ No newline at end of file
@@ -15,15 +15,18 @@
 
 class Object {
 public:
-    Object(const std::string &src_id, const std::string &out_dir);
+    // 'stats' prints how often each peephole rule matched.
+    Object(const std::string &src_id, const std::string &out_dir, const bool &stats = false);
     void build();
     void log();
 
 private:
     void compile();
+    void emit(const IRGenerator &ir_generator);
 
     const std::string &src_id;
     const std::string &out_dir;
+    bool stats;
 
     bool success;
 };
\ No newline at end of file
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+// Operand of an IR instruction: a register of some width, a memory reference,
+// an immediate or a label. Operands are small values compared and copied
+// without touching the heap. Labels and symbolic addresses refer to text the
+// IR generator keeps alive, and the NASM spelling is only produced by write().
+class Operand {
+public:
+    enum Kind : uint8_t {
+        NONE,
+        REGISTER,
+        MEMORY,
+        IMMEDIATE,
+        LABEL,
+    };
+    enum Register : uint8_t {
+        RAX,
+        RBX,
+        RCX,
+        RDX,
+        RSI,
+        RDI,
+        RBP,
+        RSP,
+        R8,
+        R9,
+        R10,
+        R11,
+        R12,
+        R13,
+        R14,
+        R15,
+        NO_REGISTER,
+    };
+
+    Operand();
+
+    // Register 'reg' at the width of a 'size' byte value, 1 to 8.
+    static const Operand reg(const Register &reg, const int &size);
+    // [base + index * scale + disp], 'size' sets the word prefix NASM needs
+    // when no register operand implies it, 0 leaves it out.
+    static const Operand mem(const Register &base, const int32_t &disp, const int &size = 0);
+    static const Operand mem(const Register &base, const Register &index, const uint8_t &scale, const int32_t &disp, const int &size = 0);
+    // Address of the data labelled 'symbol'.
+    static const Operand mem(const std::string_view &symbol);
+    static const Operand imm(const int64_t &value);
+    static const Operand label(const std::string_view &symbol);
+
+    // The same register or memory reference at another width.
+    const Operand resized(const int &size) const;
+
+    const bool operator==(const Operand &other) const;
+    const bool operator!=(const Operand &other) const;
+
+    void write(std::ostream &os) const;
+
+    Kind kind;
+    // Width in bytes, 0 for memory without a word prefix.
+    uint8_t size;
+    // Register, or base of a memory reference.
+    Register base;
+    Register index;
+    uint8_t scale;
+    // Displacement of a memory reference or value of an immediate.
+    int64_t value;
+    std::string_view symbol;
+};
+
+std::ostream& operator<<(std::ostream &os, const Operand &operand);
\ No newline at end of file
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <array>
+#include <chrono>
 #include <cstdint>
 #include <iostream>
 #include <unordered_map>
@@ -7,226 +9,200 @@
 #include <set>
 #include <vector>
 
+#include <program/arena.h>
 #include <program/env.h>
 #include <program/lexer.h>
+#include <program/thread_pool.h>
 
+// Nodes and the strings they refer to live in the parser's arena and are
+// freed together with the parser, which is why Node has no virtual
+// destructor. Child nodes that are absent point to a shared EmptyStatement.
+// Each node carries its Kind, passes switch on it and static_cast rather
+// than probing the node with dynamic_cast.
 class Parser {
 public:
     struct Node {
-        virtual ~Node() = default;
-        virtual void log() const {}
+        enum Kind : uint8_t {
+            BINARY_OPERATION,
+            CAST_OPERATION,
+            UNARY_OPERATION,
+            INTEGER_LITERAL,
+            FLOAT_LITERAL,
+            BOOLEAN_LITERAL,
+            STRING_LITERAL,
+            VARIABLE_DECLARATION,
+            VARIABLE_ASSIGNMENT,
+            VARIABLE_CALL,
+            FUNCTION_DECLARATION,
+            RETURN_STATEMENT,
+            FUNCTION_CALL,
+            CONDITIONAL_STATEMENT,
+            SCOPE_DECLARATION,
+            EMPTY_STATEMENT,
+            WHILE_LOOP_STATEMENT,
+            CLASS_MEMBER,
+            CLASS_DECLARATION,
+            EXTERN,
+            MODULE,
+        };
+
+        Node(const Kind &kind) : kind(kind) {}
+        // Prints the subtree with an explicit stack, so chains of any depth
+        // print without recursion.
+        void log() const;
+
+        // The node as a T, or null if it is another kind of node.
+        template <typename T>
+        const T* as() const {
+            return kind == T::tag ? static_cast<const T*>(this) : nullptr;
+        }
+
+        const Kind kind;
     };
 
     struct BinaryOperation : public Node {
-        BinaryOperation() {}
-        BinaryOperation(std::unique_ptr<Node> left, const std::string &op, std::unique_ptr<Node> right) : left(std::move(left)), op(std::move(op)), right(std::move(right)) {}
-        void log() const override {
-            std::cout << "BinaryOperation: (left: (";
-            left->log();
-            std::cout << "), op: '" << op << "', right: (";
-            right->log();
-            std::cout << "))";
-        }
-        std::unique_ptr<Node> left;
-        std::string op;
-        std::unique_ptr<Node> right;
+        static constexpr Kind tag = BINARY_OPERATION;
+
+        BinaryOperation() : Node(tag) {}
+        BinaryOperation(Node *left, const std::string_view &op, Node *right) : Node(tag), left(left), op(op), right(right) {}
+        Node *left = nullptr;
+        std::string_view op;
+        Node *right = nullptr;
     };
 
     struct CastOperation : public Node {
-        CastOperation() {}
-        CastOperation(std::unique_ptr<Node> left, const std::string &right) : left(std::move(left)), right(right) {}
-        void log() const override {
-            std::cout << "CastOperation: (left: (";
-            left->log();
-            std::cout << "), right: '" << right << "')";
-        }
-        std::unique_ptr<Node> left;
-        std::string right;
+        static constexpr Kind tag = CAST_OPERATION;
+
+        CastOperation() : Node(tag) {}
+        CastOperation(Node *left, const std::string_view &right) : Node(tag), left(left), right(right) {}
+        Node *left = nullptr;
+        std::string_view right;
     };
 
     struct UnaryOperation : public Node {
-        UnaryOperation(const std::string &op, std::unique_ptr<Node> value) : op(std::move(op)), value(std::move(value)) {}
-        void log() const override {
-            std::cout << "UnaryOperation: (op: '" << op << "', value: (";
-            value->log();
-            std::cout << "))";
-        }
-        std::string op;
-        std::unique_ptr<Node> value;
+        static constexpr Kind tag = UNARY_OPERATION;
+
+        UnaryOperation(const std::string_view &op, Node *value) : Node(tag), op(op), value(value) {}
+        std::string_view op;
+        Node *value = nullptr;
     };
 
     struct IntegerLiteral : public Node {
-        IntegerLiteral(const std::string &value) : value(std::move(value)) {}
-        void log() const override {
-            std::cout << "IntegerLiteral: '" << value << "'";
-        }
-        std::string value;
+        static constexpr Kind tag = INTEGER_LITERAL;
+
+        IntegerLiteral(const std::string_view &value) : Node(tag), value(value) {}
+        std::string_view value;
     };
 
     struct FloatLiteral : public Node {
-        FloatLiteral(const std::string &value) : value(std::move(value)) {}
-        void log() const override {
-            std::cout << "FloatLiteral: '" << value << "'";
-        }
-        std::string value;
+        static constexpr Kind tag = FLOAT_LITERAL;
+
+        FloatLiteral(const std::string_view &value) : Node(tag), value(value) {}
+        std::string_view value;
     };
 
     struct BooleanLiteral : public Node {
-        BooleanLiteral(const bool &value) : value(std::move(value)) {}
-        void log() const override {
-            std::cout << "BooleanLiteral: '";
-            if (value) {
-                std::cout << "true";
-            } else {
-                std::cout << "false";
-            }
-            std::cout << "'";
-        }
+        static constexpr Kind tag = BOOLEAN_LITERAL;
+
+        BooleanLiteral(const bool &value) : Node(tag), value(value) {}
         bool value;
     };
 
     struct StringLiteral : public Node {
-        StringLiteral(const std::string &value) : value(std::move(value)) {}
-        void log() const override {
-            std::cout << "StringLiteral: '" << value << "'";
-        }
-        std::string value;
+        static constexpr Kind tag = STRING_LITERAL;
+
+        StringLiteral(const std::string_view &value) : Node(tag), value(value) {}
+        std::string_view value;
     };
 
     struct VariableDeclaration : public Node {
-        VariableDeclaration(const std::string &type, const std::string &identifier, std::unique_ptr<Node> expr) : type(std::move(type)), identifier(std::move(identifier)), expr(std::move(expr)) {}
-        void log() const override {
-            std::cout << "VariableDeclaration: (type: '" << type << "', identifier: '" << identifier << "', expr: (";
-            expr->log();
-            std::cout << "))";
-        }
-        std::string type;
-        std::string identifier;
-        std::unique_ptr<Node> expr;
+        static constexpr Kind tag = VARIABLE_DECLARATION;
+
+        VariableDeclaration(const std::string_view &type, const std::string_view &identifier, Node *expr) : Node(tag), type(type), identifier(identifier), expr(expr) {}
+        std::string_view type;
+        std::string_view identifier;
+        Node *expr = nullptr;
+        // Declared 'final', never assigned after its declaration.
+        bool is_final = false;
     };
 
     struct VariableAssignment : public Node {
-        VariableAssignment(const std::string &identifier, std::unique_ptr<Node> expr) : identifier(std::move(identifier)), expr(std::move(expr)) {}
-        void log() const override {
-            std::cout << "VariableAssignment: (identifier: '" << identifier << "', expr: (";
-            expr->log();
-            std::cout << "))";
-        }
-        std::string identifier;
-        std::unique_ptr<Node> expr;
+        static constexpr Kind tag = VARIABLE_ASSIGNMENT;
+
+        VariableAssignment(const std::string_view &identifier, Node *expr) : Node(tag), identifier(identifier), expr(expr) {}
+        std::string_view identifier;
+        Node *expr = nullptr;
     };
 
     struct VariableCall : public Node {
-        VariableCall(const std::string &identifier) : identifier(std::move(identifier)) {}
-        void log() const override {
-            std::cout << "VariableCall: '" << identifier << "'";
-        }
-        std::string identifier;
+        static constexpr Kind tag = VARIABLE_CALL;
+
+        VariableCall(const std::string_view &identifier) : Node(tag), identifier(identifier) {}
+        std::string_view identifier;
     };
 
     struct FunctionDeclaration : public Node {
-        FunctionDeclaration() : statement(std::make_unique<EmptyStatement>()) {}
-        void log() const override {
-            std::cout << "FunctionDeclaration: (identifier: '" << identifier << "', args: (";
-            for (size_t i = 0; i < args_ids.size(); ++i) {
-                const bool last = i == args_ids.size() - 1;
-                std::cout << '(' << args_types[i] << ", " << args_ids[i] << ')';
-                if (!last) {
-                    std::cout << ", ";
-                }
-            }
-            std::cout << "), statement: (";
-            statement->log();
-            std::cout << "))";
-        }
-        std::string type;
-        std::string identifier;
-        std::vector<std::string> args_ids;
-        std::vector<std::string> args_types;
-        std::unique_ptr<Node> statement;
+        static constexpr Kind tag = FUNCTION_DECLARATION;
+
+        FunctionDeclaration() : Node(tag) {}
+        std::string_view type;
+        std::string_view identifier;
+        Arena::Array<std::string_view> args_ids;
+        Arena::Array<std::string_view> args_types;
+        Node *statement = nullptr;
     };
 
     struct ReturnStatement : public Node {
-        ReturnStatement() : expr(nullptr) {}
-        ReturnStatement(std::unique_ptr<Node> expr) : expr(std::move(expr)) {}
-        void log() const override {
-            std::cout << "ReturnStatement: (expr: (";
-            expr->log();
-            std::cout << "))";
-        }
-        std::unique_ptr<Node> expr;
+        static constexpr Kind tag = RETURN_STATEMENT;
+
+        ReturnStatement() : Node(tag) {}
+        ReturnStatement(Node *expr) : Node(tag), expr(expr) {}
+        Node *expr = nullptr;
     };
 
     struct FunctionCall : public Node {
-        FunctionCall(const std::string &identifier) : identifier(std::move(identifier)) {}
-        void log() const override {
-            std::cout << "FunctionCall: (identifier: '" << identifier << "', args: (";
-            for (size_t i = 0; i < args.size(); ++i) {
-                const bool last = i == args.size() - 1;
-                args[i]->log();
-                if (!last) {
-                    std::cout << ", ";
-                }
-            }
-            std::cout << "))";
-        }
-        std::string identifier;
-        std::vector<std::unique_ptr<Node>> args;
+        static constexpr Kind tag = FUNCTION_CALL;
+
+        FunctionCall(const std::string_view &identifier) : Node(tag), identifier(identifier) {}
+        std::string_view identifier;
+        Arena::Array<Node*> args;
     };
 
     struct ConditionalStatement : public Node {
-        ConditionalStatement() : pass_statement(std::make_unique<EmptyStatement>()), fail_statement(std::make_unique<EmptyStatement>()) {}
-        void log() const override {
-            std::cout << "ConditionalStatement: (condition: (";
-            condition->log();
-            std::cout << "), pass_statement: (";
-            pass_statement->log();
-            std::cout << "), fail_statement: (";
-            fail_statement->log();
-            std::cout << "))";
-        }
-        std::unique_ptr<Node> condition;
-        std::unique_ptr<Node> pass_statement;
-        std::unique_ptr<Node> fail_statement;
+        static constexpr Kind tag = CONDITIONAL_STATEMENT;
+
+        ConditionalStatement() : Node(tag) {}
+        Node *condition = nullptr;
+        Node *pass_statement = nullptr;
+        Node *fail_statement = nullptr;
     };
 
     struct ScopeDeclaration : public Node {
-        ScopeDeclaration() {}
-        void log() const override {
-            std::cout << "ScopeDeclaration: (ast: {" << '\n';
-            for (const auto &n : ast) {
-                std::cout << '\t';
-                n->log();
-                std::cout << '\n';
-            }
-            std::cout << "})";
-        }
-        std::vector<std::unique_ptr<Node>> ast;
+        static constexpr Kind tag = SCOPE_DECLARATION;
+
+        ScopeDeclaration() : Node(tag) {}
+        Arena::Array<Node*> ast;
     };
 
     struct EmptyStatement : public Node {
-        EmptyStatement() {}
-        void log() const override {
-            std::cout << "EmptyStatement";
-        }
+        static constexpr Kind tag = EMPTY_STATEMENT;
+
+        EmptyStatement() : Node(tag) {}
     };
 
     struct WhileLoopStatement : public Node {
-        WhileLoopStatement() : statement(std::make_unique<EmptyStatement>()) {}
-        void log() const override {
-            std::cout << "WhileLoopStatement: (condition: (";
-            condition->log();
-            std::cout << "), statement: (";
-            statement->log();
-            std::cout << "))";
-        }
-        std::unique_ptr<Node> condition;
-        std::unique_ptr<Node> statement;
+        static constexpr Kind tag = WHILE_LOOP_STATEMENT;
+
+        WhileLoopStatement() : Node(tag) {}
+        Node *condition = nullptr;
+        Node *statement = nullptr;
     };
 
     struct ClassMember : public Node {
-        ClassMember() : statement(std::make_unique<EmptyStatement>()) {}
-        std::unique_ptr<Node> statement;
+        static constexpr Kind tag = CLASS_MEMBER;
+
+        ClassMember() : Node(tag) {}
+        Node *statement = nullptr;
 
         enum {
             PUBLIC,
@@ -234,105 +210,131 @@ public:
             PRIVATE,
         } access;
 
-        void log() const override {
-            std::string access_str;
-            if (access == PUBLIC) access_str = "public";
-            else if (access == PROTECTED) access_str = "protected";
-            else if (access == PRIVATE) access_str = "private";
-
-            std::cout << "ClassMember: (access: " << access_str << ", statement: (";
-            statement->log();
-            std::cout << ")";
-        }
     };
 
     struct ClassDeclaration : public Node {
-        ClassDeclaration() {}
-        void log() const override {
-            std::cout << "ClassDeclaration: (identifier: '" << identifier << "', statement:" << '\n';
-            statement->log();
-            std::cout << ")";
-        }
+        static constexpr Kind tag = CLASS_DECLARATION;
+
+        ClassDeclaration() : Node(tag) {}
 
-        std::string identifier;
-        std::unique_ptr<Node> statement;
+        std::string_view identifier;
+        Node *statement = nullptr;
     };
 
     struct Extern : public Node {
-        Extern(const std::string &id) : id(id) {}
-        void log() const override {
-            std::cout << "Extern: (id: '" << id << "')";
-        }
-        std::string id;
+        static constexpr Kind tag = EXTERN;
+
+        Extern(const std::string_view &id) : Node(tag), id(id) {}
+        std::string_view id;
     };
 
     struct Module : public Node {
-        Module() : statement(std::make_unique<EmptyStatement>()) {}
-        void log() const override {
-            std::cout << "Module: (id: '" << id << "', statement; (";
-            statement->log();
-            std::cout << "))";
-        }
-        std::string id;
-        std::unique_ptr<Node> statement;
+        static constexpr Kind tag = MODULE;
+
+        Module() : Node(tag) {}
+        std::string_view id;
+        Node *statement = nullptr;
     };
 
+    // Token count from which parsing on a pool pays off.
+    static constexpr size_t parallel_threshold = 64 * 1024;
+
     Parser(const Lexer &lexer);
-    const std::vector<std::unique_ptr<Node>>& get() const;
+    // Parses lexers of at least 'parallel_threshold' tokens in runs of whole
+    // global statements on the pool, falling back to a serial parse when the
+    // runs do not line up with the statements.
+    Parser(const Lexer &lexer, const ThreadPool &pool);
+    const std::vector<Node*>& get() const;
+
+    // Reparses the global statements a relex touched, keeping the others.
+    void reparse(const Lexer::Splice &splice);
 
     const bool& get_success() const;
+    const double& get_elapsed() const;
 
     void log() const;
 
+    const Arena& get_arena() const;
+
 private:
-    std::vector<std::unique_ptr<Node>> ast;
-    const std::vector<Lexer::Token> &tokens;
+    Parser(const Lexer &lexer, const size_t &begin);
+
+    std::vector<Node*> ast;
+    // Index of the first token of each global statement in 'ast'.
+    std::vector<size_t> starts;
+
+    Arena arena;
+    Node *empty;
+    // Arena bytes in use after the last full parse, see reparse().
+    size_t parsed_bytes;
+    // Stack of the nodes and names of the lists being parsed, each list is
+    // moved into the arena once complete.
+    std::vector<Node*> pending_nodes;
+    std::vector<std::string_view> pending_names;
+    // Operators of the expressions being parsed that wait for their right
+    // side, see expression().
+    struct PendingOperator {
+        // Left side of a binary operator, null for prefix operators and
+        // parentheses.
+        Node *left;
+        uint32_t symbol;
+        // Binding power in effect before the operator was read.
+        uint8_t power;
+    };
+    std::vector<PendingOperator> pending_operators;
+
+    const Lexer &lexer;
     size_t current = 0;
+    // Token reads of the last parse, see log().
+    mutable size_t visits = 0;
+    // Set on the parsers of a parallel parse's runs.
+    bool chunk = false;
 
     void parse();
+    void parse_parallel(const ThreadPool &pool);
+    const bool parse_chunk(const size_t &end);
+    const bool split(std::vector<size_t> &bounds, const size_t &count) const;
+    Arena::Array<Node*> collect(const size_t &base);
+    void parameters(FunctionDeclaration *function);
     bool at_end() const;
-    const Lexer::Token& peek() const;
-    const Lexer::Token& previous() const;
-    const Lexer::Token& next() const;
-    const Lexer::Token& rewind();
-    const Lexer::Token& advance();
-    const Lexer::Token& consume(const std::string& type, const std::string& message);
-
-    bool match(const std::initializer_list<std::string> &values);
-
-    std::unique_ptr<Node> flag_statement();
-    std::unique_ptr<Node> global_statement();
-    std::unique_ptr<Node> function_declaration();
-
-    std::unique_ptr<Node> extern_declaration();
-    std::unique_ptr<Node> module_declaration();
-
-    std::unique_ptr<Node> class_declaration();
-    std::unique_ptr<Node> class_statement();
-    std::unique_ptr<Node> constructor_declaration();
-    std::unique_ptr<Node> destructor_declaration();
-
-    std::unique_ptr<Node> statement();
-    std::unique_ptr<Node> modular_statement(std::string &mod);
-    std::unique_ptr<Node> conditional_statement();
-    std::unique_ptr<Node> scope_declaration();
-    std::unique_ptr<Node> variable_declaration(const bool &initialized);
-    std::unique_ptr<Node> variable_assignment(const std::string &mod);
-    std::unique_ptr<Node> while_loop_statement();
-    std::unique_ptr<Node> return_statement();
-    std::unique_ptr<Node> function_call(const std::string &mod);
-
-    std::unique_ptr<Node> expression();
-    std::unique_ptr<Node> equality();
-    std::unique_ptr<Node> comparison();
-    std::unique_ptr<Node> term();
-    std::unique_ptr<Node> factor();
-    std::unique_ptr<Node> remainder();
-    std::unique_ptr<Node> cast();
-    std::unique_ptr<Node> unary();
-    std::unique_ptr<Node> primary();
+    // Statements are told apart by looking a fixed number of tokens ahead,
+    // the parser never steps back.
+    bool check(const Lexer::TokenCategory &category, const size_t &ahead = 0) const;
+    bool check(const Interner::Symbol &symbol, const size_t &ahead = 0) const;
+    const Lexer::Token peek() const;
+    const Lexer::Token previous() const;
+    const Lexer::Token advance();
+    const Lexer::Token consume(const Interner::Symbol &symbol, const std::string& message);
+
+    bool match(const std::initializer_list<Interner::Symbol> &symbols);
+
+    Node *flag_statement();
+    Node *global_statement();
+    Node *function_declaration();
+
+    Node *extern_declaration();
+    Node *module_declaration();
+
+    Node *class_declaration();
+    Node *class_statement();
+    Node *constructor_declaration();
+    Node *destructor_declaration();
+
+    Node *statement();
+    Node *modular_statement(std::string &mod);
+    Node *conditional_statement();
+    Node *scope_declaration();
+    Node *variable_declaration();
+    Node *variable_assignment(const std::string &mod);
+    Node *while_loop_statement();
+    Node *return_statement();
+    Node *function_call(const std::string &mod);
+
+    Node *expression();
+    Node *primary();
 
     bool success;
+    double elapsed;
     std::string mod_prefix;
 
     [[noreturn]] void error(const std::string &msg);
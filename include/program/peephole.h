@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+#include <program/ir_generator.h>
+
+// Rewrites short runs of lowered instructions into fewer ones. Each rule of
+// the table in peephole.cpp looks at a window starting at one instruction
+// and either leaves it or replaces the instructions it matched, and the
+// rules are applied over a function again until none matches. Rules only
+// assume what lowering guarantees: flags are set by a cmp right before the
+// instruction reading them, and the upper half of a register written at
+// dword width may be relied on to be zero.
+class Peephole {
+public:
+    Peephole();
+
+    // Applies the rules to 'instructions' until none matches.
+    void run(std::vector<IRGenerator::Instruction> &instructions);
+
+    void log() const;
+
+private:
+    // Times each rule matched, in the order of the rule table.
+    std::vector<uint32_t> hits;
+};
\ No newline at end of file
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <program/mir.h>
+#include <program/operand.h>
+
+// Decides where each value of a Mir function lives during lowering: in a
+// general purpose register or in a stack slot below rbp. rax, rcx, rdx, r10
+// and r11 stay free as the scratch registers of lowering. r8 and r9 do not
+// survive calls, so only values not live across one get them, and the
+// callee saved registers handed out are saved in the first qwords below rbp.
+// Values left without a register are spilled to a slot of their own, the
+// ones with the lowest spill cost first: their uses weighted by 10 to the
+// power of their loop depth.
+class RegisterAllocator {
+public:
+    enum Strategy : uint8_t {
+        // Every value in a stack slot.
+        STACK,
+        // A single pass over the live ranges of the values in block order.
+        LINEAR_SCAN,
+        // Colors the interference graph, slower but exact where ranges have
+        // holes.
+        GRAPH_COLORING,
+    };
+
+    RegisterAllocator(const Mir::Function &function, const Strategy &strategy);
+
+    // Location of each instruction's value, none for constants and addresses
+    // that are rebuilt where they are used.
+    const std::vector<Operand>& get_locations() const;
+    // Callee saved registers written, saved at [rbp - 8], [rbp - 16], ...
+    const std::vector<Operand::Register>& get_saved() const;
+    // Bytes below rbp taken by saved registers and stack slots.
+    const int& get_frame_size() const;
+
+private:
+    struct Range {
+        uint32_t value;
+        uint32_t start;
+        uint32_t end;
+        double cost;
+        bool crosses_call;
+    };
+
+    void compute_liveness();
+    void compute_ranges();
+    void scan();
+    void color();
+    void place_spills();
+
+    const bool needs_location(const uint32_t &value) const;
+    const bool allows(const Range &range, const Operand::Register &reg) const;
+
+    const Mir::Function &function;
+    Strategy strategy;
+
+    // Values live on entry to and exit from each block, in increasing
+    // order.
+    std::vector<std::vector<uint32_t>> live_in;
+    std::vector<std::vector<uint32_t>> live_out;
+    std::vector<Range> ranges;
+    // Range of each value, none for values without a location.
+    std::vector<uint32_t> range_of;
+    std::vector<Operand::Register> assigned;
+
+    std::vector<Operand> locations;
+    std::vector<Operand::Register> saved;
+    int frame_size;
+};
\ No newline at end of file
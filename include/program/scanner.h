@@ -0,0 +1,89 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Bulk character scanning for the lexer. Every scan starts at 'i' and returns
+// the index of the first byte that ends the run, or raw.length() if the run
+// reaches the end of the buffer.
+class Scanner {
+public:
+    enum Backend {
+        SCALAR,
+        SSE2,
+        AVX2,
+    };
+
+    enum CharClass : uint8_t {
+        SPACE = 1 << 0,
+        ALPHA = 1 << 1,
+        DIGIT = 1 << 2,
+        UNDERSCORE = 1 << 3,
+        IDENTIFIER = ALPHA | DIGIT | UNDERSCORE,
+    };
+
+    static const std::array<uint8_t, 256> classes;
+
+    static bool is_space(const char &c) { return classes[static_cast<uint8_t>(c)] & SPACE; }
+    static bool is_alpha(const char &c) { return classes[static_cast<uint8_t>(c)] & ALPHA; }
+    static bool is_digit(const char &c) { return classes[static_cast<uint8_t>(c)] & DIGIT; }
+    static bool is_identifier(const char &c) { return classes[static_cast<uint8_t>(c)] & IDENTIFIER; }
+
+    // Most runs in real sources are only a few bytes long, the first
+    // 'inline_run' bytes are checked here before paying for a vector scan.
+    static constexpr size_t inline_run = 8;
+
+    static size_t skip_whitespace(const std::string_view &raw, size_t i) {
+        for (const size_t limit = std::min(i + inline_run, raw.length()); i < limit; ++i) {
+            if (!is_space(raw[i])) return i;
+        }
+        return table.skip_whitespace(raw.data(), i, raw.length());
+    }
+
+    static size_t skip_identifier(const std::string_view &raw, size_t i) {
+        for (const size_t limit = std::min(i + inline_run, raw.length()); i < limit; ++i) {
+            if (!is_identifier(raw[i])) return i;
+        }
+        return table.skip_identifier(raw.data(), i, raw.length());
+    }
+
+    static size_t skip_digits(const std::string_view &raw, size_t i) {
+        for (const size_t limit = std::min(i + inline_run, raw.length()); i < limit; ++i) {
+            if (!is_digit(raw[i])) return i;
+        }
+        return table.skip_digits(raw.data(), i, raw.length());
+    }
+
+    static size_t find_char(const std::string_view &raw, const size_t &i, const char &c) {
+        return table.find_char(raw.data(), i, raw.length(), c);
+    }
+
+    static size_t find_block_end(const std::string_view &raw, const size_t &i) {
+        return table.find_block_end(raw.data(), i, raw.length());
+    }
+
+    static Backend get_backend();
+    static bool set_backend(const Backend &backend);
+    static const std::vector<Backend> get_supported();
+    static const char* get_name(const Backend &backend);
+
+private:
+    struct Table {
+        size_t (*skip_whitespace)(const char*, size_t, size_t);
+        size_t (*skip_identifier)(const char*, size_t, size_t);
+        size_t (*skip_digits)(const char*, size_t, size_t);
+        size_t (*find_char)(const char*, size_t, size_t, char);
+        size_t (*find_block_end)(const char*, size_t, size_t);
+    };
+
+    static bool is_supported(const Backend &backend);
+    static Backend detect();
+
+    static Backend backend;
+    static Table table;
+};
\ No newline at end of file
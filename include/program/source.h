@@ -1,19 +1,59 @@
 #pragma once
 
+#include <cstddef>
 #include <fstream>
 #include <iostream>
 #include <sstream>
 #include <string>
+#include <string_view>
 
+// Source text of a single file. Regular files are memory mapped and handed to
+// the lexer without a copy, pipes and stdin ("-") are read into a buffer.
+// Mapped sources of at least 'stream_threshold' bytes are streamed: the
+// mapping is read ahead sequentially and the consumer calls release() as it
+// moves on, so pages it has passed can be dropped from memory. Released bytes
+// remain readable, they are paged back in from the file on access.
 class Source {
 public:
+    enum Mode {
+        MAPPED,
+        STREAMED,
+        BUFFERED,
+    };
+
+    static constexpr size_t stream_threshold = 64ull * 1024 * 1024;
+
     Source(const std::string &fp);
-    const std::string& get() const;
+    ~Source();
+
+    Source(const Source&) = delete;
+    Source& operator=(const Source&) = delete;
+
+    const std::string_view get() const;
+    const Mode& get_mode() const;
     const bool& get_success() const;
 
+    void release(const size_t &offset) const;
+    void replace(const size_t &offset, const size_t &removed, const std::string_view &text);
+
 private:
     void read_source(const std::string &fp);
+    bool map_source(const std::string &fp);
+    void unmap_source();
 
     bool success;
+    Mode mode;
+
     std::string raw;
+    const char *data;
+    size_t length;
+
+#ifdef _WIN32
+    void *file;
+    void *mapping;
+#else
+    int fd;
+#endif
+
+    mutable size_t released;
 };
\ No newline at end of file
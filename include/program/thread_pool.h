@@ -0,0 +1,49 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Keeps 'workers' - 1 threads alive for the lifetime of the pool and runs
+// batches of independent tasks on them, the calling thread included. Tasks
+// are handed out through an atomic counter so uneven tasks balance out, the
+// first exception thrown by a task is rethrown by run() once the batch has
+// finished. Batches run one at a time, the workers are joined on destruction.
+class ThreadPool {
+public:
+    explicit ThreadPool(const size_t &workers = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    const size_t& get_workers() const;
+
+    void run(const size_t &tasks, const std::function<void(const size_t&)> &task) const;
+
+private:
+    size_t workers;
+    std::vector<std::thread> threads;
+
+    // State of the current batch, shared with the workers under 'mutex'.
+    mutable std::mutex batch_mutex;
+    mutable std::mutex mutex;
+    mutable std::condition_variable wake;
+    mutable std::condition_variable done;
+    mutable const std::function<void(const size_t&)> *task;
+    mutable size_t tasks;
+    mutable std::atomic<size_t> next;
+    mutable size_t batch;
+    mutable size_t busy;
+    mutable std::exception_ptr error;
+    bool stopping;
+
+    void work() const;
+    void drain() const;
+};
\ No newline at end of file
@@ -19,6 +19,11 @@ public:
 
     static const std::string src_id_to_path(const std::string &id);
 
+    static const size_t get_workers();
+    static const int get_optimization();
+
+    static const std::string& get_version();
+
     static const std::string capitalize(const std::string &value);
 
     static const nlohmann::json read_json(const std::string json_path, bool rel = true);
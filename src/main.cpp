@@ -4,7 +4,13 @@
 #include <stdexcept>
 #include <vector>
 
+#include <program/document.h>
 #include <program/env.h>
+#include <program/flat_ast.h>
+#include <program/ir_generator.h>
+#include <program/source.h>
+#include <program/lexer.h>
+#include <program/parser.h>
 #include <program/utils.h>
 
 void help() {
@@ -13,12 +19,12 @@ void help() {
     std::cout << "\t<path_to_file> : run program" << '\n';
     std::cout << "\t-v or -version : show version" << '\n';
     std::cout << "\t-h or -help : show help information" << '\n';
+    std::cout << "\tbench <path_to_file> : measure front end throughput" << '\n';
+    std::cout << "\tbuild or run --stats : also show how often each peephole rule matched" << '\n';
 }
 
 void version() {
-    const nlohmann::json properties = Utils::read_json("src/resources/los.json", false);
-    const std::string version = properties["los"]["version"].get<std::string>();
-    std::cout << "los v" << version << '\n';
+    std::cout << "los v" << Utils::get_version() << '\n';
 }
 
 void new_project(const std::string &id) {
@@ -41,17 +47,285 @@ void new_project(const std::string &id) {
     project_ofs << '\t' << "\"detail\": {" << '\n';
     project_ofs << '\t' << '\t' << "\"src\": \"./src/main\"," << '\n';
     project_ofs << '\t' << '\t' << "\"out\": \"./bin/main\"," << '\n';
-    project_ofs << '\t' << '\t' << "\"worker\": 0" << '\n';
+    project_ofs << '\t' << '\t' << "\"worker\": 0," << '\n';
+    project_ofs << '\t' << '\t' << "\"optimization\": 1" << '\n';
     project_ofs << '\t' << "}," << '\n';
     project_ofs << '\t' << "\"libs\": []" << '\n';
     project_ofs << "}" << '\n';
     project_ofs.close();
 }
 
-int build() {
+// Height of the subtree at 'root', a pass in the manner of type deduction
+// that follows the node pointers. Walks with an explicit stack of nodes and
+// their depth, so long operator chains do not exhaust the call stack.
+size_t tree_height(const Parser::Node *root) {
+    size_t height = 0;
+    std::vector<std::pair<const Parser::Node*, size_t>> stack = {{root, 1}};
+    while (!stack.empty()) {
+        const auto [node, depth] = stack.back();
+        stack.pop_back();
+        height = std::max(height, depth);
+        const auto visit = [&stack, depth = depth](const Parser::Node *child) {
+            stack.push_back({child, depth + 1});
+        };
+        switch (node->kind) {
+            case Parser::Node::BINARY_OPERATION:
+                visit(node->as<Parser::BinaryOperation>()->left);
+                visit(node->as<Parser::BinaryOperation>()->right);
+                break;
+            case Parser::Node::CAST_OPERATION:
+                visit(node->as<Parser::CastOperation>()->left);
+                break;
+            case Parser::Node::UNARY_OPERATION:
+                visit(node->as<Parser::UnaryOperation>()->value);
+                break;
+            case Parser::Node::VARIABLE_DECLARATION:
+                visit(node->as<Parser::VariableDeclaration>()->expr);
+                break;
+            case Parser::Node::VARIABLE_ASSIGNMENT:
+                visit(node->as<Parser::VariableAssignment>()->expr);
+                break;
+            case Parser::Node::FUNCTION_DECLARATION:
+                visit(node->as<Parser::FunctionDeclaration>()->statement);
+                break;
+            case Parser::Node::RETURN_STATEMENT:
+                visit(node->as<Parser::ReturnStatement>()->expr);
+                break;
+            case Parser::Node::FUNCTION_CALL:
+                for (const auto &arg : node->as<Parser::FunctionCall>()->args) visit(arg);
+                break;
+            case Parser::Node::CONDITIONAL_STATEMENT:
+                visit(node->as<Parser::ConditionalStatement>()->condition);
+                visit(node->as<Parser::ConditionalStatement>()->pass_statement);
+                visit(node->as<Parser::ConditionalStatement>()->fail_statement);
+                break;
+            case Parser::Node::SCOPE_DECLARATION:
+                for (const auto &n : node->as<Parser::ScopeDeclaration>()->ast) visit(n);
+                break;
+            case Parser::Node::WHILE_LOOP_STATEMENT:
+                visit(node->as<Parser::WhileLoopStatement>()->condition);
+                visit(node->as<Parser::WhileLoopStatement>()->statement);
+                break;
+            case Parser::Node::CLASS_MEMBER:
+                visit(node->as<Parser::ClassMember>()->statement);
+                break;
+            case Parser::Node::CLASS_DECLARATION:
+                visit(node->as<Parser::ClassDeclaration>()->statement);
+                break;
+            case Parser::Node::MODULE:
+                visit(node->as<Parser::Module>()->statement);
+                break;
+            default:
+                break;
+        }
+    }
+    return height;
+}
+
+// The same pass over the flat tree, children come first so one loop does.
+size_t flat_height(const FlatAst &flat, std::vector<uint32_t> &heights) {
+    const auto &nodes = flat.get_nodes();
+    heights.resize(nodes.size());
+    for (FlatAst::Index i = 0; i < nodes.size(); ++i) {
+        uint32_t height = 0;
+        flat.for_each_child(i, [&](const FlatAst::Index &child) {
+            height = std::max(height, heights[child]);
+        });
+        heights[i] = height + 1;
+    }
+    size_t total = 0;
+    for (const auto &root : flat.get_roots()) {
+        total += heights[root];
+    }
+    return total;
+}
+
+int bench(const std::string &fp) {
+    const int runs = 10;
+
+    try {
+        Source source(fp);
+        if (!source.get_success()) {
+            return EXIT_FAILURE;
+        }
+
+        const double mb = source.get().length() / (1024.0 * 1024.0);
+
+        std::cout << std::fixed;
+        std::cout << " -- Bench result -- " << '\n';
+
+        const auto selected = Scanner::get_backend();
+        for (const auto &backend : Scanner::get_supported()) {
+            Scanner::set_backend(backend);
+
+            double lex_best = 0.0;
+            double lex_total = 0.0;
+            size_t token_count = 0;
+            for (int i = 0; i < runs; ++i) {
+                Lexer lexer(source);
+                const double elapsed = lexer.get_elapsed();
+                if (i == 0 || elapsed < lex_best) lex_best = elapsed;
+                lex_total += elapsed;
+                token_count = lexer.size();
+            }
+
+            if (backend == Scanner::SCALAR) {
+                std::cout << "source: " << source.get().length() << " byte(s), " << token_count << " token(s), " << runs << " run(s)" << '\n';
+            }
+            std::cout << "lex (" << Scanner::get_name(backend) << "): best " << lex_best << " ms, avg " << lex_total / runs << " ms, " << mb / (lex_best / 1000.0) << " MB/s" << '\n';
+        }
+        Scanner::set_backend(selected);
+
+        const ThreadPool pool(Utils::get_workers());
+        if (pool.get_workers() > 1 && source.get().length() >= Lexer::parallel_threshold) {
+            double lex_best = 0.0;
+            double lex_total = 0.0;
+            for (int i = 0; i < runs; ++i) {
+                Lexer lexer(source, pool);
+                const double elapsed = lexer.get_elapsed();
+                if (i == 0 || elapsed < lex_best) lex_best = elapsed;
+                lex_total += elapsed;
+            }
+            std::cout << "lex (" << pool.get_workers() << " workers): best " << lex_best << " ms, avg " << lex_total / runs << " ms, " << mb / (lex_best / 1000.0) << " MB/s" << '\n';
+        }
+
+        const Lexer lexer(source);
+        double parse_best = 0.0;
+        double parse_total = 0.0;
+        for (int i = 0; i < runs; ++i) {
+            Parser parser(lexer);
+            const double elapsed = parser.get_elapsed();
+            if (i == 0 || elapsed < parse_best) parse_best = elapsed;
+            parse_total += elapsed;
+        }
+        std::cout << "parse: best " << parse_best << " ms, avg " << parse_total / runs << " ms, " << lexer.size() / (parse_best / 1000.0) / 1e6 << " M token(s)/s" << '\n';
+
+        if (pool.get_workers() > 1 && lexer.size() >= Parser::parallel_threshold) {
+            parse_best = 0.0;
+            parse_total = 0.0;
+            for (int i = 0; i < runs; ++i) {
+                Parser parser(lexer, pool);
+                const double elapsed = parser.get_elapsed();
+                if (i == 0 || elapsed < parse_best) parse_best = elapsed;
+                parse_total += elapsed;
+            }
+            std::cout << "parse (" << pool.get_workers() << " workers): best " << parse_best << " ms, avg " << parse_total / runs << " ms, " << lexer.size() / (parse_best / 1000.0) / 1e6 << " M token(s)/s" << '\n';
+        }
+
+        const Parser parser(lexer);
+        double ir_best = 0.0;
+        double ir_total = 0.0;
+        for (int i = 0; i < runs; ++i) {
+            IRGenerator ir_generator(parser);
+            const double elapsed = ir_generator.get_elapsed();
+            if (i == 0 || elapsed < ir_best) ir_best = elapsed;
+            ir_total += elapsed;
+        }
+        std::cout << "ir: best " << ir_best << " ms, avg " << ir_total / runs << " ms" << '\n';
+
+        const auto flatten_start = std::chrono::high_resolution_clock::now();
+        const FlatAst flat(parser);
+        const auto flatten_end = std::chrono::high_resolution_clock::now();
+        const double flatten_elapsed = std::chrono::duration<double, std::milli>(flatten_end - flatten_start).count();
+
+        // Summed subtree heights of the global statements, the two results
+        // have to agree.
+        double tree_best = 0.0;
+        double flat_best = 0.0;
+        size_t tree_total = 0;
+        size_t flat_total = 0;
+        std::vector<uint32_t> heights;
+        for (int i = 0; i < runs; ++i) {
+            auto start = std::chrono::high_resolution_clock::now();
+            tree_total = 0;
+            for (const auto &n : parser.get()) {
+                tree_total += tree_height(n);
+            }
+            auto end = std::chrono::high_resolution_clock::now();
+            double elapsed = std::chrono::duration<double, std::milli>(end - start).count();
+            if (i == 0 || elapsed < tree_best) tree_best = elapsed;
+
+            start = std::chrono::high_resolution_clock::now();
+            flat_total = flat_height(flat, heights);
+            end = std::chrono::high_resolution_clock::now();
+            elapsed = std::chrono::duration<double, std::milli>(end - start).count();
+            if (i == 0 || elapsed < flat_best) flat_best = elapsed;
+        }
+        if (tree_total != flat_total) throw std::runtime_error("Flat tree disagrees with the parser's tree.");
+        std::cout << "flatten: " << flatten_elapsed << " ms, " << flat.get_nodes().size() << " node(s), " << flat.get_bytes() << " byte(s) against " << parser.get_arena().get_bytes() << " byte(s) of arena" << '\n';
+        std::cout << "traverse: pointer tree best " << tree_best << " ms, flat best " << flat_best << " ms" << '\n';
+
+        // Round trip through the syntax tree cache, loading includes mapping
+        // the file and expanding the nodes for the IR generator.
+        const std::string cache_path = (std::filesystem::temp_directory_path() / "los_bench.ast").string();
+        const uint64_t key = FlatAst::get_key(source.get(), "bench");
+        double save_best = 0.0;
+        double load_best = 0.0;
+        for (int i = 0; i < runs; ++i) {
+            auto start = std::chrono::high_resolution_clock::now();
+            if (!flat.save(cache_path, key)) throw std::runtime_error("Could not write '" + cache_path + "'.");
+            auto end = std::chrono::high_resolution_clock::now();
+            double elapsed = std::chrono::duration<double, std::milli>(end - start).count();
+            if (i == 0 || elapsed < save_best) save_best = elapsed;
+
+            start = std::chrono::high_resolution_clock::now();
+            {
+                const Source cache(cache_path);
+                const FlatAst loaded(cache, key);
+                if (!loaded.get_success()) throw std::runtime_error("Could not load '" + cache_path + "'.");
+                Arena arena;
+                loaded.expand(arena);
+            }
+            end = std::chrono::high_resolution_clock::now();
+            elapsed = std::chrono::duration<double, std::milli>(end - start).count();
+            if (i == 0 || elapsed < load_best) load_best = elapsed;
+        }
+        std::filesystem::remove(cache_path);
+        std::cout << "cache: save best " << save_best << " ms, load best " << load_best << " ms" << '\n';
+
+        // Lexing on demand while parsing, as done for streamed sources.
+        double stream_best = 0.0;
+        double stream_total = 0.0;
+        for (int i = 0; i < runs; ++i) {
+            const auto start = std::chrono::high_resolution_clock::now();
+            Lexer streamed(source, Lexer::default_window);
+            Parser parser(streamed);
+            const auto end = std::chrono::high_resolution_clock::now();
+            const double elapsed = std::chrono::duration<double, std::milli>(end - start).count();
+            if (i == 0 || elapsed < stream_best) stream_best = elapsed;
+            stream_total += elapsed;
+        }
+        std::cout << "lex + parse (window of " << Lexer::default_window << "): best " << stream_best << " ms, avg " << stream_total / runs << " ms" << '\n';
+
+        // Typing and deleting a space mid-file, the first edit copies the source so it is not counted.
+        Document document(fp);
+        const size_t middle = document.get_source().get().find(' ', document.get_source().get().length() / 2);
+        if (document.get_success() && middle != std::string_view::npos) {
+            document.edit(middle, 0, " ");
+            document.edit(middle, 1, "");
+
+            double edit_best = 0.0;
+            double edit_total = 0.0;
+            for (int i = 0; i < runs * 2; ++i) {
+                if (i % 2 == 0) document.edit(middle, 0, " ");
+                else document.edit(middle, 1, "");
+                const double elapsed = document.get_elapsed();
+                if (i == 0 || elapsed < edit_best) edit_best = elapsed;
+                edit_total += elapsed;
+            }
+            std::cout << "edit (1 byte): best " << edit_best << " ms, avg " << edit_total / (runs * 2) << " ms" << '\n';
+        }
+        return EXIT_SUCCESS;
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << '\n';
+        return EXIT_FAILURE;
+    }
+}
+
+int build(const bool &stats) {
     try {
         auto &env = Env::get_instance();
-        env.build();
+        env.build(stats);
         return EXIT_SUCCESS;
     } catch (const std::exception &e) {
         std::cerr << e.what() << '\n';
@@ -59,10 +333,10 @@ int build() {
     }
 }
 
-int run() {
+int run(const bool &stats) {
     try {
         auto &env = Env::get_instance();
-        env.build();
+        env.build(stats);
         env.run();
         return EXIT_SUCCESS;
     } catch (const std::exception &e) {
@@ -90,10 +364,12 @@ int main(int argc, char *argv[]) {
         version();
     } else if (strcmp(argv[1], "new") == 0 && argc > 2) {
         new_project(argv[2]);
+    } else if (strcmp(argv[1], "bench") == 0 && argc > 2) {
+        return bench(argv[2]);
     } else if (strcmp(argv[1], "build") == 0 ) {
-        return build();
+        return build(argc > 2 && strcmp(argv[2], "--stats") == 0);
     } else if (strcmp(argv[1], "run") == 0) {
-        return run();
+        return run(argc > 2 && strcmp(argv[2], "--stats") == 0);
     } else {
         std::string full_cmd = "";
         for (int i = 0; i < argc; ++i) {
@@ -0,0 +1,55 @@
+#include <program/arena.h>
+
+Arena::Arena() {
+    used = 0;
+    capacity = 0;
+    objects = 0;
+    bytes = 0;
+}
+
+const std::string_view Arena::copy(const std::string_view &text) {
+    if (text.empty()) return std::string_view();
+    char *dst = static_cast<char*>(allocate(text.length(), 1));
+    std::memcpy(dst, text.data(), text.length());
+    return std::string_view(dst, text.length());
+}
+
+void Arena::reset() {
+    blocks.clear();
+    used = 0;
+    capacity = 0;
+    objects = 0;
+    bytes = 0;
+}
+
+void Arena::adopt(Arena &other) {
+    if (blocks.empty()) {
+        used = other.used;
+        capacity = other.capacity;
+        blocks.swap(other.blocks);
+    } else {
+        blocks.insert(blocks.end() - 1, std::make_move_iterator(other.blocks.begin()), std::make_move_iterator(other.blocks.end()));
+    }
+    objects += other.objects;
+    bytes += other.bytes;
+    other.reset();
+}
+
+const size_t& Arena::get_objects() const {
+    return objects;
+}
+
+const size_t& Arena::get_bytes() const {
+    return bytes;
+}
+
+const size_t Arena::get_blocks() const {
+    return blocks.size();
+}
+
+// Requests larger than a block get a block of their own.
+void Arena::grow(const size_t &size) {
+    capacity = std::max(block_size, size);
+    blocks.emplace_back(new char[capacity]);
+    used = 0;
+}
\ No newline at end of file
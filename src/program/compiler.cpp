@@ -67,81 +67,40 @@ void Compiler::compile(const IRGenerator &ir_generator) {
         }
     }
     file_stream << '\n';
-    file_stream << "exit:" << '\n';
-    file_stream << '\t' << "leave" << '\n';
-    file_stream << '\t' << "ret" << '\n';
     for (const auto &d : ir_generator.get_text().declarations) {
         if (const auto *entry = dynamic_cast<const IRGenerator::Entry*>(d.get())) {
             file_stream << entry->id << ':' << '\n';
-            for (const auto &instruction : entry->instructions) {
-                compile_instruction(instruction.get());
-            }
-        }
-    }
-    for (const auto &d : ir_generator.get_labels()) {
-        if (const auto *entry = dynamic_cast<const IRGenerator::Entry*>(d.get())) {
-            file_stream << entry->id << ':' << '\n';
-            for (const auto &instruction : entry->instructions) {
-                compile_instruction(instruction.get());
+            // The generator's instructions are left as logged, above level 0
+            // a copy is cleaned up before it is written.
+            std::vector<IRGenerator::Instruction> instructions = entry->instructions;
+            if (ir_generator.get_level() > 0) peephole.run(instructions);
+            for (const auto &instruction : instructions) {
+                compile_instruction(instruction);
             }
         }
     }
 }
 
-void Compiler::compile_instruction(const IRGenerator::Instruction *instruction) {
-    if (const auto *push_instr = dynamic_cast<const IRGenerator::Push*>(instruction)) {
-        file_stream << '\t' << "push " << push_instr->src << '\n';
-    } else if (const auto *mov_instr = dynamic_cast<const IRGenerator::Mov*>(instruction)) {
-        file_stream << '\t' << "mov " << mov_instr->dst << ", " << mov_instr->src << '\n';
-    } else if (const auto *movsx_instr = dynamic_cast<const IRGenerator::Movsx*>(instruction)) {
-        file_stream << '\t' << "movsx " << movsx_instr->dst << ", " << movsx_instr->src << '\n';
-    } else if (const auto *lea_instr = dynamic_cast<const IRGenerator::Lea*>(instruction)) {
-        file_stream << '\t' << "lea " << lea_instr->dst << ", " << lea_instr->src << '\n';
-    } else if (const auto *neg_instr = dynamic_cast<const IRGenerator::Neg*>(instruction)) {
-        file_stream << '\t' << "neg " << neg_instr->dst << '\n';
-    } else if (const auto *imul_instr = dynamic_cast<const IRGenerator::Imul*>(instruction)) {
-        file_stream << '\t' << "imul " << imul_instr->dst << ", " << imul_instr->src << '\n';
-    } else if (const auto *idiv_instr = dynamic_cast<const IRGenerator::Idiv*>(instruction)) {
-        file_stream << '\t' << "idiv " << idiv_instr->src << '\n';
-    } else if (const auto *add_instr = dynamic_cast<const IRGenerator::Add*>(instruction)) {
-        file_stream << '\t' << "add " << add_instr->dst << ", " << add_instr->src << '\n';
-    } else if (const auto *sub_instr = dynamic_cast<const IRGenerator::Sub*>(instruction)) {
-        file_stream << '\t' << "sub " << sub_instr->dst << ", " << sub_instr->src << '\n';
-    } else if (const auto *cmp_instr = dynamic_cast<const IRGenerator::Cmp*>(instruction)) {
-        file_stream << '\t' << "cmp " << cmp_instr->left << ", " << cmp_instr->right << '\n';
-    } else if (const auto *sete_instr = dynamic_cast<const IRGenerator::Sete*>(instruction)) {
-        file_stream << '\t' << "sete " << sete_instr->dst << '\n';
-    } else if (const auto *setne_instr = dynamic_cast<const IRGenerator::Setne*>(instruction)) {
-        file_stream << '\t' << "setne " << setne_instr->dst << '\n';
-    } else if (const auto *setg_instr = dynamic_cast<const IRGenerator::Setg*>(instruction)) {
-        file_stream << '\t' << "setg " << setg_instr->dst << '\n';
-    } else if (const auto *setge_instr = dynamic_cast<const IRGenerator::Setge*>(instruction)) {
-        file_stream << '\t' << "setge " << setge_instr->dst << '\n';
-    } else if (const auto *setl_instr = dynamic_cast<const IRGenerator::Setl*>(instruction)) {
-        file_stream << '\t' << "setl " << setl_instr->dst << '\n';
-    } else if (const auto *setle_instr = dynamic_cast<const IRGenerator::Setle*>(instruction)) {
-        file_stream << '\t' << "setle " << setle_instr->dst << '\n';
-    } else if (const auto *cmove_instr = dynamic_cast<const IRGenerator::Cmove*>(instruction)) {
-        file_stream << '\t' << "cmove " << cmove_instr->dst << ", " << cmove_instr->src << '\n';
-    } else if (const auto *xor_instr = dynamic_cast<const IRGenerator::Xor*>(instruction)) {
-        file_stream << '\t' << "xor " << xor_instr->dst << ", " << xor_instr->src << '\n';
-    } else if (const auto *label_instr = dynamic_cast<const IRGenerator::Label*>(instruction)) {
-        file_stream << label_instr->id << ":" << '\n';
-    } else if (const auto *jmp_instr = dynamic_cast<const IRGenerator::Jmp*>(instruction)) {
-        file_stream << '\t' << "jmp " << jmp_instr->dst << '\n';
-    } else if (const auto *je_instr = dynamic_cast<const IRGenerator::Je*>(instruction)) {
-        file_stream << '\t' << "je " << je_instr->dst << '\n';
-    } else if (const auto *jne_instr = dynamic_cast<const IRGenerator::Jne*>(instruction)) {
-        file_stream << '\t' << "jne " << jne_instr->dst << '\n';
-    } else if (const auto *leave_instr = dynamic_cast<const IRGenerator::Leave*>(instruction)) {
-        file_stream << '\t' << "leave" << '\n';
-    } else if (const auto *ret_instr = dynamic_cast<const IRGenerator::Ret*>(instruction)) {
-        file_stream << '\t' << "ret" << '\n';
-    } else if (const auto *call_instr = dynamic_cast<const IRGenerator::Call*>(instruction)) {
-        file_stream << '\t' << "call " << call_instr->id << '\n';
+// Instructions are written as their mnemonic followed by their operands,
+// labels as the label itself.
+void Compiler::compile_instruction(const IRGenerator::Instruction &instruction) {
+    switch (instruction.op) {
+        case IRGenerator::Instruction::LABEL:
+            file_stream << instruction.dst << ':' << '\n';
+            break;
+        default:
+            file_stream << '\t' << instruction.get_mnemonic();
+            if (instruction.dst.kind != Operand::NONE) file_stream << ' ' << instruction.dst;
+            if (instruction.src.kind != Operand::NONE) file_stream << ", " << instruction.src;
+            file_stream << '\n';
+            break;
     }
 }
 
 const bool& Compiler::get_success() const {
     return success;
+}
+
+const Peephole& Compiler::get_peephole() const {
+    return peephole;
 }
\ No newline at end of file
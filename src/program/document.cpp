@@ -0,0 +1,82 @@
+#include <program/document.h>
+
+Document::Document(const std::string &fp) : source(fp) {
+    success = false;
+    incremental = false;
+    elapsed = 0.0;
+
+    if (!source.get_success()) return;
+
+    const auto start = std::chrono::high_resolution_clock::now();
+    rebuild();
+    const auto end = std::chrono::high_resolution_clock::now();
+    elapsed = std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+// Replaces 'removed' bytes at 'offset' with 'text'.
+void Document::edit(const size_t &offset, const size_t &removed, const std::string_view &text) {
+    const auto start = std::chrono::high_resolution_clock::now();
+
+    const size_t length = source.get().length();
+    const size_t erased = offset < length ? std::min(removed, length - offset) : 0;
+    source.replace(offset, erased, text);
+
+    incremental = success;
+    if (incremental) {
+        try {
+            parser->reparse(lexer->relex(offset, erased, text.length()));
+        } catch (const std::exception &e) {
+            std::cerr << e.what() << '\n';
+            success = false;
+        }
+    } else {
+        rebuild();
+    }
+
+    const auto end = std::chrono::high_resolution_clock::now();
+    elapsed = std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+void Document::rebuild() {
+    parser.reset();
+    lexer.reset();
+    success = false;
+
+    try {
+        lexer = std::make_unique<Lexer>(source);
+        parser = std::make_unique<Parser>(*lexer);
+        success = true;
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << '\n';
+    }
+}
+
+const Source& Document::get_source() const {
+    return source;
+}
+
+const Lexer& Document::get_lexer() const {
+    return *lexer;
+}
+
+const Parser& Document::get_parser() const {
+    return *parser;
+}
+
+const bool& Document::get_success() const {
+    return success;
+}
+
+const bool& Document::get_incremental() const {
+    return incremental;
+}
+
+const double& Document::get_elapsed() const {
+    return elapsed;
+}
+
+void Document::log() const {
+    std::cout << " -- Document result -- " << '\n';
+    std::cout << (success ? "Up to date" : "Out of date") << " after a" << (incremental ? "n incremental" : " full") << " pass in " << elapsed << " ms" << '\n';
+    std::cout << '\n';
+}
\ No newline at end of file
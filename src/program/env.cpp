@@ -1,6 +1,6 @@
 #include <program/env.h>
 
-Env::Env() {}
+Env::Env() : stats(false) {}
 
 Env::~Env() {
     for (const auto &object : registry.get_objects()) {
@@ -13,7 +13,8 @@ Env& Env::get_instance() {
     return instance;
 }
 
-void Env::build() {
+void Env::build(const bool &stats) {
+    this->stats = stats;
     if (system == SYSTEM_WIN64) {
         const nlohmann::json project = Utils::read_json("project.json");
 
@@ -67,7 +68,7 @@ Object* Env::request(const std::string &id) {
         const nlohmann::json project = Utils::read_json("project.json");
         std::string obj_dir = project["detail"]["out"].get<std::string>();
         
-        Object *object = new Object(id, obj_dir);
+        Object *object = new Object(id, obj_dir, stats);
         object->build();
 
         registry.push_object(id, object);
@@ -0,0 +1,622 @@
+#include <program/flat_ast.h>
+
+static constexpr char magic[8] = {'L', 'O', 'S', 'A', 'S', 'T', '\0', '\0'};
+
+// A table on disk is its element count followed by its bytes, padded to a
+// multiple of 8.
+template <typename C>
+static void write_table(std::ofstream &out, const C &table) {
+    static const char padding[8] = {};
+    const uint64_t count = table.size();
+    const size_t size = sizeof(typename C::value_type) * table.size();
+    out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+    out.write(reinterpret_cast<const char*>(table.data()), size);
+    out.write(padding, (8 - size % 8) % 8);
+}
+
+template <typename C>
+static bool read_table(const std::string_view &raw, size_t &at, C &table) {
+    uint64_t count;
+    if (raw.length() - at < sizeof(count)) return false;
+    std::memcpy(&count, raw.data() + at, sizeof(count));
+    at += sizeof(count);
+
+    const size_t width = sizeof(typename C::value_type);
+    if (count > (raw.length() - at) / width) return false;
+    const size_t size = width * count;
+    table.resize(count);
+    if (size > 0) std::memcpy(table.data(), raw.data() + at, size);
+    at = std::min(raw.length(), at + (size + 7) / 8 * 8);
+    return true;
+}
+
+FlatAst::FlatAst(const Parser &parser) {
+    success = true;
+    // Every absent child refers to the one EmptyStatement at index 0.
+    push(Parser::Node::EMPTY_STATEMENT, 0);
+    for (const auto &n : parser.get()) {
+        roots.push_back(flatten(n));
+    }
+    pending.clear();
+    pending.shrink_to_fit();
+}
+
+FlatAst::FlatAst(const Source &cache, const uint64_t &key) {
+    success = cache.get_success() && load(cache.get(), key) && validate();
+    if (!success) {
+        nodes.clear();
+        roots.clear();
+    }
+}
+
+// 64-bit FNV-1a over 8 byte words, with a shift after each step so high bits
+// feed back into the low ones.
+const uint64_t FlatAst::get_key(const std::string_view &text, const std::string &version) {
+    uint64_t h = 14695981039346656037ull;
+    const auto mix = [&h](const uint64_t &word) {
+        h = (h ^ word) * 1099511628211ull;
+        h ^= h >> 29;
+    };
+    const auto mix_text = [&mix](const std::string_view &value) {
+        size_t i = 0;
+        for (; i + 8 <= value.length(); i += 8) {
+            uint64_t word;
+            std::memcpy(&word, value.data() + i, 8);
+            mix(word);
+        }
+        uint64_t tail = 0;
+        if (i < value.length()) std::memcpy(&tail, value.data() + i, value.length() - i);
+        mix(tail);
+        mix(value.length());
+    };
+
+    mix(format);
+    mix_text(version);
+    mix_text(text);
+    return h;
+}
+
+const bool FlatAst::save(const std::string &fp, const uint64_t &key) const {
+    const std::string temp = fp + ".tmp";
+    {
+        std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+        if (!out) return false;
+
+        const uint32_t reserved = 0;
+        out.write(magic, sizeof(magic));
+        out.write(reinterpret_cast<const char*>(&format), sizeof(format));
+        out.write(reinterpret_cast<const char*>(&reserved), sizeof(reserved));
+        out.write(reinterpret_cast<const char*>(&key), sizeof(key));
+
+        write_table(out, nodes);
+        write_table(out, roots);
+        write_table(out, binaries);
+        write_table(out, casts);
+        write_table(out, unaries);
+        write_table(out, declarations);
+        write_table(out, assignments);
+        write_table(out, functions);
+        write_table(out, calls);
+        write_table(out, conditionals);
+        write_table(out, scopes);
+        write_table(out, loops);
+        write_table(out, blocks);
+        write_table(out, lists);
+        write_table(out, names);
+        write_table(out, text);
+        if (!out) return false;
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temp, fp, error);
+    if (error) {
+        std::filesystem::remove(temp, error);
+        return false;
+    }
+    return true;
+}
+
+const bool& FlatAst::get_success() const {
+    return success;
+}
+
+const std::vector<FlatAst::Node>& FlatAst::get_nodes() const {
+    return nodes;
+}
+
+const std::vector<FlatAst::Index>& FlatAst::get_roots() const {
+    return roots;
+}
+
+const std::string_view FlatAst::get_name(const Index &i) const {
+    return std::string_view(text).substr(names[i].offset, names[i].length);
+}
+
+const size_t FlatAst::get_bytes() const {
+    return nodes.size() * sizeof(Node) + roots.size() * sizeof(Index) +
+        binaries.size() * sizeof(Binary) + casts.size() * sizeof(Cast) + unaries.size() * sizeof(Unary) +
+        declarations.size() * sizeof(Declaration) + assignments.size() * sizeof(Assignment) +
+        functions.size() * sizeof(Function) + calls.size() * sizeof(Call) + conditionals.size() * sizeof(Conditional) +
+        scopes.size() * sizeof(List) + loops.size() * sizeof(Loop) + blocks.size() * sizeof(Block) +
+        lists.size() * sizeof(Index) + names.size() * sizeof(Name) + text.size();
+}
+
+// Walks the tree children first with an explicit stack, so trees as deep as
+// long operator chains do not exhaust the call stack. Each flattened node
+// leaves its index on 'pending', where its parent takes it from in build().
+const FlatAst::Index FlatAst::flatten(const Parser::Node *root) {
+    std::vector<std::pair<const Parser::Node*, bool>> stack = {{root, false}};
+    const auto visit = [&stack](const Parser::Node *child) {
+        stack.push_back({child, false});
+    };
+
+    while (!stack.empty()) {
+        const auto [node, expanded] = stack.back();
+        if (expanded) {
+            stack.pop_back();
+            pending.push_back(build(node));
+            continue;
+        }
+        stack.back().second = true;
+
+        // Children go on in reverse, so they are flattened left to right.
+        switch (node->kind) {
+            case Parser::Node::BINARY_OPERATION:
+                visit(static_cast<const Parser::BinaryOperation*>(node)->right);
+                visit(static_cast<const Parser::BinaryOperation*>(node)->left);
+                break;
+            case Parser::Node::CAST_OPERATION:
+                visit(static_cast<const Parser::CastOperation*>(node)->left);
+                break;
+            case Parser::Node::UNARY_OPERATION:
+                visit(static_cast<const Parser::UnaryOperation*>(node)->value);
+                break;
+            case Parser::Node::VARIABLE_DECLARATION:
+                visit(static_cast<const Parser::VariableDeclaration*>(node)->expr);
+                break;
+            case Parser::Node::VARIABLE_ASSIGNMENT:
+                visit(static_cast<const Parser::VariableAssignment*>(node)->expr);
+                break;
+            case Parser::Node::FUNCTION_DECLARATION:
+                visit(static_cast<const Parser::FunctionDeclaration*>(node)->statement);
+                break;
+            case Parser::Node::RETURN_STATEMENT:
+                visit(static_cast<const Parser::ReturnStatement*>(node)->expr);
+                break;
+            case Parser::Node::FUNCTION_CALL: {
+                const auto &args = static_cast<const Parser::FunctionCall*>(node)->args;
+                for (size_t k = args.size(); k-- > 0;) visit(args[k]);
+                break;
+            }
+            case Parser::Node::CONDITIONAL_STATEMENT:
+                visit(static_cast<const Parser::ConditionalStatement*>(node)->fail_statement);
+                visit(static_cast<const Parser::ConditionalStatement*>(node)->pass_statement);
+                visit(static_cast<const Parser::ConditionalStatement*>(node)->condition);
+                break;
+            case Parser::Node::SCOPE_DECLARATION: {
+                const auto &ast = static_cast<const Parser::ScopeDeclaration*>(node)->ast;
+                for (size_t k = ast.size(); k-- > 0;) visit(ast[k]);
+                break;
+            }
+            case Parser::Node::WHILE_LOOP_STATEMENT:
+                visit(static_cast<const Parser::WhileLoopStatement*>(node)->statement);
+                visit(static_cast<const Parser::WhileLoopStatement*>(node)->condition);
+                break;
+            case Parser::Node::CLASS_MEMBER:
+                visit(static_cast<const Parser::ClassMember*>(node)->statement);
+                break;
+            case Parser::Node::CLASS_DECLARATION:
+                visit(static_cast<const Parser::ClassDeclaration*>(node)->statement);
+                break;
+            case Parser::Node::MODULE:
+                visit(static_cast<const Parser::Module*>(node)->statement);
+                break;
+            default:
+                break;
+        }
+    }
+
+    return take();
+}
+
+// Builds 'node' from the indices of its children on 'pending', list children
+// are moved into 'lists' so each list ends up contiguous.
+const FlatAst::Index FlatAst::build(const Parser::Node *node) {
+    switch (node->kind) {
+        case Parser::Node::BINARY_OPERATION: {
+            const auto *operation = static_cast<const Parser::BinaryOperation*>(node);
+            const Index right = take();
+            const Index left = take();
+            binaries.push_back({left, add(operation->op), right});
+            return push(node->kind, binaries.size() - 1);
+        }
+        case Parser::Node::CAST_OPERATION: {
+            const auto *operation = static_cast<const Parser::CastOperation*>(node);
+            const Index left = take();
+            casts.push_back({left, add(operation->right)});
+            return push(node->kind, casts.size() - 1);
+        }
+        case Parser::Node::UNARY_OPERATION: {
+            const auto *operation = static_cast<const Parser::UnaryOperation*>(node);
+            const Index value = take();
+            unaries.push_back({add(operation->op), value});
+            return push(node->kind, unaries.size() - 1);
+        }
+        case Parser::Node::INTEGER_LITERAL:
+            return push(node->kind, add(static_cast<const Parser::IntegerLiteral*>(node)->value));
+        case Parser::Node::FLOAT_LITERAL:
+            return push(node->kind, add(static_cast<const Parser::FloatLiteral*>(node)->value));
+        case Parser::Node::BOOLEAN_LITERAL:
+            return push(node->kind, 0, static_cast<const Parser::BooleanLiteral*>(node)->value);
+        case Parser::Node::STRING_LITERAL:
+            return push(node->kind, add(static_cast<const Parser::StringLiteral*>(node)->value));
+        case Parser::Node::VARIABLE_DECLARATION: {
+            const auto *decl = static_cast<const Parser::VariableDeclaration*>(node);
+            const Index expr = take();
+            declarations.push_back({add(decl->type), add(decl->identifier), expr});
+            return push(node->kind, declarations.size() - 1, decl->is_final);
+        }
+        case Parser::Node::VARIABLE_ASSIGNMENT: {
+            const auto *assign = static_cast<const Parser::VariableAssignment*>(node);
+            const Index expr = take();
+            assignments.push_back({add(assign->identifier), expr});
+            return push(node->kind, assignments.size() - 1);
+        }
+        case Parser::Node::VARIABLE_CALL:
+            return push(node->kind, add(static_cast<const Parser::VariableCall*>(node)->identifier));
+        case Parser::Node::FUNCTION_DECLARATION: {
+            const auto *decl = static_cast<const Parser::FunctionDeclaration*>(node);
+            const Index statement = take();
+            Function function = {add(decl->type), add(decl->identifier), static_cast<Index>(names.size()), static_cast<Index>(decl->args_ids.size()), statement};
+            for (size_t i = 0; i < decl->args_ids.size(); ++i) {
+                add(decl->args_types[i]);
+                add(decl->args_ids[i]);
+            }
+            functions.push_back(function);
+            return push(node->kind, functions.size() - 1);
+        }
+        case Parser::Node::RETURN_STATEMENT:
+            return push(node->kind, take());
+        case Parser::Node::FUNCTION_CALL: {
+            const auto *call = static_cast<const Parser::FunctionCall*>(node);
+            const List args = collect(pending.size() - call->args.size());
+            calls.push_back({add(call->identifier), args});
+            return push(node->kind, calls.size() - 1);
+        }
+        case Parser::Node::CONDITIONAL_STATEMENT: {
+            const Index fail = take();
+            const Index pass = take();
+            const Index condition = take();
+            conditionals.push_back({condition, pass, fail});
+            return push(node->kind, conditionals.size() - 1);
+        }
+        case Parser::Node::SCOPE_DECLARATION: {
+            const auto *scope = static_cast<const Parser::ScopeDeclaration*>(node);
+            scopes.push_back(collect(pending.size() - scope->ast.size()));
+            return push(node->kind, scopes.size() - 1);
+        }
+        case Parser::Node::EMPTY_STATEMENT:
+            return 0;
+        case Parser::Node::WHILE_LOOP_STATEMENT: {
+            const Index body = take();
+            const Index condition = take();
+            loops.push_back({condition, body});
+            return push(node->kind, loops.size() - 1);
+        }
+        case Parser::Node::CLASS_MEMBER: {
+            const auto *member = static_cast<const Parser::ClassMember*>(node);
+            return push(node->kind, take(), member->access);
+        }
+        case Parser::Node::CLASS_DECLARATION: {
+            const auto *decl = static_cast<const Parser::ClassDeclaration*>(node);
+            const Index statement = take();
+            blocks.push_back({add(decl->identifier), statement});
+            return push(node->kind, blocks.size() - 1);
+        }
+        case Parser::Node::EXTERN:
+            return push(node->kind, add(static_cast<const Parser::Extern*>(node)->id));
+        case Parser::Node::MODULE: {
+            const auto *mod = static_cast<const Parser::Module*>(node);
+            const Index statement = take();
+            blocks.push_back({add(mod->id), statement});
+            return push(node->kind, blocks.size() - 1);
+        }
+    }
+    throw std::runtime_error("Unexpected node encountered.");
+}
+
+const FlatAst::Index FlatAst::take() {
+    const Index i = pending.back();
+    pending.pop_back();
+    return i;
+}
+
+// Moves the children pending since 'base' into 'lists'.
+const FlatAst::List FlatAst::collect(const size_t &base) {
+    const List list = {static_cast<Index>(lists.size()), static_cast<Index>(pending.size() - base)};
+    lists.insert(lists.end(), pending.begin() + base, pending.end());
+    pending.resize(base);
+    return list;
+}
+
+const FlatAst::Index FlatAst::add(const std::string_view &name) {
+    names.push_back({static_cast<uint32_t>(text.size()), static_cast<uint32_t>(name.length())});
+    text += name;
+    return names.size() - 1;
+}
+
+const FlatAst::Index FlatAst::push(const Parser::Node::Kind &kind, const Index &data, const uint8_t &flag) {
+    Node node;
+    node.kind = kind;
+    node.flag = flag;
+    node.data = data;
+    nodes.push_back(node);
+    return nodes.size() - 1;
+}
+
+const bool FlatAst::load(const std::string_view &raw, const uint64_t &key) {
+    const size_t header = sizeof(magic) + sizeof(uint32_t) * 2 + sizeof(uint64_t);
+    if (raw.length() < header || std::memcmp(raw.data(), magic, sizeof(magic)) != 0) return false;
+
+    uint32_t stored_format;
+    uint64_t stored_key;
+    std::memcpy(&stored_format, raw.data() + sizeof(magic), sizeof(stored_format));
+    std::memcpy(&stored_key, raw.data() + sizeof(magic) + sizeof(uint32_t) * 2, sizeof(stored_key));
+    if (stored_format != format || stored_key != key) return false;
+
+    size_t at = header;
+    return read_table(raw, at, nodes) && read_table(raw, at, roots) &&
+        read_table(raw, at, binaries) && read_table(raw, at, casts) && read_table(raw, at, unaries) &&
+        read_table(raw, at, declarations) && read_table(raw, at, assignments) && read_table(raw, at, functions) &&
+        read_table(raw, at, calls) && read_table(raw, at, conditionals) && read_table(raw, at, scopes) &&
+        read_table(raw, at, loops) && read_table(raw, at, blocks) &&
+        read_table(raw, at, lists) && read_table(raw, at, names) && read_table(raw, at, text) &&
+        at == raw.length();
+}
+
+// A loaded tree is only expanded if every index stays in range and children
+// come before their parents, so a damaged cache is rejected rather than read
+// out of bounds.
+const bool FlatAst::validate() const {
+    const auto name = [this](const Index &i) {
+        return i < names.size();
+    };
+    const auto list = [this](const List &l) {
+        return l.first <= lists.size() && l.count <= lists.size() - l.first;
+    };
+
+    for (const auto &n : names) {
+        if (n.offset > text.size() || n.length > text.size() - n.offset) return false;
+    }
+    for (const auto &root : roots) {
+        if (root >= nodes.size()) return false;
+    }
+    if (nodes.empty() || nodes[0].kind != Parser::Node::EMPTY_STATEMENT) return false;
+
+    for (Index i = 0; i < nodes.size(); ++i) {
+        const Node &node = nodes[i];
+        bool valid = false;
+        switch (node.kind) {
+            case Parser::Node::BINARY_OPERATION:
+                valid = node.data < binaries.size() && name(binaries[node.data].op);
+                break;
+            case Parser::Node::CAST_OPERATION:
+                valid = node.data < casts.size() && name(casts[node.data].type);
+                break;
+            case Parser::Node::UNARY_OPERATION:
+                valid = node.data < unaries.size() && name(unaries[node.data].op);
+                break;
+            case Parser::Node::INTEGER_LITERAL:
+            case Parser::Node::FLOAT_LITERAL:
+            case Parser::Node::STRING_LITERAL:
+            case Parser::Node::VARIABLE_CALL:
+            case Parser::Node::EXTERN:
+                valid = name(node.data);
+                break;
+            case Parser::Node::BOOLEAN_LITERAL:
+            case Parser::Node::EMPTY_STATEMENT:
+                valid = true;
+                break;
+            case Parser::Node::VARIABLE_DECLARATION:
+                valid = node.data < declarations.size() && name(declarations[node.data].type) && name(declarations[node.data].identifier);
+                break;
+            case Parser::Node::VARIABLE_ASSIGNMENT:
+                valid = node.data < assignments.size() && name(assignments[node.data].identifier);
+                break;
+            case Parser::Node::FUNCTION_DECLARATION:
+                valid = node.data < functions.size() && name(functions[node.data].type) && name(functions[node.data].identifier) &&
+                    functions[node.data].args <= names.size() && functions[node.data].count <= (names.size() - functions[node.data].args) / 2;
+                break;
+            case Parser::Node::RETURN_STATEMENT:
+            case Parser::Node::CLASS_MEMBER:
+                valid = node.data < i;
+                break;
+            case Parser::Node::FUNCTION_CALL:
+                valid = node.data < calls.size() && name(calls[node.data].identifier) && list(calls[node.data].args);
+                break;
+            case Parser::Node::CONDITIONAL_STATEMENT:
+                valid = node.data < conditionals.size();
+                break;
+            case Parser::Node::SCOPE_DECLARATION:
+                valid = node.data < scopes.size() && list(scopes[node.data]);
+                break;
+            case Parser::Node::WHILE_LOOP_STATEMENT:
+                valid = node.data < loops.size();
+                break;
+            case Parser::Node::CLASS_DECLARATION:
+            case Parser::Node::MODULE:
+                valid = node.data < blocks.size() && name(blocks[node.data].identifier);
+                break;
+        }
+        if (!valid) return false;
+
+        for_each_child(i, [&valid, &i](const Index &child) {
+            if (child >= i) valid = false;
+        });
+        if (!valid) return false;
+    }
+    return true;
+}
+
+// Children come first, so one pass front to back finds every child already
+// built when it reaches its parent.
+const std::vector<Parser::Node*> FlatAst::expand(Arena &arena) const {
+    std::vector<Parser::Node*> built(nodes.size(), nullptr);
+    std::vector<Parser::Node*> children;
+    std::vector<std::string_view> args_ids, args_types;
+
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        const Node &node = nodes[i];
+        switch (node.kind) {
+            case Parser::Node::BINARY_OPERATION: {
+                const Binary &b = binaries[node.data];
+                built[i] = arena.make<Parser::BinaryOperation>(built[b.left], get_name(b.op), built[b.right]);
+                break;
+            }
+            case Parser::Node::CAST_OPERATION: {
+                const Cast &c = casts[node.data];
+                built[i] = arena.make<Parser::CastOperation>(built[c.left], get_name(c.type));
+                break;
+            }
+            case Parser::Node::UNARY_OPERATION: {
+                const Unary &u = unaries[node.data];
+                built[i] = arena.make<Parser::UnaryOperation>(get_name(u.op), built[u.value]);
+                break;
+            }
+            case Parser::Node::INTEGER_LITERAL:
+                built[i] = arena.make<Parser::IntegerLiteral>(get_name(node.data));
+                break;
+            case Parser::Node::FLOAT_LITERAL:
+                built[i] = arena.make<Parser::FloatLiteral>(get_name(node.data));
+                break;
+            case Parser::Node::BOOLEAN_LITERAL:
+                built[i] = arena.make<Parser::BooleanLiteral>(node.flag != 0);
+                break;
+            case Parser::Node::STRING_LITERAL:
+                built[i] = arena.make<Parser::StringLiteral>(get_name(node.data));
+                break;
+            case Parser::Node::VARIABLE_DECLARATION: {
+                const Declaration &d = declarations[node.data];
+                auto *decl = arena.make<Parser::VariableDeclaration>(get_name(d.type), get_name(d.identifier), built[d.expr]);
+                decl->is_final = node.flag != 0;
+                built[i] = decl;
+                break;
+            }
+            case Parser::Node::VARIABLE_ASSIGNMENT: {
+                const Assignment &a = assignments[node.data];
+                built[i] = arena.make<Parser::VariableAssignment>(get_name(a.identifier), built[a.expr]);
+                break;
+            }
+            case Parser::Node::VARIABLE_CALL:
+                built[i] = arena.make<Parser::VariableCall>(get_name(node.data));
+                break;
+            case Parser::Node::FUNCTION_DECLARATION: {
+                const Function &f = functions[node.data];
+                auto *decl = arena.make<Parser::FunctionDeclaration>();
+                decl->type = get_name(f.type);
+                decl->identifier = get_name(f.identifier);
+                args_ids.clear();
+                args_types.clear();
+                for (Index k = 0; k < f.count; ++k) {
+                    args_types.push_back(get_name(f.args + k * 2));
+                    args_ids.push_back(get_name(f.args + k * 2 + 1));
+                }
+                decl->args_ids = arena.copy(args_ids.data(), args_ids.size());
+                decl->args_types = arena.copy(args_types.data(), args_types.size());
+                decl->statement = built[f.statement];
+                built[i] = decl;
+                break;
+            }
+            case Parser::Node::RETURN_STATEMENT:
+                built[i] = arena.make<Parser::ReturnStatement>(built[node.data]);
+                break;
+            case Parser::Node::FUNCTION_CALL: {
+                const Call &c = calls[node.data];
+                auto *call = arena.make<Parser::FunctionCall>(get_name(c.identifier));
+                children.clear();
+                for (Index k = 0; k < c.args.count; ++k) {
+                    children.push_back(built[lists[c.args.first + k]]);
+                }
+                call->args = arena.copy(children.data(), children.size());
+                built[i] = call;
+                break;
+            }
+            case Parser::Node::CONDITIONAL_STATEMENT: {
+                const Conditional &c = conditionals[node.data];
+                auto *statement = arena.make<Parser::ConditionalStatement>();
+                statement->condition = built[c.condition];
+                statement->pass_statement = built[c.pass];
+                statement->fail_statement = built[c.fail];
+                built[i] = statement;
+                break;
+            }
+            case Parser::Node::SCOPE_DECLARATION: {
+                const List &l = scopes[node.data];
+                auto *scope = arena.make<Parser::ScopeDeclaration>();
+                children.clear();
+                for (Index k = 0; k < l.count; ++k) {
+                    children.push_back(built[lists[l.first + k]]);
+                }
+                scope->ast = arena.copy(children.data(), children.size());
+                built[i] = scope;
+                break;
+            }
+            case Parser::Node::EMPTY_STATEMENT:
+                built[i] = arena.make<Parser::EmptyStatement>();
+                break;
+            case Parser::Node::WHILE_LOOP_STATEMENT: {
+                const Loop &l = loops[node.data];
+                auto *statement = arena.make<Parser::WhileLoopStatement>();
+                statement->condition = built[l.condition];
+                statement->statement = built[l.statement];
+                built[i] = statement;
+                break;
+            }
+            case Parser::Node::CLASS_MEMBER: {
+                auto *member = arena.make<Parser::ClassMember>();
+                member->statement = built[node.data];
+                member->access = static_cast<decltype(member->access)>(node.flag);
+                built[i] = member;
+                break;
+            }
+            case Parser::Node::CLASS_DECLARATION: {
+                const Block &b = blocks[node.data];
+                auto *decl = arena.make<Parser::ClassDeclaration>();
+                decl->identifier = get_name(b.identifier);
+                decl->statement = built[b.statement];
+                built[i] = decl;
+                break;
+            }
+            case Parser::Node::EXTERN:
+                built[i] = arena.make<Parser::Extern>(get_name(node.data));
+                break;
+            case Parser::Node::MODULE: {
+                const Block &b = blocks[node.data];
+                auto *mod = arena.make<Parser::Module>();
+                mod->id = get_name(b.identifier);
+                mod->statement = built[b.statement];
+                built[i] = mod;
+                break;
+            }
+        }
+    }
+
+    std::vector<Parser::Node*> ast;
+    for (const auto &root : roots) {
+        ast.push_back(built[root]);
+    }
+    return ast;
+}
+
+// Prints through the parser's nodes, so the output matches Parser::log.
+void FlatAst::log() const {
+    Arena arena;
+    std::cout << " -- Flat AST result -- " << '\n';
+    for (const auto &n : expand(arena)) {
+        n->log();
+        std::cout << '\n';
+    }
+    std::cout << '\n';
+    std::cout << "Stored " << nodes.size() << " node(s) in " << get_bytes() << " byte(s)" << '\n';
+    std::cout << '\n';
+}
\ No newline at end of file
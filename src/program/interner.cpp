@@ -0,0 +1,114 @@
+#include <program/interner.h>
+
+#include <algorithm>
+#include <cstring>
+
+Interner::Interner() {
+    block_used = 0;
+    block_size = 0;
+
+    slots.resize(256);
+    names.reserve(DYNAMIC);
+    for (const auto &name : fixed) {
+        names.push_back(name);
+    }
+    for (uint32_t id = NONE + 1; id < DYNAMIC; ++id) {
+        insert(hash(names[id]), id);
+    }
+}
+
+const uint32_t Interner::intern(const std::string_view &text) {
+    const uint32_t h = hash(text);
+    const size_t slot = locate(text, h);
+    if (slots[slot].id != NONE) {
+        return slots[slot].id;
+    }
+
+    const uint32_t id = static_cast<uint32_t>(names.size());
+    names.emplace_back(store(text), text.length());
+
+    // Keep the load factor under one half
+    if ((names.size() - 1) * 2 >= slots.size()) {
+        grow();
+        insert(h, id);
+    } else {
+        slots[slot] = {h, id};
+    }
+    return id;
+}
+
+const uint32_t Interner::find(const std::string_view &text) const {
+    return slots[locate(text, hash(text))].id;
+}
+
+const std::string_view Interner::get(const uint32_t &id) const {
+    if (id < names.size()) return names[id];
+    return std::string_view();
+}
+
+const size_t Interner::size() const {
+    return names.size();
+}
+
+// Mixes eight bytes per step, names are short so this is a handful of
+// multiplies instead of one per character.
+const uint32_t Interner::hash(const std::string_view &text) {
+    const auto mix = [](uint64_t h, const uint64_t &word) {
+        h = (h ^ word) * 0xbf58476d1ce4e5b9ull;
+        return h ^ (h >> 31);
+    };
+
+    uint64_t h = 0x9e3779b97f4a7c15ull ^ text.length();
+    size_t i = 0;
+    for (; i + 8 <= text.length(); i += 8) {
+        uint64_t word;
+        std::memcpy(&word, text.data() + i, 8);
+        h = mix(h, word);
+    }
+    if (i < text.length()) {
+        uint64_t word = 0;
+        for (size_t shift = 0; i < text.length(); ++i, shift += 8) {
+            word |= static_cast<uint64_t>(static_cast<uint8_t>(text[i])) << shift;
+        }
+        h = mix(h, word);
+    }
+    return static_cast<uint32_t>(h ^ (h >> 32));
+}
+
+const size_t Interner::locate(const std::string_view &text, const uint32_t &h) const {
+    const size_t mask = slots.size() - 1;
+    for (size_t i = h & mask;; i = (i + 1) & mask) {
+        const Slot &slot = slots[i];
+        if (slot.id == NONE) return i;
+        if (slot.hash == h && names[slot.id] == text) return i;
+    }
+}
+
+void Interner::insert(const uint32_t &h, const uint32_t &id) {
+    const size_t mask = slots.size() - 1;
+    size_t i = h & mask;
+    while (slots[i].id != NONE) {
+        i = (i + 1) & mask;
+    }
+    slots[i] = {h, id};
+}
+
+void Interner::grow() {
+    std::vector<Slot> old = std::move(slots);
+    slots.assign(old.size() * 2, Slot{0, NONE});
+    for (const auto &slot : old) {
+        if (slot.id != NONE) insert(slot.hash, slot.id);
+    }
+}
+
+const char* Interner::store(const std::string_view &text) {
+    if (block_used + text.length() > block_size) {
+        block_size = std::max<size_t>(4096, text.length());
+        blocks.push_back(std::make_unique<char[]>(block_size));
+        block_used = 0;
+    }
+    char *dst = blocks.back().get() + block_used;
+    std::copy(text.begin(), text.end(), dst);
+    block_used += text.length();
+    return dst;
+}
\ No newline at end of file
@@ -1,46 +1,118 @@
 #include <program/ir_generator.h>
 
-IRGenerator::IRGenerator(const Parser &parser) {
+#include <program/register_allocator.h>
+
+// Registers used at a fixed width.
+static const Operand rax = Operand::reg(Operand::RAX, 8);
+static const Operand rcx = Operand::reg(Operand::RCX, 8);
+static const Operand rdx = Operand::reg(Operand::RDX, 8);
+static const Operand rbp = Operand::reg(Operand::RBP, 8);
+static const Operand rsp = Operand::reg(Operand::RSP, 8);
+static const Operand cl = Operand::reg(Operand::RCX, 1);
+
+// Whether 'a' and 'b' are the same register or memory, at any width.
+static const bool same_place(const Operand &a, const Operand &b) {
+    if (a.kind != b.kind) return false;
+    if (a.kind == Operand::REGISTER) return a.base == b.base;
+    return a.kind == Operand::MEMORY && a.base == b.base && a.index == b.index && a.value == b.value && a.symbol == b.symbol;
+}
+
+static const bool is_signed(const IRGenerator::TypeInfo &type) {
+    return type.type == IRGenerator::INT;
+}
+
+// Comparison that holds exactly when 'op' does not.
+static Mir::Opcode negate(const Mir::Opcode &op) {
+    switch (op) {
+        case Mir::EQ: return Mir::NE;
+        case Mir::NE: return Mir::EQ;
+        case Mir::LT: return Mir::GE;
+        case Mir::LE: return Mir::GT;
+        case Mir::GT: return Mir::LE;
+        default: return Mir::LT;
+    }
+}
+
+// Jump to 'target' if comparison 'op' of operands of sign 'sign' held.
+static IRGenerator::Instruction jump_if(const Mir::Opcode &op, const bool &sign, const Operand &target) {
+    switch (op) {
+        case Mir::EQ: return IRGenerator::Je(target);
+        case Mir::NE: return IRGenerator::Jne(target);
+        case Mir::LT: return sign ? IRGenerator::Instruction(IRGenerator::Jl(target)) : IRGenerator::Jb(target);
+        case Mir::LE: return sign ? IRGenerator::Instruction(IRGenerator::Jle(target)) : IRGenerator::Jbe(target);
+        case Mir::GT: return sign ? IRGenerator::Instruction(IRGenerator::Jg(target)) : IRGenerator::Ja(target);
+        default: return sign ? IRGenerator::Instruction(IRGenerator::Jge(target)) : IRGenerator::Jae(target);
+    }
+}
+
+IRGenerator::IRGenerator(const Parser &parser, const int &level) : IRGenerator(parser.get(), level) {}
+
+IRGenerator::IRGenerator(const std::vector<Parser::Node*> &ast, const int &level) : level(level) {
     success = true;
-    while_ix = 0;
-    cnd_ix = 0;
-    generate_ir(parser.get());
+    elapsed = 0.0;
+    label_ix = 0;
+    pow_ix = 0;
+
+    const auto start = std::chrono::high_resolution_clock::now();
+    generate_ir(ast);
+    const auto end = std::chrono::high_resolution_clock::now();
+
+    elapsed = std::chrono::duration<double, std::milli>(end - start).count();
 }
 
-void IRGenerator::generate_ir(const std::vector<std::unique_ptr<Parser::Node>> &ast) {
+// Builds the MIR of every function, then lowers each to instructions. The
+// entries in 'text' are those of the functions, in the same order.
+void IRGenerator::generate_ir(const std::vector<Parser::Node*> &ast) {
     for (const auto &t : ast) {
-        evaluate_global_statement(t.get());
+        evaluate_global_statement(t);
+    }
+
+    for (size_t i = 0; i < mir.functions.size(); ++i) {
+        mir.functions[i].promote();
+        if (level > 0) {
+            mir.functions[i].propagate_constants();
+            removed.push_back(mir.functions[i].remove_dead_code());
+        }
+        lower_function(mir.functions[i], static_cast<Entry*>(text.declarations[i].get()));
     }
 }
 
 void IRGenerator::evaluate_global_statement(const Parser::Node *statement) {
-    if (const auto *lib = dynamic_cast<const Parser::Extern*>(statement)) {
-        std::cout << lib->id << '\n';
-    } else if (const auto *mod = dynamic_cast<const Parser::Module*>(statement)) {
-        evaluate_module(mod);
-    } else if (const auto *decl = dynamic_cast<const Parser::FunctionDeclaration*>(statement)) {
-        evaluate_function_declaration(decl);
-    } else if (const auto *decl = dynamic_cast<const Parser::ClassDeclaration*>(statement)) {
-        evaluate_class_declaration(decl);
-    } else if (const auto *empty = dynamic_cast<const Parser::EmptyStatement*>(statement)) {
-    } else {
-        success = false;
-        throw std::runtime_error("Unexpected global statement encountered.");
+    switch (statement->kind) {
+        case Parser::Node::EXTERN:
+            std::cout << static_cast<const Parser::Extern*>(statement)->id << '\n';
+            break;
+        case Parser::Node::MODULE:
+            evaluate_module(static_cast<const Parser::Module*>(statement));
+            break;
+        case Parser::Node::FUNCTION_DECLARATION:
+            evaluate_function_declaration(static_cast<const Parser::FunctionDeclaration*>(statement));
+            break;
+        case Parser::Node::CLASS_DECLARATION:
+            evaluate_class_declaration(static_cast<const Parser::ClassDeclaration*>(statement));
+            break;
+        case Parser::Node::EMPTY_STATEMENT:
+            break;
+        default:
+            success = false;
+            throw std::runtime_error("Unexpected global statement encountered.");
     }
 }
 
 void IRGenerator::evaluate_module(const Parser::Module *mod) {
-    if (const auto *scope = dynamic_cast<const Parser::ScopeDeclaration*>(mod->statement.get())) {
+    if (const auto *scope = mod->statement->as<Parser::ScopeDeclaration>()) {
         for (const auto &t : scope->ast) {
-            evaluate_global_statement(t.get());
+            evaluate_global_statement(t);
         }
     } else {
-        evaluate_global_statement(mod->statement.get());
+        evaluate_global_statement(mod->statement);
     }
 }
 
+// The entry is declared before the body is built, so functions can call
+// themselves. Arguments are stored to slots like locals are.
 void IRGenerator::evaluate_function_declaration(const Parser::FunctionDeclaration *decl) {
-    std::string identifier = decl->identifier;
+    std::string identifier(decl->identifier);
     bool is_main = identifier == "main" && decl->args_types.size() == 0;
     if (!is_main) {
         for (size_t i = 0; i < decl->args_ids.size(); ++i) {
@@ -51,514 +123,985 @@ void IRGenerator::evaluate_function_declaration(const Parser::FunctionDeclaratio
 
     auto entry = std::make_unique<Entry>(identifier);
     entry->type = decl->type;
+    text.declarations.push_back(std::move(entry));
 
-    if (!is_main) {
-        int offset = 16;
-        for (size_t i = 0; i < decl->args_ids.size(); ++i) {
-            StackEntry arg;
-            arg.type = get_type_info(decl->args_types[i]);
-            arg.offset = offset;
-            offset += arg.type.size;
-            entry->args_stack.keys.insert({decl->args_ids[i], arg});
-        }
-    }
+    mir.functions.emplace_back(identifier);
+    Mir::Function &function = mir.functions.back();
 
-    entry.get()->instructions.push_back(std::make_unique<Push>("rbp"));
-    entry.get()->instructions.push_back(std::make_unique<Mov>("rbp", "rsp"));
+    // main returns 0 unless it says otherwise.
+    return_type = TypeInfo();
+    if (decl->type != "void") return_type = get_type_info(std::string(decl->type));
+    else if (is_main) return_type = get_type_info("int32");
 
-    evaluate_wrapper_statement(decl->statement.get(), entry.get());
+    StackInfo stack_info;
+    for (size_t i = 0; i < decl->args_ids.size(); ++i) {
+        const std::string id(decl->args_ids[i]);
+        if (stack_info.exists(id)) {
+            success = false;
+            throw std::runtime_error("Variable already declared: '" + id + "'");
+        }
+        const auto type_info = get_type_info(std::string(decl->args_types[i]));
+        const uint32_t slot = function.add_slot(type_info.size, is_signed(type_info));
+        Mir::Inst arg(Mir::ARG, type_info.size, is_signed(type_info));
+        arg.value = i;
+        function.add(Mir::Inst(Mir::STORE, 0, false, function.add(arg)));
+        function.insts.back().value = slot;
+        stack_info.push(id, type_info, slot);
+    }
 
-    if (is_main) entry.get()->instructions.push_back(std::make_unique<Xor>("rax", "rax"));
-    entry.get()->instructions.push_back(std::make_unique<Jmp>("exit"));
+    evaluate_wrapper_statement(decl->statement, function, stack_info);
 
-    text.declarations.push_back(std::move(entry));
+    function.ret(return_type.size > 0 ? add_constant(function, 0, return_type) : Mir::none);
 }
 
+// Classes only lay out their members so far, no code is generated for them.
 void IRGenerator::evaluate_class_declaration(const Parser::ClassDeclaration *decl) {
-    auto class_info = std::make_unique<ClassInfo>(decl->identifier);
-
-    std::string identifier = get_hash(decl->identifier, "f");
-
-    auto declarator = std::make_unique<Entry>(identifier);
-    declarator->type = "declarator";
-
-    declarator->instructions.push_back(std::make_unique<Push>("rbp"));
-    declarator->instructions.push_back(std::make_unique<Mov>("rbp", "rsp"));
-    declarator->instructions.push_back(std::make_unique<Sub>("rsp", std::to_string(32)));
+    auto class_info = std::make_unique<ClassInfo>(std::string(decl->identifier));
 
-    declarator.get()->instructions.push_back(std::make_unique<Xor>("rax", "rax"));
-    declarator.get()->instructions.push_back(std::make_unique<Jmp>("exit"));
-
-    if (const auto *scope = dynamic_cast<const Parser::ScopeDeclaration*>(decl->statement.get())) {
+    if (const auto *scope = decl->statement->as<Parser::ScopeDeclaration>()) {
         for (const auto &t : scope->ast) {
-            evaluate_class_statement(t.get(), declarator.get(), class_info.get());
+            evaluate_class_statement(t, class_info.get());
         }
     } else {
-        evaluate_class_statement(decl->statement.get(), declarator.get(), class_info.get());
+        evaluate_class_statement(decl->statement, class_info.get());
     }
 
-    classes.insert({decl->identifier, std::move(class_info)});
+    classes.insert({std::string(decl->identifier), std::move(class_info)});
 }
 
-void IRGenerator::evaluate_class_statement(const Parser::Node *statement, Entry *declarator, ClassInfo *class_info) {
-    if (const auto *decl = dynamic_cast<const Parser::VariableDeclaration*>(statement)) {
-        evaluate_variable_declaration(decl, declarator, class_info->stack);
-    } else if (const auto *decl = dynamic_cast<const Parser::FunctionDeclaration*>(statement)) {
-    } else {
-        success = false;
-        throw std::runtime_error("Unexpected class statement encountered.");
+void IRGenerator::evaluate_class_statement(const Parser::Node *statement, ClassInfo *class_info) {
+    switch (statement->kind) {
+        case Parser::Node::VARIABLE_DECLARATION: {
+            const auto *decl = static_cast<const Parser::VariableDeclaration*>(statement);
+            const std::string id(decl->identifier);
+            if (!is_integral(std::string(decl->type)) && !is_class(std::string(decl->type))) {
+                success = false;
+                throw std::runtime_error("Could not evaluate unknown declaration: '" + id + "'");
+            }
+            if (class_info->stack.exists(id)) {
+                success = false;
+                throw std::runtime_error("Variable already declared: '" + id + "'");
+            }
+            const TypeInfo type_info = get_type_info(std::string(decl->type));
+            class_info->stack.size += type_info.size;
+            class_info->stack.push(id, type_info);
+            break;
+        }
+        case Parser::Node::FUNCTION_DECLARATION:
+            break;
+        default:
+            success = false;
+            throw std::runtime_error("Unexpected class statement encountered.");
     }
 }
 
-void IRGenerator::evaluate_wrapper_statement(const Parser::Node *statement, Entry *entry) {
-    StackInfo stack_info;
-    int alloc_at = entry->instructions.size();
-
-    if (const auto *decl = dynamic_cast<const Parser::ScopeDeclaration*>(statement)) {
+void IRGenerator::evaluate_wrapper_statement(const Parser::Node *statement, Mir::Function &function, StackInfo &stack_info) {
+    if (const auto *decl = statement->as<Parser::ScopeDeclaration>()) {
         for (const auto &t : decl->ast) {
-            evaluate_statement(t.get(), entry, stack_info);
+            evaluate_statement(t, function, stack_info);
         }
     } else {
-        evaluate_statement(statement, entry, stack_info);
+        evaluate_statement(statement, function, stack_info);
     }
-
-    stack_info.size = align_by(stack_info.size, 16);
-    entry->instructions.insert(entry->instructions.begin() + alloc_at, std::make_unique<Sub>("rsp", std::to_string(stack_info.size + 32)));
 }
 
-void IRGenerator::evaluate_statement(const Parser::Node *statement, Entry *entry, StackInfo &stack_info) {
-    if (const auto *decl = dynamic_cast<const Parser::ScopeDeclaration*>(statement)) {
-        StackInfo nested_stack_info = stack_info;
-        int alloc_at = entry->instructions.size();
-        for (const auto &t : decl->ast) {
-            evaluate_statement(t.get(), entry, nested_stack_info);
+void IRGenerator::evaluate_statement(const Parser::Node *statement, Mir::Function &function, StackInfo &stack_info) {
+    switch (statement->kind) {
+        case Parser::Node::SCOPE_DECLARATION: {
+            StackInfo nested_stack_info = stack_info;
+            evaluate_wrapper_statement(statement, function, nested_stack_info);
+            break;
         }
-        nested_stack_info.size = align_by(nested_stack_info.size, 16);
-        entry->instructions.insert(entry->instructions.begin() + alloc_at, std::make_unique<Sub>("rsp", std::to_string(nested_stack_info.size)));
-        entry->instructions.push_back(std::make_unique<Add>("rsp", std::to_string(nested_stack_info.size)));
-    } else if (const auto *exit = dynamic_cast<const Parser::ReturnStatement*>(statement)) {
-        if (const auto *empty = dynamic_cast<const Parser::EmptyStatement*>(exit->expr.get())) {
-            entry->instructions.push_back(std::make_unique<Jmp>("exit"));
-        } else {
-            const auto type_info = get_type_info(exit->expr.get(), entry, stack_info);
-            const auto reg = get_registry("rax", type_info.size);
-            entry->instructions.push_back(std::make_unique<Xor>("rax", "rax"));
-            evaluate_expr(exit->expr.get(), entry, reg, stack_info);
-            entry->instructions.push_back(std::make_unique<Jmp>("exit"));
+        case Parser::Node::RETURN_STATEMENT: {
+            // Statements after a return go to a block nothing jumps to.
+            const auto *exit = static_cast<const Parser::ReturnStatement*>(statement);
+            uint32_t value = Mir::none;
+            if (exit->expr->kind != Parser::Node::EMPTY_STATEMENT) {
+                const auto type_info = get_type_info(exit->expr, stack_info);
+                value = evaluate_expr(exit->expr, function, stack_info);
+                if (return_type.size > 0) value = convert(function, value, type_info, return_type);
+                else value = Mir::none;
+            } else if (return_type.size > 0) {
+                value = add_constant(function, 0, return_type);
+            }
+            function.ret(value);
+            function.current = function.add_block();
+            break;
         }
-    } else if (const auto *loop = dynamic_cast<const Parser::WhileLoopStatement*>(statement)) {
-        evaluate_while_statement(loop, entry, stack_info);
-    } else if (const auto *cnd = dynamic_cast<const Parser::ConditionalStatement*>(statement)) {
-        evaluate_conditional_statement(cnd, entry, stack_info);
-    } else if (const auto *call = dynamic_cast<const Parser::FunctionCall*>(statement)) {
-        evaluate_function_call(call, entry, "rax", stack_info);
-    } else if (const auto *decl = dynamic_cast<const Parser::VariableDeclaration*>(statement)) {
-        evaluate_variable_declaration(decl, entry, stack_info);
-    } else if (const auto *assign = dynamic_cast<const Parser::VariableAssignment*>(statement)) {
-        evaluate_variable_assignment(assign, entry, stack_info);
-    } else if (const auto *empty = dynamic_cast<const Parser::EmptyStatement*>(statement)) {
-    } else {
-        success = false;
-        throw std::runtime_error("Unexpected statement encountered.");
+        case Parser::Node::WHILE_LOOP_STATEMENT:
+            evaluate_while_statement(static_cast<const Parser::WhileLoopStatement*>(statement), function, stack_info);
+            break;
+        case Parser::Node::CONDITIONAL_STATEMENT:
+            evaluate_conditional_statement(static_cast<const Parser::ConditionalStatement*>(statement), function, stack_info);
+            break;
+        case Parser::Node::FUNCTION_CALL:
+            evaluate_function_call(static_cast<const Parser::FunctionCall*>(statement), function, stack_info);
+            break;
+        case Parser::Node::VARIABLE_DECLARATION:
+            evaluate_variable_declaration(static_cast<const Parser::VariableDeclaration*>(statement), function, stack_info);
+            break;
+        case Parser::Node::VARIABLE_ASSIGNMENT:
+            evaluate_variable_assignment(static_cast<const Parser::VariableAssignment*>(statement), function, stack_info);
+            break;
+        case Parser::Node::EMPTY_STATEMENT:
+            break;
+        default:
+            success = false;
+            throw std::runtime_error("Unexpected statement encountered.");
     }
 }
 
-void IRGenerator::evaluate_while_statement(const Parser::WhileLoopStatement *statement, Entry *entry, StackInfo &stack_info) {
-    std::string idc = ".wlc" + std::to_string(while_ix);
-    std::string idm = ".wlm" + std::to_string(while_ix);
-    std::string ide = ".wle" + std::to_string(while_ix);
+// The condition gets a block of its own that the body jumps back to.
+void IRGenerator::evaluate_while_statement(const Parser::WhileLoopStatement *statement, Mir::Function &function, StackInfo &stack_info) {
+    const uint32_t condition = function.add_block();
+    const uint32_t body = function.add_block();
+    const uint32_t end = function.add_block();
 
-    entry->instructions.push_back(std::make_unique<Jmp>(idc));
-    entry->instructions.push_back(std::make_unique<Label>(ide));
+    function.jump(condition);
+    function.current = condition;
+    evaluate_condition(statement->condition, body, end, function, stack_info);
 
+    function.current = body;
+    StackInfo nested_stack_info = stack_info;
+    evaluate_wrapper_statement(statement->statement, function, nested_stack_info);
+    function.jump(condition);
 
-    auto wlc = std::make_unique<Entry>(idc);
-    wlc->type = "void";
+    function.current = end;
+}
 
-    const std::string reg = get_registry("rcx", get_type_info(statement->condition.get(), wlc.get(), stack_info).size);
-    evaluate_expr(statement->condition.get(), wlc.get(), reg, stack_info);
-    wlc->instructions.push_back(std::make_unique<Cmp>(reg, "1"));
-    wlc->instructions.push_back(std::make_unique<Je>(idm));
-    wlc->instructions.push_back(std::make_unique<Jne>(ide));
+void IRGenerator::evaluate_conditional_statement(const Parser::ConditionalStatement *statement, Mir::Function &function, StackInfo &stack_info) {
+    const bool has_fail = statement->fail_statement->kind != Parser::Node::EMPTY_STATEMENT;
+    const uint32_t pass = function.add_block();
+    const uint32_t end = function.add_block();
+    const uint32_t fail = has_fail ? function.add_block() : end;
 
-    auto wlm = std::make_unique<Entry>(idm);
-    wlm->type = "void";
+    evaluate_condition(statement->condition, pass, fail, function, stack_info);
 
-    StackInfo nested_stack_info = stack_info;
-    int alloc_at = wlm->instructions.size();
+    function.current = pass;
+    StackInfo pass_stack_info = stack_info;
+    evaluate_wrapper_statement(statement->pass_statement, function, pass_stack_info);
+    function.jump(end);
 
-    if (const auto *decl = dynamic_cast<const Parser::ScopeDeclaration*>(statement->statement.get())) {
-        for (const auto &t : decl->ast) {
-            evaluate_statement(t.get(), wlm.get(), nested_stack_info);
+    if (has_fail) {
+        function.current = fail;
+        StackInfo fail_stack_info = stack_info;
+        evaluate_wrapper_statement(statement->fail_statement, function, fail_stack_info);
+        function.jump(end);
+    }
+
+    function.current = end;
+}
+
+// '&&' and '||' branch on their left operand before the right one is looked
+// at, and '!' swaps the targets, so only the operands of these end up as
+// values. A comparison branched on is lowered to a cmp and a jcc.
+void IRGenerator::evaluate_condition(const Parser::Node *condition, const uint32_t &pass, const uint32_t &fail, Mir::Function &function, StackInfo &stack_info) {
+    struct Target {
+        const Parser::Node *condition;
+        uint32_t block;
+        uint32_t pass;
+        uint32_t fail;
+    };
+    std::vector<Target> targets = {{condition, function.current, pass, fail}};
+    while (!targets.empty()) {
+        const Target target = targets.back();
+        targets.pop_back();
+        function.current = target.block;
+
+        if (target.condition->kind == Parser::Node::BINARY_OPERATION) {
+            const auto *operation = static_cast<const Parser::BinaryOperation*>(target.condition);
+            if (operation->op == "&&" || operation->op == "||") {
+                const uint32_t right = function.add_block();
+                if (operation->op == "&&") {
+                    targets.push_back({operation->right, right, target.pass, target.fail});
+                    targets.push_back({operation->left, target.block, right, target.fail});
+                } else {
+                    targets.push_back({operation->right, right, target.pass, target.fail});
+                    targets.push_back({operation->left, target.block, target.pass, right});
+                }
+                continue;
+            }
+        } else if (target.condition->kind == Parser::Node::UNARY_OPERATION) {
+            const auto *operation = static_cast<const Parser::UnaryOperation*>(target.condition);
+            if (operation->op == "!") {
+                targets.push_back({operation->value, target.block, target.fail, target.pass});
+                continue;
+            }
         }
-    } else {
-        evaluate_statement(statement->statement.get(), wlm.get(), nested_stack_info);
+        function.branch(evaluate_expr(target.condition, function, stack_info), target.pass, target.fail);
     }
+}
 
-    nested_stack_info.size = align_by(nested_stack_info.size, 16);
-    wlm->instructions.insert(wlm->instructions.begin() + alloc_at, std::make_unique<Sub>("rsp", std::to_string(nested_stack_info.size)));
-    wlm->instructions.push_back(std::make_unique<Add>("rsp", std::to_string(nested_stack_info.size)));
-    wlm->instructions.push_back(std::make_unique<Jmp>(idc));
+// printf prints each argument on its own and ends with a newline. Calls of
+// functions yield their value, or none for void functions.
+uint32_t IRGenerator::evaluate_function_call(const Parser::FunctionCall *call, Mir::Function &function, StackInfo &stack_info) {
+    if (call->identifier == "printf") {
+        add_extern("printf");
+        for (const auto &arg : call->args) {
+            function.add(Mir::Inst(Mir::PRINT, 0, false, evaluate_expr(arg, function, stack_info)));
+        }
+        function.add(Mir::Inst(Mir::PRINT, 0, false, add_string(function, "0xd, 0xa")));
+        return Mir::none;
+    }
 
-    labels.push_back(std::move(wlc));
-    labels.push_back(std::move(wlm));
+    std::string identifier(call->identifier);
+    for (const auto &arg : call->args) {
+        identifier += get_type_info(arg, stack_info).name;
+    }
+    identifier = get_hash(identifier, "f");
+
+    for (int i = 0; i < text.declarations.size(); ++i) {
+        if (auto *decl = dynamic_cast<Entry*>(text.declarations[i].get())) {
+            if (decl->id != identifier) continue;
+
+            // The identifier holds the argument types, so they match the
+            // declared ones.
+            Mir::Inst inst(Mir::CALL);
+            inst.symbol = symbols.copy(identifier);
+            for (const auto &arg : call->args) {
+                inst.args.push_back(evaluate_expr(arg, function, stack_info));
+            }
+            if (decl->type != "void") {
+                const auto type_info = get_type_info(decl->type);
+                inst.size = type_info.size;
+                inst.sign = is_signed(type_info);
+            }
+            const uint32_t value = function.add(inst);
+            return inst.size > 0 ? value : Mir::none;
+        }
+    }
 
-    ++while_ix;
+    success = false;
+    throw std::runtime_error("Function not declared or inaccessible: '" + std::string(call->identifier) + "'");
 }
 
-void IRGenerator::evaluate_conditional_statement(const Parser::ConditionalStatement *statement, Entry *entry, StackInfo &stack_info) {
-    const std::string reg = get_registry("rcx", get_type_info(statement->condition.get(), entry, stack_info).size);
-    evaluate_expr(statement->condition.get(), entry, reg, stack_info);
+void IRGenerator::evaluate_variable_declaration(const Parser::VariableDeclaration *decl, Mir::Function &function, StackInfo &stack_info) {
+    const std::string id(decl->identifier);
+    if (stack_info.exists(id)) {
+        success = false;
+        throw std::runtime_error("Variable already declared: '" + id + "'");
+    }
 
-    entry->instructions.push_back(std::make_unique<Cmp>(reg, "1"));
+    if (is_integral(std::string(decl->type))) {
+        const TypeInfo type_info = get_type_info(std::string(decl->type));
+        const uint32_t slot = function.add_slot(type_info.size, is_signed(type_info));
+        uint32_t value;
+        if (decl->expr->kind == Parser::Node::EMPTY_STATEMENT) {
+            if (decl->is_final) {
+                success = false;
+                throw std::runtime_error("Final variable not initialized: '" + id + "'");
+            }
+            value = add_constant(function, 0, type_info);
+        } else {
+            const auto expr_type = get_type_info(decl->expr, stack_info);
+            value = convert(function, evaluate_expr(decl->expr, function, stack_info), expr_type, type_info);
+        }
+        function.add(Mir::Inst(Mir::STORE, 0, false, value));
+        function.insts.back().value = slot;
+        stack_info.size += type_info.size;
+        stack_info.push(id, type_info, slot, decl->is_final);
+    } else if (is_class(std::string(decl->type))) {
+        const TypeInfo type_info = get_type_info(std::string(decl->type));
+        stack_info.size += type_info.size;
+        stack_info.push(id, type_info);
+    } else {
+        success = false;
+        throw std::runtime_error("Could not evaluate unknown declaration: '" + id + "'");
+    }
+}
 
-    std::string idm = ".cndm" + std::to_string(cnd_ix);
-    std::string ide = ".cnde" + std::to_string(cnd_ix);
-    ++cnd_ix;
+void IRGenerator::evaluate_variable_assignment(const Parser::VariableAssignment *assign, Mir::Function &function, StackInfo &stack_info) {
+    const std::string id(assign->identifier);
+    if (!stack_info.exists(id) || stack_info.get(id).slot == Mir::none) {
+        success = false;
+        throw std::runtime_error("Variable not declared or inaccessible: '" + id + "'");
+    }
 
-    entry->instructions.push_back(std::make_unique<Je>(idm));
-    auto cndm = std::make_unique<Entry>(idm);
-    cndm->type = "void";
+    const auto res = stack_info.get(id);
+    if (res.is_final) {
+        success = false;
+        throw std::runtime_error("Variable is final: '" + id + "'");
+    }
+    const auto expr_type = get_type_info(assign->expr, stack_info);
+    const uint32_t value = convert(function, evaluate_expr(assign->expr, function, stack_info), expr_type, res.type);
+    function.add(Mir::Inst(Mir::STORE, 0, false, value));
+    function.insts.back().value = res.slot;
+}
+
+// Evaluates 'expr' to a value with an explicit stack of the operations
+// waiting for their operands, so deeply nested expressions and long operator
+// chains do not exhaust the call stack. Types are deduced once per node of
+// the expression.
+uint32_t IRGenerator::evaluate_expr(const Parser::Node *expr, Mir::Function &function, StackInfo &stack_info) {
+    TypeCache types;
+    std::vector<ExprFrame> frames;
+    frames.emplace_back(expr);
+    uint32_t result = Mir::none;
+
+    while (!frames.empty()) {
+        ExprFrame &frame = frames.back();
+        const Parser::Node *operand = nullptr;
+        switch (frame.expr->kind) {
+            case Parser::Node::UNARY_OPERATION:
+                operand = evaluate_unary_operation(frame, result, function, stack_info, types);
+                break;
+            case Parser::Node::BINARY_OPERATION:
+                operand = evaluate_binary_operation(frame, result, function, stack_info, types);
+                break;
+            case Parser::Node::CAST_OPERATION:
+                operand = evaluate_cast_operation(frame, result, function, stack_info, types);
+                break;
+            case Parser::Node::VARIABLE_CALL:
+                frame.value = evaluate_variable_call(static_cast<const Parser::VariableCall*>(frame.expr), function, stack_info);
+                break;
+            case Parser::Node::FUNCTION_CALL:
+                frame.value = evaluate_function_call(static_cast<const Parser::FunctionCall*>(frame.expr), function, stack_info);
+                break;
+            case Parser::Node::INTEGER_LITERAL: {
+                // Literals keep their value until converted, see convert().
+                Mir::Inst inst(Mir::CONST, get_data_size("int32"), true);
+                inst.value = get_integer(static_cast<const Parser::IntegerLiteral*>(frame.expr)->value);
+                frame.value = function.add(inst);
+                break;
+            }
+            case Parser::Node::BOOLEAN_LITERAL:
+                frame.value = add_constant(function, static_cast<const Parser::BooleanLiteral*>(frame.expr)->value, get_type_info("bool"));
+                break;
+            case Parser::Node::STRING_LITERAL:
+                frame.value = add_string(function, '\"' + std::string(static_cast<const Parser::StringLiteral*>(frame.expr)->value) + '\"');
+                break;
+            case Parser::Node::EMPTY_STATEMENT:
+                break;
+            default:
+                success = false;
+                throw std::runtime_error("Unsupported expression encountered.");
+        }
 
-    StackInfo pass_stack_info = stack_info;
-    int alloc_at = cndm->instructions.size();
-    if (const auto *decl = dynamic_cast<const Parser::ScopeDeclaration*>(statement->pass_statement.get())) {
-        for (const auto &t : decl->ast) {
-            evaluate_statement(t.get(), cndm.get(), pass_stack_info);
+        if (operand) {
+            frames.emplace_back(operand);
+        } else {
+            result = frame.value;
+            frames.pop_back();
         }
+    }
+    return result;
+}
+
+// Both sides are brought to the type of the operation first, shifts keep
+// their count as it is.
+const Parser::Node *IRGenerator::evaluate_binary_operation(ExprFrame &frame, const uint32_t &operand, Mir::Function &function, StackInfo &stack_info, TypeCache &types) {
+    const auto *operation = static_cast<const Parser::BinaryOperation*>(frame.expr);
+    switch (frame.stage++) {
+        case 0:
+            frame.type = get_type_info(operation->left, stack_info, types);
+            return operation->left;
+        case 1:
+            frame.left = operand;
+            if (operation->op == "&&" || operation->op == "||") {
+                // The right operand is only evaluated when the left one does
+                // not decide the result, both are stored to a slot read back
+                // where they join.
+                const TypeInfo type = get_type_info(frame.expr, stack_info, types);
+                const uint32_t right = function.add_block();
+                frame.slot = function.add_slot(type.size, false);
+                frame.end = function.add_block();
+                const uint32_t left = convert(function, operand, frame.type, type);
+                function.add(Mir::Inst(Mir::STORE, 0, false, left));
+                function.insts.back().value = frame.slot;
+                if (operation->op == "&&") function.branch(left, right, frame.end);
+                else function.branch(left, frame.end, right);
+                function.current = right;
+            }
+            return operation->right;
+    }
+
+    const auto &op = operation->op;
+    if (op == "&&" || op == "||") {
+        const TypeInfo type = get_type_info(frame.expr, stack_info, types);
+        const uint32_t right = convert(function, operand, get_type_info(operation->right, stack_info, types), type);
+        function.add(Mir::Inst(Mir::STORE, 0, false, right));
+        function.insts.back().value = frame.slot;
+        function.jump(frame.end);
+        function.current = frame.end;
+
+        Mir::Inst inst(Mir::LOAD, type.size, false);
+        inst.value = frame.slot;
+        frame.value = function.add(inst);
+        return nullptr;
+    }
+
+    const TypeInfo &left_type = frame.type;
+    const TypeInfo &right_type = get_type_info(operation->right, stack_info, types);
+    const TypeInfo type = get_type_info(frame.expr, stack_info, types);
+
+    Mir::Opcode code;
+    if (op == "==") code = Mir::EQ;
+    else if (op == "!=") code = Mir::NE;
+    else if (op == "<") code = Mir::LT;
+    else if (op == "<=") code = Mir::LE;
+    else if (op == ">") code = Mir::GT;
+    else if (op == ">=") code = Mir::GE;
+    else if (op == "+") code = Mir::ADD;
+    else if (op == "-") code = Mir::SUB;
+    else if (op == "*") code = Mir::MUL;
+    else if (op == "/") code = Mir::DIV;
+    else if (op == "%") code = Mir::MOD;
+    else if (op == "**") code = Mir::POW;
+    else if (op == "&") code = Mir::AND;
+    else if (op == "|") code = Mir::OR;
+    else if (op == "^") code = Mir::XOR;
+    else if (op == "<<") code = Mir::SHL;
+    else if (op == ">>") code = Mir::SHR;
+    else {
+        success = false;
+        throw std::runtime_error("Unsupported operator: " + std::string(op));
+    }
+
+    if (code == Mir::SHL || code == Mir::SHR) {
+        frame.value = function.add(Mir::Inst(code, type.size, is_signed(type), convert(function, frame.left, left_type, type), operand));
+    } else if (code >= Mir::EQ && code <= Mir::GE) {
+        const TypeInfo common = get_common_type(left_type, right_type);
+        const uint32_t left = convert(function, frame.left, left_type, common);
+        const uint32_t right = convert(function, operand, right_type, common);
+        frame.value = function.add(Mir::Inst(code, type.size, false, left, right));
     } else {
-        evaluate_statement(statement->pass_statement.get(), cndm.get(), pass_stack_info);
+        const uint32_t left = convert(function, frame.left, left_type, type);
+        const uint32_t right = convert(function, operand, right_type, type);
+        frame.value = function.add(Mir::Inst(code, type.size, is_signed(type), left, right));
+    }
+    return nullptr;
+}
+
+const Parser::Node *IRGenerator::evaluate_unary_operation(ExprFrame &frame, const uint32_t &operand, Mir::Function &function, StackInfo &stack_info, TypeCache &types) {
+    const auto *operation = static_cast<const Parser::UnaryOperation*>(frame.expr);
+    if (operation->op != "-" && operation->op != "~" && operation->op != "!") {
+        success = false;
+        throw std::runtime_error("Unsupported operator: " + std::string(operation->op));
     }
-    pass_stack_info.size = align_by(pass_stack_info.size, 16);
-    cndm->instructions.insert(cndm->instructions.begin() + alloc_at, std::make_unique<Sub>("rsp", std::to_string(pass_stack_info.size)));
-    cndm->instructions.push_back(std::make_unique<Add>("rsp", std::to_string(pass_stack_info.size)));
 
-    cndm.get()->instructions.push_back(std::make_unique<Jmp>(ide));
-    labels.push_back(std::move(cndm));
+    if (frame.stage++ == 0) {
+        return operation->value;
+    }
 
-    if (const auto *empty = dynamic_cast<const Parser::EmptyStatement*>(statement->fail_statement.get())) {
+    const TypeInfo &type = get_type_info(operation->value, stack_info, types);
+    if (operation->op == "-") {
+        frame.value = function.add(Mir::Inst(Mir::NEG, type.size, is_signed(type), operand));
+    } else if (operation->op == "~") {
+        frame.value = function.add(Mir::Inst(Mir::NOT, type.size, is_signed(type), operand));
+    } else if (type.type == IntegralType::BOOL) {
+        frame.value = function.add(Mir::Inst(Mir::XOR, type.size, false, operand, add_constant(function, 1, type)));
     } else {
-        idm = ".cndm" + std::to_string(cnd_ix);
-        ++cnd_ix;
+        frame.value = function.add(Mir::Inst(Mir::EQ, get_data_size("bool"), false, operand, add_constant(function, 0, type)));
+    }
+    return nullptr;
+}
 
-        entry->instructions.push_back(std::make_unique<Jne>(idm));
-        auto cndms = std::make_unique<Entry>(idm);
-        cndms->type = "void";
+// Casts between integral types convert the value, casts to string give the
+// format printf needs for it.
+const Parser::Node *IRGenerator::evaluate_cast_operation(ExprFrame &frame, const uint32_t &operand, Mir::Function &function, StackInfo &stack_info, TypeCache &types) {
+    const auto *operation = static_cast<const Parser::CastOperation*>(frame.expr);
+    const auto cast_type = get_type_info(std::string(operation->right));
 
-        StackInfo fail_stack_info = stack_info;
-        int alloc_at = cndms->instructions.size();
-        if (const auto *decl = dynamic_cast<const Parser::ScopeDeclaration*>(statement->fail_statement.get())) {
-            for (const auto &t : decl->ast) {
-                evaluate_statement(t.get(), cndms.get(), fail_stack_info);
-            }
-        } else {
-            evaluate_statement(statement->fail_statement.get(), cndms.get(), fail_stack_info);
-        }
-        fail_stack_info.size = align_by(fail_stack_info.size, 16);
-        cndms->instructions.insert(cndms->instructions.begin() + alloc_at, std::make_unique<Sub>("rsp", std::to_string(fail_stack_info.size)));
-        cndms->instructions.push_back(std::make_unique<Add>("rsp", std::to_string(fail_stack_info.size)));
+    if (frame.stage++ == 0) {
+        frame.type = get_type_info(operation->left, stack_info, types);
+        return operation->left;
+    }
 
-        cndms.get()->instructions.push_back(std::make_unique<Jmp>(ide));
-        labels.push_back(std::move(cndms));
+    const auto &org_type = frame.type;
+    const bool org_integral = org_type.type == IntegralType::INT || org_type.type == IntegralType::UINT || org_type.type == IntegralType::BOOL;
+    if ((cast_type.type == IntegralType::BOOL || cast_type.type == IntegralType::UINT || cast_type.type == IntegralType::INT) && org_integral) {
+        frame.value = convert(function, operand, org_type, cast_type);
+    } else if (cast_type.type == IntegralType::STRING && org_type.type == IntegralType::STRING) {
+        frame.value = operand;
+    } else if (cast_type.type == IntegralType::STRING && (org_type.type == IntegralType::INT || org_type.type == IntegralType::UINT)) {
+        std::string format;
+        if (org_type.type == IntegralType::INT) format = org_type.size >= 8 ? "\"%lld\"" : "\"%d\"";
+        else format = org_type.size >= 8 ? "\"%llu\"" : "\"%u\"";
+
+        Mir::Inst inst(Mir::FORMAT, cast_type.size, false, operand);
+        inst.symbol = symbols.copy(add_data(format));
+        frame.value = function.add(inst);
+    } else if (cast_type.type == IntegralType::STRING && org_type.type == IntegralType::BOOL) {
+        Mir::Inst inst(Mir::SELECT, cast_type.size);
+        inst.args = {operand, add_string(function, "\"true\""), add_string(function, "\"false\"")};
+        frame.value = function.add(inst);
+    } else {
+        success = false;
+        throw std::runtime_error("Could not cast '" + org_type.name + "' to '" + cast_type.name + "'");
+    }
+    return nullptr;
+}
+
+uint32_t IRGenerator::evaluate_variable_call(const Parser::VariableCall *call, Mir::Function &function, StackInfo &stack_info) {
+    const std::string id(call->identifier);
+    if (!stack_info.exists(id)) {
+        success = false;
+        throw std::runtime_error("Variable not declared or inaccessible: '" + id + "'");
     }
 
-    entry->instructions.push_back(std::make_unique<Label>(ide));
+    const auto res = stack_info.get(id);
+    if (res.slot == Mir::none) {
+        success = false;
+        throw std::runtime_error("Variable can not be used as a value: '" + id + "'");
+    }
+
+    Mir::Inst inst(Mir::LOAD, res.type.size, is_signed(res.type));
+    inst.value = res.slot;
+    return function.add(inst);
 }
 
-void IRGenerator::evaluate_function_call(const Parser::FunctionCall *call, Entry *entry, const std::string &target, StackInfo &stack_info) {
-    if (call->identifier == "printf") {
-        for (int i = 0; i < call->args.size(); ++i) {
-            const auto &arg = call->args[i];
-            evaluate_expr(arg.get(), entry, "rcx", stack_info);
+// Constants are converted right away, which keeps literals that do not fit
+// an int32 intact where a wider type is expected. Anything converted to a
+// bool is compared with zero.
+uint32_t IRGenerator::convert(Mir::Function &function, const uint32_t &value, const TypeInfo &from, const TypeInfo &to) {
+    if (from.type == IntegralType::STRING || to.type == IntegralType::STRING) {
+        if (from.type == to.type) return value;
+        success = false;
+        throw std::runtime_error("Could not convert '" + from.name + "' to '" + to.name + "'");
+    }
+    if (from.type == IntegralType::FLOAT || to.type == IntegralType::FLOAT || from.size < 1 || to.size < 1) {
+        success = false;
+        throw std::runtime_error("Could not convert '" + from.name + "' to '" + to.name + "'");
+    }
 
-            add_extern("printf");
-            entry->instructions.push_back(std::make_unique<Call>("printf"));
+    const Mir::Inst &inst = function.insts[value];
+    if (to.type == IntegralType::BOOL && from.type != IntegralType::BOOL) {
+        if (inst.op == Mir::CONST) return add_constant(function, Mir::normalize(inst.value, from.size, is_signed(from)) != 0, to);
+        return function.add(Mir::Inst(Mir::NE, to.size, false, value, add_constant(function, 0, from)));
+    }
+    if (from.size == to.size && is_signed(from) == is_signed(to)) return value;
+    if (inst.op == Mir::CONST) return add_constant(function, inst.value, to);
+    return function.add(Mir::Inst(Mir::CAST, to.size, is_signed(to), value));
+}
+
+uint32_t IRGenerator::add_constant(Mir::Function &function, const int64_t &value, const TypeInfo &type) {
+    Mir::Inst inst(Mir::CONST, type.size, is_signed(type));
+    inst.value = Mir::normalize(value, type.size, is_signed(type));
+    return function.add(inst);
+}
+
+uint32_t IRGenerator::add_string(Mir::Function &function, const std::string &value) {
+    Mir::Inst inst(Mir::STRING, get_data_size("string"));
+    inst.symbol = symbols.copy(add_data(value));
+    return function.add(inst);
+}
+
+// Label of a zero terminated string in the data segment.
+const std::string IRGenerator::add_data(const std::string &value) {
+    const std::string terminator = "0";
+    const auto hash = get_hash(value + terminator, "c");
+    push_unique(std::make_unique<Db>(hash, value, terminator), data);
+    return hash;
+}
+
+// Values computed at run time live where the register allocator puts them,
+// constants and addresses are rebuilt where they are used. Level 0 keeps
+// every value on the stack, level 1 allocates registers by linear scan and
+// higher levels by graph coloring. The frame ends in room for the arguments
+// of the functions called, which is at least the 32 bytes printf may spill
+// its register arguments to. Above level 0 the blocks are lowered in the
+// order Mir::Function::place_blocks() gives them.
+void IRGenerator::lower_function(Mir::Function &function, Entry *entry) {
+    function.split_edges();
+    if (level > 0) function.place_blocks();
+    else function.layout = function.order;
+
+    const auto strategy = level <= 0 ? RegisterAllocator::STACK : level == 1 ? RegisterAllocator::LINEAR_SCAN : RegisterAllocator::GRAPH_COLORING;
+    const RegisterAllocator allocator(function, strategy);
+    locations = allocator.get_locations();
+    saved = allocator.get_saved();
+
+    int outgoing = 32;
+    for (const auto &b : function.order) {
+        for (const auto &i : function.blocks[b].insts) {
+            const Mir::Inst &inst = function.insts[i];
+            if (inst.op == Mir::CALL) outgoing = std::max<int>(outgoing, inst.args.size() * 8);
         }
+    }
 
-        // Newline
-        const std::string value = "0xd, 0xa";
-        const std::string terminator = "0";
-        const auto hash = get_hash(value + terminator, "c");
-        push_unique(std::make_unique<Db>(hash, value, terminator), data);
-
-        entry->instructions.push_back(std::make_unique<Lea>("rcx", "[" + hash + "]"));
-        entry->instructions.push_back(std::make_unique<Call>("printf"));
-    } else {
-        std::string identifier = call->identifier;
-        for (const auto &arg : call->args) {
-            auto type_info = get_type_info(arg.get(), entry, stack_info);
-            identifier += type_info.name;
+    // A comparison only the branch right after it uses leaves its result in
+    // the flags, the branch jumps on them.
+    std::vector<uint32_t> uses(function.insts.size(), 0);
+    for (const auto &b : function.order) {
+        for (const auto &i : function.blocks[b].insts) {
+            function.for_each_operand(function.insts[i], [&uses](uint32_t &value) { ++uses[value]; });
         }
-        identifier = get_hash(identifier, "f");
+        if (function.blocks[b].value != Mir::none) ++uses[function.blocks[b].value];
+    }
+    fused.assign(function.insts.size(), 0);
+    for (const auto &b : function.order) {
+        const Mir::Block &block = function.blocks[b];
+        if (block.exit != Mir::BRANCH || block.insts.empty() || block.insts.back() != block.value) continue;
+        const Mir::Opcode op = function.insts[block.value].op;
+        if (op >= Mir::EQ && op <= Mir::GE && uses[block.value] == 1) fused[block.value] = 1;
+    }
 
-        for (int i = 0; i < text.declarations.size(); ++i) {
-            if (auto *decl = dynamic_cast<Entry*>(text.declarations[i].get())) {
-                std::string other_id = decl->id;
-                std::string other_type = decl->type;
-                if (other_id == identifier) {
-                    int alloc_at = entry->instructions.size();
-                    int offset = 0;
-
-                    int y = 0;
-                    for (const auto &decl_arg : decl->args_stack.keys) {
-                        const auto &call_arg = call->args[y].get();
-                        const std::string temp_reg = get_registry("rsi", decl_arg.second.type.size);
-                        evaluate_expr(call_arg, entry, temp_reg, stack_info);
-                        entry->instructions.push_back(std::make_unique<Mov>(get_word(decl_arg.second.type.size) + " [rsp + " + std::to_string(offset) + "]", temp_reg));
-
-                        offset += decl_arg.second.type.size;
-                        ++y;
-                    }
+    labels.assign(function.blocks.size(), Operand());
+    for (size_t k = 1; k < function.layout.size(); ++k) {
+        labels[function.layout[k]] = get_label(".bb" + std::to_string(label_ix++));
+    }
 
-                    const std::string res_size = std::to_string(align_by(offset, 16));
-                    entry->instructions.insert(entry->instructions.begin() + alloc_at, std::make_unique<Sub>("rsp", res_size));
-                    entry->instructions.push_back(std::make_unique<Call>(identifier));
-                    entry->instructions.push_back(std::make_unique<Add>("rsp", res_size));
-                    if (decl->type != "void") entry->instructions.push_back(std::make_unique<Mov>(target, get_registry("rax", get_data_size(decl->type))));
-                    return;
-                }
-            }
+    entry->instructions.push_back(Push(rbp));
+    entry->instructions.push_back(Mov(rbp, rsp));
+    entry->instructions.push_back(Sub(rsp, Operand::imm(align_by(allocator.get_frame_size() + outgoing, 16))));
+    for (size_t k = 0; k < saved.size(); ++k) {
+        entry->instructions.push_back(Mov(Operand::mem(Operand::RBP, -8 * (k + 1), 8), get_registry(saved[k], 8)));
+    }
+
+    for (size_t k = 0; k < function.layout.size(); ++k) {
+        const uint32_t b = function.layout[k];
+        const Mir::Block &block = function.blocks[b];
+        if (k > 0) entry->instructions.push_back(Label(labels[b]));
+        for (const auto &i : block.insts) {
+            if (!fused[i]) lower_instruction(function, i, entry);
         }
+        if (block.exit == Mir::JUMP) lower_copies(function, b, block.succs[0], entry);
+        lower_exit(function, b, k + 1 < function.layout.size() ? function.layout[k + 1] : Mir::none, entry);
+    }
+}
 
-        success = false;
-        throw std::runtime_error("Function not declared or inaccessible: '" + call->identifier + "'");
-    }
-}
-
-void IRGenerator::evaluate_variable_declaration(const Parser::VariableDeclaration *decl, Entry *entry, StackInfo &stack_info) {
-    // const auto id = "static_" + decl->identifier;
-    // push_unique(std::make_unique<Resd>(id, 1, decl->type), bss);
-    if (is_integral(decl->type)) {
-        if (!stack_info.exists(decl->identifier)) {
-            int offset = stack_info.get_bottom();
-            TypeInfo type_info = get_type_info(decl->type);
-            stack_info.size += type_info.size;
-            std::string registry = get_registry("rdx", type_info.size);
-            if (const auto *statement = dynamic_cast<const Parser::EmptyStatement*>(decl->expr.get())) {
-                if (type_info.type == IntegralType::BOOL) {
-                    entry->instructions.push_back(std::make_unique<Mov>(get_word(type_info.size) + " [rbp - " + std::to_string(offset) +"]", "0"));
-                } else if (type_info.type == IntegralType::UINT) {
-                    entry->instructions.push_back(std::make_unique<Mov>(get_word(type_info.size) + " [rbp - " + std::to_string(offset) +"]", "0"));
-                } else if (type_info.type == IntegralType::INT) {
-                    entry->instructions.push_back(std::make_unique<Mov>(get_word(type_info.size) + " [rbp - " + std::to_string(offset) +"]", "0"));
-                } else if (type_info.type == IntegralType::STRING) {
-                    entry->instructions.push_back(std::make_unique<Mov>(get_word(type_info.size) + " [rbp - " + std::to_string(offset) +"]", "Uninitialized string"));
-                }
+// Operations work on their accumulator and r11, or rax and rdx where
+// division needs them. Byte sized multiplications and divisions are done on
+// dwords.
+void IRGenerator::lower_instruction(const Mir::Function &function, const uint32_t &id, Entry *entry) {
+    const Mir::Inst &inst = function.insts[id];
+    const Operand &home = locations[id];
+    const Operand::Register accumulator = get_accumulator(function, id);
+    auto &instructions = entry->instructions;
+    switch (inst.op) {
+        case Mir::UNDEF:
+        case Mir::CONST:
+        case Mir::STRING:
+        case Mir::FORMAT:
+        case Mir::PHI:
+            break;
+        case Mir::ARG:
+            move(home, Operand::mem(Operand::RBP, 16 + 8 * inst.value, inst.size), entry);
+            break;
+        case Mir::ADD:
+        case Mir::SUB:
+        case Mir::AND:
+        case Mir::OR:
+        case Mir::XOR: {
+            const Operand acc = load(function, inst.a, accumulator, inst.size, entry);
+            const Operand right = get_operand(function, inst.b, Operand::R11, entry);
+            if (inst.op == Mir::ADD) instructions.push_back(Add(acc, right));
+            else if (inst.op == Mir::SUB) instructions.push_back(Sub(acc, right));
+            else if (inst.op == Mir::AND) instructions.push_back(And(acc, right));
+            else if (inst.op == Mir::OR) instructions.push_back(Or(acc, right));
+            else instructions.push_back(Xor(acc, right));
+            move(home, acc, entry);
+            break;
+        }
+        case Mir::MUL: {
+            if (inst.size >= 2) {
+                const Operand acc = load(function, inst.a, accumulator, inst.size, entry);
+                instructions.push_back(Imul(acc, get_operand(function, inst.b, Operand::R11, entry)));
+                move(home, acc, entry);
             } else {
-                evaluate_expr(decl->expr.get(), entry, registry, stack_info);
-                entry->instructions.push_back(std::make_unique<Mov>(get_word(type_info.size) + " [rbp - " + std::to_string(offset) +"]", registry));
+                const Operand acc = load(function, inst.a, Operand::RAX, 4, entry);
+                instructions.push_back(Imul(acc, load(function, inst.b, Operand::R11, 4, entry)));
+                move(home, acc.resized(inst.size), entry);
             }
-            stack_info.push(decl->identifier, type_info);
-        } else {
+            break;
+        }
+        case Mir::DIV:
+        case Mir::MOD: {
+            const int width = std::max<int>(inst.size, 4);
+            load(function, inst.a, Operand::RAX, width, entry);
+            const Operand divisor = load(function, inst.b, Operand::R11, width, entry);
+            if (inst.sign) {
+                if (width == 8) instructions.push_back(Cqo());
+                else instructions.push_back(Cdq());
+                instructions.push_back(Idiv(divisor));
+            } else {
+                instructions.push_back(Xor(get_registry(Operand::RDX, 4), get_registry(Operand::RDX, 4)));
+                instructions.push_back(Div(divisor));
+            }
+            move(home, get_registry(inst.op == Mir::DIV ? Operand::RAX : Operand::RDX, inst.size), entry);
+            break;
+        }
+        case Mir::POW: {
+            // Repeated multiplication, a negative exponent yields 1.
+            const std::string idc = ".powc" + std::to_string(pow_ix);
+            const std::string ide = ".powe" + std::to_string(pow_ix);
+            ++pow_ix;
+
+            const int width = std::max<int>(inst.size, 4);
+            const Operand base = load(function, inst.a, Operand::R10, width, entry);
+            const Operand exponent = load(function, inst.b, Operand::R11, width, entry);
+            const Operand acc = get_registry(Operand::RAX, width);
+            instructions.push_back(Mov(acc, Operand::imm(1)));
+            instructions.push_back(Label(get_label(idc)));
+            instructions.push_back(Cmp(exponent, Operand::imm(0)));
+            instructions.push_back(Jle(get_label(ide)));
+            instructions.push_back(Imul(acc, base));
+            instructions.push_back(Sub(exponent, Operand::imm(1)));
+            instructions.push_back(Jmp(get_label(idc)));
+            instructions.push_back(Label(get_label(ide)));
+            move(home, acc.resized(inst.size), entry);
+            break;
+        }
+        case Mir::SHL:
+        case Mir::SHR: {
+            // The count has to be an immediate or cl.
+            const Mir::Inst &count = function.insts[inst.b];
+            const Operand acc = load(function, inst.a, accumulator, inst.size, entry);
+            Operand shift = cl;
+            if (count.op == Mir::CONST) shift = Operand::imm(Mir::normalize(count.value, count.size, count.sign) & 63);
+            else load(function, inst.b, Operand::RCX, count.size, entry);
+            if (inst.op == Mir::SHL) instructions.push_back(Shl(acc, shift));
+            else if (inst.sign) instructions.push_back(Sar(acc, shift));
+            else instructions.push_back(Shr(acc, shift));
+            move(home, acc, entry);
+            break;
+        }
+        case Mir::EQ:
+        case Mir::NE:
+        case Mir::LT:
+        case Mir::LE:
+        case Mir::GT:
+        case Mir::GE: {
+            const Mir::Inst &left = function.insts[inst.a];
+            compare(function, inst, entry);
+            if (inst.op == Mir::EQ) instructions.push_back(Sete(home));
+            else if (inst.op == Mir::NE) instructions.push_back(Setne(home));
+            else if (inst.op == Mir::LT) instructions.push_back(left.sign ? Instruction(Setl(home)) : Instruction(Setb(home)));
+            else if (inst.op == Mir::LE) instructions.push_back(left.sign ? Instruction(Setle(home)) : Instruction(Setbe(home)));
+            else if (inst.op == Mir::GT) instructions.push_back(left.sign ? Instruction(Setg(home)) : Instruction(Seta(home)));
+            else instructions.push_back(left.sign ? Instruction(Setge(home)) : Instruction(Setae(home)));
+            break;
+        }
+        case Mir::NEG:
+        case Mir::NOT: {
+            const Operand acc = load(function, inst.a, accumulator, inst.size, entry);
+            if (inst.op == Mir::NEG) instructions.push_back(Neg(acc));
+            else instructions.push_back(Not(acc));
+            move(home, acc, entry);
+            break;
+        }
+        case Mir::CAST:
+            move(home, load(function, inst.a, accumulator, inst.size, entry), entry);
+            break;
+        case Mir::SELECT: {
+            const int width = std::max<int>(inst.size, 4);
+            const Operand acc = load(function, inst.args[2], Operand::RAX, width, entry);
+            const Operand pass = load(function, inst.args[1], Operand::R11, width, entry);
+            const Operand condition = load(function, inst.args[0], Operand::RCX, function.insts[inst.args[0]].size, entry);
+            instructions.push_back(Cmp(condition, Operand::imm(0)));
+            instructions.push_back(Cmovne(acc, pass));
+            move(home, acc.resized(inst.size), entry);
+            break;
+        }
+        case Mir::CALL: {
+            // Arguments go to the bottom of the frame, a qword each.
+            for (size_t k = 0; k < inst.args.size(); ++k) {
+                const Mir::Inst &arg = function.insts[inst.args[k]];
+                move(Operand::mem(Operand::RSP, 8 * k, arg.size), get_operand(function, inst.args[k], Operand::RAX, entry), entry);
+            }
+            instructions.push_back(Call(Operand::label(inst.symbol)));
+            if (home.kind != Operand::NONE) move(home, get_registry(Operand::RAX, inst.size), entry);
+            break;
+        }
+        case Mir::PRINT: {
+            // A formatted value goes along in rdx.
+            const Mir::Inst &arg = function.insts[inst.a];
+            if (arg.op == Mir::FORMAT) {
+                load(function, arg.a, Operand::RDX, 8, entry);
+                instructions.push_back(Lea(rcx, Operand::mem(arg.symbol)));
+            } else {
+                load(function, inst.a, Operand::RCX, 8, entry);
+            }
+            instructions.push_back(Call(get_label("printf")));
+            break;
+        }
+        default:
             success = false;
-            throw std::runtime_error("Variable already declared: '" + decl->identifier + "'");
+            throw std::runtime_error("Unexpected instruction encountered.");
+    }
+}
+
+// The phis of 'succ' take their operands from 'pred' all at once. A copy
+// waits while another still has to read its destination, and when every
+// copy waits the cycle is broken by moving one destination to r10.
+void IRGenerator::lower_copies(const Mir::Function &function, const uint32_t &pred, const uint32_t &succ, Entry *entry) {
+    struct Copy {
+        Operand dst;
+        uint32_t value;
+        // Location read, none for values rebuilt where they are used.
+        Operand src;
+    };
+
+    const Mir::Block &block = function.blocks[succ];
+    const size_t j = std::find(block.preds.begin(), block.preds.end(), pred) - block.preds.begin();
+    std::vector<Copy> copies;
+    for (const auto &i : block.insts) {
+        if (function.insts[i].op != Mir::PHI) break;
+        const uint32_t value = function.insts[i].args[j];
+        if (value == Mir::none || function.insts[value].op == Mir::UNDEF || same_place(locations[value], locations[i])) continue;
+        copies.push_back({locations[i], value, locations[value]});
+    }
+
+    while (!copies.empty()) {
+        size_t k = 0;
+        for (; k < copies.size(); ++k) {
+            bool waits = false;
+            for (size_t m = 0; m < copies.size(); ++m) {
+                if (m != k && same_place(copies[m].src, copies[k].dst)) waits = true;
+            }
+            if (!waits) break;
         }
-    } else if (is_class(decl->type)) {
-        if (!stack_info.exists(decl->identifier)) {
-            int offset = stack_info.get_bottom();
-            TypeInfo type_info = get_type_info(decl->type);
-            stack_info.size += type_info.size;
 
-            stack_info.push(decl->identifier, type_info);
-        } else {
-            success = false;
-            throw std::runtime_error("Variable already declared: '" + decl->identifier + "'");
+        if (k == copies.size()) {
+            // Registers are kept whole, as the values read from them may be
+            // wider than the one written.
+            const Operand dst = copies[0].dst.kind == Operand::REGISTER ? copies[0].dst.resized(8) : copies[0].dst;
+            move(get_registry(Operand::R10, dst.size), dst, entry);
+            for (auto &copy : copies) {
+                if (same_place(copy.src, dst)) copy.src = get_registry(Operand::R10, copy.src.size);
+            }
+            continue;
         }
-    } else {
-        success = false;
-        throw std::runtime_error("Could not evaluate unknown declaration: '" + decl->identifier + "'");
+
+        const Operand src = copies[k].src.kind != Operand::NONE ? copies[k].src : get_operand(function, copies[k].value, Operand::RAX, entry);
+        move(copies[k].dst, src, entry);
+        copies.erase(copies.begin() + k);
     }
 }
 
-void IRGenerator::evaluate_variable_assignment(const Parser::VariableAssignment *assign, Entry *entry, StackInfo &stack_info) {
-    if (stack_info.exists(assign->identifier)) {
-        const auto &res = stack_info.get(assign->identifier);
-        evaluate_expr(assign->expr.get(), entry, get_registry("rdx", res.type.size), stack_info);
-        entry->instructions.push_back(std::make_unique<Mov>(get_word(res.type.size) + " [rbp - " + std::to_string(res.offset) +"]", get_registry("rdx", res.type.size)));
-    } else {
-        success = false;
-        throw std::runtime_error("Variable not declared or inaccessible: '" + assign->identifier + "'");
-    }
-}
-
-void IRGenerator::evaluate_expr(const Parser::Node *expr, Entry *entry, const std::string &target, StackInfo &stack_info) {
-    if (const auto *operation = dynamic_cast<const Parser::UnaryOperation*>(expr)) {
-        evaluate_unary_operation(operation, entry, target, stack_info);
-    } else if (const auto *operation = dynamic_cast<const Parser::BinaryOperation*>(expr)) {
-        evaluate_binary_operation(operation, entry, target, stack_info);
-    } else if (const auto *operation = dynamic_cast<const Parser::CastOperation*>(expr)) {
-        evaluate_cast_operation(operation, entry, target, stack_info);
-    } else if (const auto *call = dynamic_cast<const Parser::VariableCall*>(expr)) {
-        evaluate_variable_call(call, entry, target, stack_info);
-    } else if (const auto *call = dynamic_cast<const Parser::FunctionCall*>(expr)) {
-        evaluate_function_call(call, entry, target, stack_info);
-    } else if (const auto *literal = dynamic_cast<const Parser::IntegerLiteral*>(expr)) {
-        entry->instructions.push_back(std::make_unique<Mov>(target, literal->value));
-    } else if (const auto *literal = dynamic_cast<const Parser::BooleanLiteral*>(expr)) {
-        entry->instructions.push_back(std::make_unique<Mov>(target, std::to_string(literal->value)));
-    } else if (const auto *literal = dynamic_cast<const Parser::StringLiteral*>(expr)) {
-        const std::string value = '\"' + literal->value + '\"';
-        const std::string terminator = "0";
-        const auto hash = get_hash(value + terminator, "c");
-        push_unique(std::make_unique<Db>(hash, value, terminator), data);
-        entry->instructions.push_back(std::make_unique<Lea>(target, "[" + hash + "]"));
-    } else if (const auto *literal = dynamic_cast<const Parser::EmptyStatement*>(expr)) {
-    } else {
-        success = false;
-        throw std::runtime_error("Unsupported expression encountered.");
-    }
-}
-
-void IRGenerator::evaluate_binary_operation(const Parser::BinaryOperation *operation, Entry *entry, const std::string &target, StackInfo &stack_info) {
-    auto left_type = get_type_info(operation->left.get(), entry, stack_info);
-    auto right_type = get_type_info(operation->left.get(), entry, stack_info);
-    std::string left_reg = get_registry("rax", left_type.size);
-    std::string right_reg = get_registry("rbx", right_type.size);
-    std::string temp_reg = get_registry("rcx", right_type.size);
-
-    evaluate_expr(operation->left.get(), entry, left_reg, stack_info);
-
-    if (dynamic_cast<Parser::BinaryOperation*>(operation->right.get())) {
-        entry->instructions.push_back(std::make_unique<Mov>(temp_reg, left_reg));
-        left_reg = temp_reg;
-    }
-
-    evaluate_expr(operation->right.get(), entry, right_reg, stack_info);
-
-    if (operation->op == "+") {
-        entry->instructions.push_back(std::make_unique<Add>(left_reg, right_reg));
-    } else if (operation->op == "-") {
-        entry->instructions.push_back(std::make_unique<Sub>(left_reg, right_reg));
-    } else if (operation->op == "*") {
-        entry->instructions.push_back(std::make_unique<Imul>(left_reg, right_reg));
-    } else if (operation->op == "/") {
-        entry->instructions.push_back(std::make_unique<Mov>(get_registry("rax", left_type.size), left_reg));
-        entry->instructions.push_back(std::make_unique<Xor>("rdx", "rdx"));
-        entry->instructions.push_back(std::make_unique<Idiv>(right_reg));
-        left_reg = get_registry("rax", left_type.size);
-    } else if (operation->op == "==") {
-        entry->instructions.push_back(std::make_unique<Cmp>(left_reg, right_reg));
-        entry->instructions.push_back(std::make_unique<Sete>(get_registry(left_reg, get_type_info("bool").size)));
-    } else if (operation->op == "!=") {
-        entry->instructions.push_back(std::make_unique<Cmp>(left_reg, right_reg));
-        entry->instructions.push_back(std::make_unique<Setne>(get_registry(left_reg, get_type_info("bool").size)));
-    } else if (operation->op == ">") {
-        entry->instructions.push_back(std::make_unique<Cmp>(left_reg, right_reg));
-        entry->instructions.push_back(std::make_unique<Setg>(get_registry(left_reg, get_type_info("bool").size)));
-    } else if (operation->op == ">=") {
-        entry->instructions.push_back(std::make_unique<Cmp>(left_reg, right_reg));
-        entry->instructions.push_back(std::make_unique<Setge>(get_registry(left_reg, get_type_info("bool").size)));
-    } else if (operation->op == "<") {
-        entry->instructions.push_back(std::make_unique<Cmp>(left_reg, right_reg));
-        entry->instructions.push_back(std::make_unique<Setl>(get_registry(left_reg, get_type_info("bool").size)));
-    } else if (operation->op == "<=") {
-        entry->instructions.push_back(std::make_unique<Cmp>(left_reg, right_reg));
-        entry->instructions.push_back(std::make_unique<Setle>(get_registry(left_reg, get_type_info("bool").size)));
-    }
-
-    if (left_reg != target) {
-        entry->instructions.push_back(std::make_unique<Mov>(get_registry(target, left_type.size), left_reg));
-    }
-}
-
-void IRGenerator::evaluate_unary_operation(const Parser::UnaryOperation *operation, Entry *entry, const std::string &target, StackInfo &stack_info) {
-    if (operation->op == "-") {
-        evaluate_expr(operation->value.get(), entry, target, stack_info);
-        entry->instructions.push_back(std::make_unique<Neg>(target));
-    } else {
-        success = false;
-        throw std::runtime_error("Unsupported operator: " + operation->op);
+// Blocks fall through to 'next' rather than jumping to it.
+void IRGenerator::lower_exit(const Mir::Function &function, const uint32_t &b, const uint32_t &next, Entry *entry) {
+    const Mir::Block &block = function.blocks[b];
+    auto &instructions = entry->instructions;
+    switch (block.exit) {
+        case Mir::JUMP:
+            if (block.succs[0] != next) instructions.push_back(Jmp(labels[block.succs[0]]));
+            break;
+        case Mir::BRANCH: {
+            const Mir::Inst &condition = function.insts[block.value];
+            if (fused[block.value]) {
+                // Jumps to the block that does not follow on the condition
+                // or its opposite.
+                const bool sign = function.insts[condition.a].sign;
+                compare(function, condition, entry);
+                if (block.succs[0] == next) {
+                    instructions.push_back(jump_if(negate(condition.op), sign, labels[block.succs[1]]));
+                } else {
+                    instructions.push_back(jump_if(condition.op, sign, labels[block.succs[0]]));
+                    if (block.succs[1] != next) instructions.push_back(Jmp(labels[block.succs[1]]));
+                }
+                break;
+            }
+            if (condition.op == Mir::CONST || condition.op == Mir::UNDEF) {
+                const bool holds = condition.op == Mir::CONST && Mir::normalize(condition.value, condition.size, false) != 0;
+                const uint32_t target = holds ? block.succs[0] : block.succs[1];
+                if (target != next) instructions.push_back(Jmp(labels[target]));
+                break;
+            }
+            instructions.push_back(Cmp(get_operand(function, block.value, Operand::RAX, entry), Operand::imm(0)));
+            if (block.succs[0] == next) {
+                instructions.push_back(Je(labels[block.succs[1]]));
+            } else {
+                instructions.push_back(Jne(labels[block.succs[0]]));
+                if (block.succs[1] != next) instructions.push_back(Jmp(labels[block.succs[1]]));
+            }
+            break;
+        }
+        case Mir::RETURN:
+            if (block.value != Mir::none && function.insts[block.value].size > 0) {
+                load(function, block.value, Operand::RAX, function.insts[block.value].size, entry);
+            }
+            for (size_t k = 0; k < saved.size(); ++k) {
+                instructions.push_back(Mov(get_registry(saved[k], 8), Operand::mem(Operand::RBP, -8 * (k + 1), 8)));
+            }
+            instructions.push_back(Leave());
+            instructions.push_back(Ret());
+            break;
     }
 }
 
-void IRGenerator::evaluate_cast_operation(const Parser::CastOperation *operation, Entry *entry, const std::string &target, StackInfo &stack_info) {
-    const auto org_type = get_type_info(operation->left.get(), entry, stack_info);
-    const auto cast_type = get_type_info(operation->right);
-    if (cast_type.type == IntegralType::BOOL) {
-        if (org_type.type == IntegralType::STRING) {
-        } else if (org_type.type == IntegralType::INT) {
-            evaluate_expr(operation->left.get(), entry, target, stack_info);
-        } else if (org_type.type == IntegralType::UINT) {
-            evaluate_expr(operation->left.get(), entry, target, stack_info);
-        } else if (org_type.type == IntegralType::BOOL) {
-            evaluate_expr(operation->left.get(), entry, target, stack_info);
-        }
-    } else if (cast_type.type == IntegralType::UINT) {
-        if (org_type.type == IntegralType::STRING) {
-        } else if (org_type.type == IntegralType::INT) {
-            evaluate_expr(operation->left.get(), entry, target, stack_info);
-        } else if (org_type.type == IntegralType::UINT) {
-            evaluate_expr(operation->left.get(), entry, target, stack_info);
-        } else if (org_type.type == IntegralType::BOOL) {
-            evaluate_expr(operation->left.get(), entry, target, stack_info);
-        }
-    } else if (cast_type.type == IntegralType::INT) {
-        if (org_type.type == IntegralType::STRING) {
-        } else if (org_type.type == IntegralType::INT) {
-            evaluate_expr(operation->left.get(), entry, target, stack_info);
-        } else if (org_type.type == IntegralType::UINT) {
-            evaluate_expr(operation->left.get(), entry, target, stack_info);
-        } else if (org_type.type == IntegralType::BOOL) {
-            evaluate_expr(operation->left.get(), entry, target, stack_info);
+// The left operand is compared where it lives unless both would be memory
+// or it is a constant.
+void IRGenerator::compare(const Mir::Function &function, const Mir::Inst &inst, Entry *entry) {
+    const Operand right = get_operand(function, inst.b, Operand::R11, entry);
+    Operand acc = locations[inst.a];
+    if (acc.kind == Operand::NONE || (acc.kind == Operand::MEMORY && right.kind == Operand::MEMORY)) {
+        acc = load(function, inst.a, Operand::RAX, function.insts[inst.a].size, entry);
+    }
+    entry->instructions.push_back(Cmp(acc, right));
+}
+
+Operand IRGenerator::get_operand(const Mir::Function &function, const uint32_t &value, const Operand::Register &scratch, Entry *entry) {
+    const Mir::Inst &inst = function.insts[value];
+    switch (inst.op) {
+        case Mir::UNDEF:
+            return Operand::imm(0);
+        case Mir::CONST: {
+            // Only mov takes an immediate wider than a dword.
+            const int64_t constant = Mir::normalize(inst.value, inst.size, true);
+            if (constant >= INT32_MIN && constant <= INT32_MAX) return Operand::imm(constant);
+            const Operand reg = get_registry(scratch, 8);
+            entry->instructions.push_back(Mov(reg, Operand::imm(constant)));
+            return reg;
         }
-    } else if (cast_type.type == IntegralType::STRING) {
-        if (org_type.type == IntegralType::STRING) {
-            evaluate_expr(operation->left.get(), entry, target, stack_info);
-        } else if (org_type.type == IntegralType::INT) {
-            const std::string temp_reg = get_registry("rsi", org_type.size);
-            evaluate_expr(operation->left.get(), entry, temp_reg, stack_info);
-            if (org_type.size < 8) entry->instructions.push_back(std::make_unique<Movsx>("rdx", temp_reg));
-            else entry->instructions.push_back(std::make_unique<Mov>("rdx", temp_reg));
-
-            const std::string value = org_type.size >= 8 ? "\"%lld\"" : "\"%d\"";
-            const std::string terminator = "0";
-
-            const auto hash = get_hash(value + terminator, "c");
-            push_unique(std::make_unique<Db>(hash, value, terminator), data);
-            entry->instructions.push_back(std::make_unique<Lea>(target, "[" + hash + "]"));
-        } else if (org_type.type == IntegralType::UINT) {
-            std::string temp_reg = get_registry("rsi", org_type.size);
-            evaluate_expr(operation->left.get(), entry, temp_reg, stack_info);
-            entry->instructions.push_back(std::make_unique<Mov>("rdx", "rsi"));
-
-            const std::string value = org_type.size >= 8 ? "\"%llu\"" : "\"%u\"";
-            const std::string terminator = "0";
-
-            const auto hash = get_hash(value + terminator, "c");
-            push_unique(std::make_unique<Db>(hash, value, terminator), data);
-            entry->instructions.push_back(std::make_unique<Lea>(target, "[" + hash + "]"));
-        } else if (org_type.type == IntegralType::BOOL) {
-            const std::string true_value = "\"true\"";
-            const std::string false_value = "\"false\"";
-            const std::string terminator = "0";
-
-            const auto true_hash = get_hash(true_value + terminator, "c");
-            const auto false_hash = get_hash(false_value + terminator, "c");
-            push_unique(std::make_unique<Db>(true_hash, true_value, terminator), data);
-            push_unique(std::make_unique<Db>(false_hash, false_value, terminator), data);
-
-            const std::string temp_reg = get_registry("rsi", org_type.size);
-
-            evaluate_expr(operation->left.get(), entry, temp_reg, stack_info);
-
-            entry->instructions.push_back(std::make_unique<Lea>("rdx", "[" + true_hash + "]"));
-            entry->instructions.push_back(std::make_unique<Lea>(target, "[" + false_hash + "]"));
-
-            entry->instructions.push_back(std::make_unique<Cmp>(temp_reg, "1"));
-            entry->instructions.push_back(std::make_unique<Cmove>(target, "rdx"));
+        case Mir::STRING:
+        case Mir::FORMAT: {
+            const Operand reg = get_registry(scratch, 8);
+            entry->instructions.push_back(Lea(reg, Operand::mem(inst.symbol)));
+            return reg;
         }
+        default:
+            return locations[value];
     }
 }
 
-void IRGenerator::evaluate_variable_call(const Parser::VariableCall *call, Entry *entry, const std::string &target, StackInfo &stack_info) {
-    if (stack_info.exists(call->identifier)) {
-        entry->instructions.push_back(std::make_unique<Mov>(target, "[rbp - " + std::to_string(stack_info.get(call->identifier).offset) + "]"));
-    } else if (entry->args_stack.exists(call->identifier)) {
-        entry->instructions.push_back(std::make_unique<Mov>(target, "[rbp + " + std::to_string(entry->args_stack.get(call->identifier).offset) + "]"));
+Operand IRGenerator::load(const Mir::Function &function, const uint32_t &value, const Operand::Register &reg, const int &size, Entry *entry) {
+    const Mir::Inst &inst = function.insts[value];
+    const Operand target = get_registry(reg, size);
+    if (inst.op == Mir::CONST || inst.op == Mir::UNDEF) {
+        const int64_t constant = inst.op == Mir::CONST ? Mir::normalize(inst.value, inst.size, inst.sign) : 0;
+        entry->instructions.push_back(Mov(target, Operand::imm(Mir::normalize(constant, size, true))));
+        return target;
+    }
+
+    const Operand operand = get_operand(function, value, reg, entry);
+    if (inst.size >= size) {
+        if (operand.resized(size) != target) entry->instructions.push_back(Mov(target, operand.resized(size)));
+    } else if (inst.size == 4) {
+        if (inst.sign) entry->instructions.push_back(Movsxd(target, operand));
+        else entry->instructions.push_back(Mov(get_registry(reg, 4), operand));
     } else {
-        success = false;
-        throw std::runtime_error("Variable not declared or inaccessible: '" + call->identifier + "'");
+        const Operand wide = get_registry(reg, std::max(size, 4));
+        if (inst.sign) entry->instructions.push_back(Movsx(wide, operand));
+        else entry->instructions.push_back(Movzx(wide, operand));
+    }
+    return target;
+}
+
+Operand::Register IRGenerator::get_accumulator(const Mir::Function &function, const uint32_t &id) const {
+    const Operand &home = locations[id];
+    if (home.kind != Operand::REGISTER) return Operand::RAX;
+    const Mir::Inst &inst = function.insts[id];
+    const auto holds = [&](const uint32_t &value) {
+        return value != Mir::none && locations[value].kind == Operand::REGISTER && locations[value].base == home.base;
+    };
+    if (holds(inst.b)) return Operand::RAX;
+    for (const auto &arg : inst.args) {
+        if (holds(arg)) return Operand::RAX;
+    }
+    return home.base;
+}
+
+// Memory to memory moves go through rax.
+void IRGenerator::move(const Operand &dst, const Operand &src, Entry *entry) {
+    if (dst == src) return;
+    if (dst.kind == Operand::MEMORY && src.kind == Operand::MEMORY) {
+        const Operand reg = get_registry(Operand::RAX, dst.size);
+        entry->instructions.push_back(Mov(reg, src.resized(dst.size)));
+        entry->instructions.push_back(Mov(dst, reg));
+        return;
     }
+    entry->instructions.push_back(Mov(dst, src));
 }
 
 void IRGenerator::push_unique(std::unique_ptr<Declaration> decl, Segment &target) {
@@ -585,102 +1128,37 @@ void IRGenerator::add_extern(const std::string &id) {
     }
 }
 
-std::string IRGenerator::get_registry(const std::string &top_name, const int &size) {
-    if (top_name == "rax" || top_name == "eax" || top_name == "ax" || top_name == "al") {
-        if (size >= 8) return "rax";
-        if (size >= 4) return "eax";
-        if (size >= 2) return "ax";
-        if (size >= 1) return "al";
-    } else if (top_name == "rbx" || top_name == "ebx" || top_name == "bx" || top_name == "bl") {
-        if (size >= 8) return "rbx";
-        if (size >= 4) return "ebx";
-        if (size >= 2) return "bx";
-        if (size >= 1) return "bl";
-    } else if (top_name == "rcx" || top_name == "ecx" || top_name == "cx" || top_name == "cl") {
-        if (size >= 8) return "rcx";
-        if (size >= 4) return "ecx";
-        if (size >= 2) return "cx";
-        if (size >= 1) return "cl";
-    } else if (top_name == "rdx" || top_name == "edx" || top_name == "dx" || top_name == "dl") {
-        if (size >= 8) return "rdx";
-        if (size >= 4) return "edx";
-        if (size >= 2) return "dx";
-        if (size >= 1) return "dl";
-    } else if (top_name == "rsi" || top_name == "esi" || top_name == "si" || top_name == "sil") {
-        if (size >= 8) return "rsi";
-        if (size >= 4) return "esi";
-        if (size >= 2) return "si";
-        if (size >= 1) return "sil";
-    } else if (top_name == "rdi" || top_name == "edi" || top_name == "di" || top_name == "dil") {
-        if (size >= 8) return "rdi";
-        if (size >= 4) return "edi";
-        if (size >= 2) return "di";
-        if (size >= 1) return "dil";
-    } else if (top_name == "rbp" || top_name == "ebp" || top_name == "bp" || top_name == "bpl") {
-        if (size >= 8) return "rbp";
-        if (size >= 4) return "ebp";
-        if (size >= 2) return "bp";
-        if (size >= 1) return "bpl";
-    } else if (top_name == "rsp" || top_name == "esp" || top_name == "sp" || top_name == "spl") {
-        if (size >= 8) return "rsp";
-        if (size >= 4) return "esp";
-        if (size >= 2) return "sp";
-        if (size >= 1) return "spl";
-    } else if (top_name == "r8" || top_name == "r8d" || top_name == "r8w" || top_name == "r8b") {
-        if (size >= 8) return "r8";
-        if (size >= 4) return "r8d";
-        if (size >= 2) return "r8w";
-        if (size >= 1) return "r8b";
-    } else if (top_name == "r9" || top_name == "r9d" || top_name == "r9w" || top_name == "r9b") {
-        if (size >= 8) return "r9";
-        if (size >= 4) return "r9d";
-        if (size >= 2) return "r9w";
-        if (size >= 1) return "r9b";
-    } else if (top_name == "r10" || top_name == "r10d" || top_name == "r10w" || top_name == "r10b") {
-        if (size >= 8) return "r10";
-        if (size >= 4) return "r10d";
-        if (size >= 2) return "r10w";
-        if (size >= 1) return "r10b";
-    } else if (top_name == "r11" || top_name == "r11d" || top_name == "r11w" || top_name == "r11b") {
-        if (size >= 8) return "r11";
-        if (size >= 4) return "r11d";
-        if (size >= 2) return "r11w";
-        if (size >= 1) return "r11b";
-    } else if (top_name == "r12" || top_name == "r12d" || top_name == "r12w" || top_name == "r12b") {
-        if (size >= 8) return "r12";
-        if (size >= 4) return "r12d";
-        if (size >= 2) return "r12w";
-        if (size >= 1) return "r12b";
-    } else if (top_name == "r13" || top_name == "r13d" || top_name == "r13w" || top_name == "r13b") {
-        if (size >= 8) return "r13";
-        if (size >= 4) return "r13d";
-        if (size >= 2) return "r13w";
-        if (size >= 1) return "r13b";
-    } else if (top_name == "r14" || top_name == "r14d" || top_name == "r14w" || top_name == "r14b") {
-        if (size >= 8) return "r14";
-        if (size >= 4) return "r14d";
-        if (size >= 2) return "r14w";
-        if (size >= 1) return "r14b";
-    } else if (top_name == "r15" || top_name == "r15d" || top_name == "r15w" || top_name == "r15b") {
-        if (size >= 8) return "r15";
-        if (size >= 4) return "r15d";
-        if (size >= 2) return "r15w";
-        if (size >= 1) return "r15b";
+Operand IRGenerator::get_registry(const Operand::Register &reg, const int &size) {
+    if (size < 1) {
+        success = false;
+        throw std::runtime_error("Could not deduce registry part of a '" + std::to_string(size) + "' byte(s) value");
     }
+    return Operand::reg(reg, size);
+}
 
-    success = false;
-    throw std::runtime_error("Could not deduce registry part of unknown top registry: '" + top_name + "', '" + std::to_string(size) + "' byte(s)");
+Operand IRGenerator::get_registry(const Operand &reg, const int &size) {
+    return get_registry(reg.base, size);
 }
 
-std::string IRGenerator::get_word(const int &size) {
-    if (size >= 8) return "qword";
-    else if (size >= 4) return "dword";
-    else if (size >= 2) return "word";
-    else if (size >= 1) return "byte";
-    else {
-        success = false;
-        throw std::runtime_error("Could not deduce word size: '" + std::to_string(size) + "' byte(s)");
+// Integer literals are plain decimal digits.
+int64_t IRGenerator::get_integer(const std::string_view &value) {
+    int64_t result = 0;
+    for (const char &c : value) {
+        if (result > (INT64_MAX - (c - '0')) / 10) {
+            success = false;
+            throw std::runtime_error("Integer literal out of range: '" + std::string(value) + "'");
+        }
+        result = result * 10 + (c - '0');
     }
+    return result;
+}
+
+Operand IRGenerator::get_label(const std::string &id) {
+    return Operand::label(symbols.copy(id));
+}
+
+Operand IRGenerator::get_address(const std::string &id) {
+    return Operand::mem(symbols.copy(id));
 }
 
 const bool IRGenerator::is_class(const std::string &name) {
@@ -697,98 +1175,169 @@ const bool IRGenerator::is_integral(const std::string &name) {
     else return true;
 }
 
-const IRGenerator::TypeInfo IRGenerator::get_type_info(const Parser::Node *expr, Entry *entry, StackInfo &stack_info) {
-    TypeInfo type_info;
-    if (const auto *literal = dynamic_cast<const Parser::IntegerLiteral*>(expr)) {
-        type_info.name = "int32";
-        type_info.type = get_integral_type(type_info.name);
-        type_info.size = get_data_size(type_info.name);
-    } else if (const auto *literal = dynamic_cast<const Parser::BooleanLiteral*>(expr)) {
-        type_info.name = "bool";
-        type_info.type = get_integral_type(type_info.name);
-        type_info.size = get_data_size(type_info.name);
-    } else if (const auto *literal = dynamic_cast<const Parser::StringLiteral*>(expr)) {
-        type_info.name = "string";
-        type_info.type = get_integral_type(type_info.name);
-        type_info.size = get_data_size(type_info.name);
-    } else if (const auto *call = dynamic_cast<const Parser::VariableCall*>(expr)) {
-        if (stack_info.exists(call->identifier)) {
-            type_info = stack_info.get(call->identifier).type;
-        } else if (entry->args_stack.exists(call->identifier)) {
-            type_info = entry->args_stack.get(call->identifier).type;
-        } else {
-            success = false;
-            throw std::runtime_error("Variable not declared or inaccessible: '" + call->identifier + "'");
+const IRGenerator::TypeInfo IRGenerator::get_type_info(const Parser::Node *expr, StackInfo &stack_info) {
+    TypeCache types;
+    return get_type_info(expr, stack_info, types);
+}
+
+// Deduces operand types before the operations using them, with an explicit
+// stack rather than recursion. Every type lands in 'types', so nodes already
+// typed for the same expression are not visited again.
+const IRGenerator::TypeInfo& IRGenerator::get_type_info(const Parser::Node *expr, StackInfo &stack_info, TypeCache &types) {
+    std::vector<std::pair<const Parser::Node*, bool>> stack = {{expr, false}};
+    while (!stack.empty()) {
+        const auto [node, expanded] = stack.back();
+        if (types.count(node) > 0) {
+            stack.pop_back();
+            continue;
         }
-    } else if (const auto *call = dynamic_cast<const Parser::FunctionCall*>(expr)) {
-        std::string identifier = call->identifier;
-        for (const auto &arg : call->args) {
-            auto type_info = get_type_info(arg.get(), entry, stack_info);
-            identifier += type_info.name;
+        if (expanded) {
+            stack.pop_back();
+            types.emplace(node, deduce_type_info(node, stack_info, types));
+            continue;
         }
-        identifier = get_hash(identifier, "f");
-        for (int i = 0; i < text.declarations.size(); ++i) {
-            if (auto *decl = dynamic_cast<Entry*>(text.declarations[i].get())) {
-                if (decl->id == identifier) {
-                    type_info = get_type_info(decl->type);
-                }
+        stack.back().second = true;
+
+        // Operands go on in reverse, so they are typed left to right.
+        switch (node->kind) {
+            case Parser::Node::UNARY_OPERATION:
+                stack.push_back({static_cast<const Parser::UnaryOperation*>(node)->value, false});
+                break;
+            case Parser::Node::BINARY_OPERATION:
+                stack.push_back({static_cast<const Parser::BinaryOperation*>(node)->right, false});
+                stack.push_back({static_cast<const Parser::BinaryOperation*>(node)->left, false});
+                break;
+            case Parser::Node::FUNCTION_CALL: {
+                const auto &args = static_cast<const Parser::FunctionCall*>(node)->args;
+                for (size_t k = args.size(); k-- > 0;) stack.push_back({args[k], false});
+                break;
             }
+            default:
+                break;
         }
-    } else if (const auto *operation = dynamic_cast<const Parser::UnaryOperation*>(expr)) {
-        type_info = get_type_info(operation->value.get(), entry, stack_info);
-    } else if (const auto *operation = dynamic_cast<const Parser::BinaryOperation*>(expr)) {
-        const auto left_type_info = get_type_info(operation->left.get(), entry, stack_info);
-        const auto right_type_info = get_type_info(operation->right.get(), entry, stack_info);
-        if (operation->op == "==" || operation->op == "!=" || operation->op == ">" || operation->op == ">=" || operation->op == "<" || operation->op == "<=") {
+    }
+    return types.at(expr);
+}
+
+// Type of 'expr' from the types of its operands in 'types'.
+const IRGenerator::TypeInfo IRGenerator::deduce_type_info(const Parser::Node *expr, StackInfo &stack_info, const TypeCache &types) {
+    TypeInfo type_info;
+    switch (expr->kind) {
+        case Parser::Node::INTEGER_LITERAL:
+            type_info.name = "int32";
+            type_info.type = get_integral_type(type_info.name);
+            type_info.size = get_data_size(type_info.name);
+            break;
+        case Parser::Node::BOOLEAN_LITERAL:
             type_info.name = "bool";
             type_info.type = get_integral_type(type_info.name);
             type_info.size = get_data_size(type_info.name);
-        } else {
-            if (left_type_info.type == IntegralType::STRING) {
-                if (right_type_info.type == IntegralType::STRING) {
-                    type_info = left_type_info;
-                    type_info.size = std::max(left_type_info.size, right_type_info.size);
-                    success = false;
-                    throw std::runtime_error("Strinc concatenation not supported.");
-                } else {
-                    success = false;
-                    throw std::runtime_error("Invalid expression: '" + left_type_info.name + "', '" + right_type_info.name + "'");
+            break;
+        case Parser::Node::STRING_LITERAL:
+            type_info.name = "string";
+            type_info.type = get_integral_type(type_info.name);
+            type_info.size = get_data_size(type_info.name);
+            break;
+        case Parser::Node::VARIABLE_CALL: {
+            const auto *call = static_cast<const Parser::VariableCall*>(expr);
+            if (stack_info.exists(std::string(call->identifier))) {
+                type_info = stack_info.get(std::string(call->identifier)).type;
+            } else {
+                success = false;
+                throw std::runtime_error("Variable not declared or inaccessible: '" + std::string(call->identifier) + "'");
+            }
+            break;
+        }
+        case Parser::Node::FUNCTION_CALL: {
+            const auto *call = static_cast<const Parser::FunctionCall*>(expr);
+            std::string identifier(call->identifier);
+            for (const auto &arg : call->args) {
+                identifier += types.at(arg).name;
+            }
+            identifier = get_hash(identifier, "f");
+            for (int i = 0; i < text.declarations.size(); ++i) {
+                if (auto *decl = dynamic_cast<Entry*>(text.declarations[i].get())) {
+                    if (decl->id == identifier) {
+                        type_info = get_type_info(decl->type);
+                    }
                 }
-            } else if (left_type_info.type == IntegralType::FLOAT || right_type_info.type == IntegralType::FLOAT) {
-                type_info.name = left_type_info.name;
+            }
+            break;
+        }
+        case Parser::Node::UNARY_OPERATION: {
+            const auto *operation = static_cast<const Parser::UnaryOperation*>(expr);
+            type_info = types.at(operation->value);
+            if (operation->op == "!") {
+                type_info.name = "bool";
                 type_info.type = get_integral_type(type_info.name);
                 type_info.size = get_data_size(type_info.name);
-            } else if (left_type_info.type == IntegralType::INT) {
-                if (right_type_info.type == IntegralType::INT || right_type_info.type == IntegralType::UINT) {
-                    type_info.type = IntegralType::INT;
-                    type_info.size = std::max(left_type_info.size, right_type_info.size);
-                    type_info.name = "i" + std::to_string(type_info.size * 8);
-                } else {
-                    success = false;
-                    throw std::runtime_error("Invalid expression: '" + left_type_info.name + "', '" + right_type_info.name + "'");
-                }
-            } else if (left_type_info.type == IntegralType::UINT) {
-                if (right_type_info.type == IntegralType::INT) {
-                    type_info.type = IntegralType::INT;
-                    type_info.size = std::max(left_type_info.size, right_type_info.size);
-                    type_info.name = "i" + std::to_string(type_info.size * 8);
-                } else if (right_type_info.type == IntegralType::UINT) {
-                    type_info.type = IntegralType::UINT;
-                    type_info.size = std::max(left_type_info.size, right_type_info.size);
-                    type_info.name = "u" + std::to_string(type_info.size * 8);
-                } else {
-                    success = false;
-                    throw std::runtime_error("Invalid expression: '" + left_type_info.name + "', '" + right_type_info.name + "'");
+            }
+            break;
+        }
+        case Parser::Node::BINARY_OPERATION: {
+            const auto *operation = static_cast<const Parser::BinaryOperation*>(expr);
+            const auto &left_type_info = types.at(operation->left);
+            const auto &right_type_info = types.at(operation->right);
+            const bool logical = operation->op == "&&" || operation->op == "||";
+            const bool bitwise = operation->op == "&" || operation->op == "|" || operation->op == "^";
+            if (operation->op == "==" || operation->op == "!=" || operation->op == ">" || operation->op == ">=" || operation->op == "<" || operation->op == "<=" || logical ||
+                (bitwise && left_type_info.type == IntegralType::BOOL && right_type_info.type == IntegralType::BOOL)) {
+                type_info.name = "bool";
+                type_info.type = get_integral_type(type_info.name);
+                type_info.size = get_data_size(type_info.name);
+            } else if (operation->op == "<<" || operation->op == ">>") {
+                type_info = left_type_info;
+            } else {
+                if (left_type_info.type == IntegralType::STRING) {
+                    if (right_type_info.type == IntegralType::STRING) {
+                        type_info = left_type_info;
+                        type_info.size = std::max(left_type_info.size, right_type_info.size);
+                        success = false;
+                        throw std::runtime_error("Strinc concatenation not supported.");
+                    } else {
+                        success = false;
+                        throw std::runtime_error("Invalid expression: '" + left_type_info.name + "', '" + right_type_info.name + "'");
+                    }
+                } else if (left_type_info.type == IntegralType::FLOAT || right_type_info.type == IntegralType::FLOAT) {
+                    type_info.name = left_type_info.name;
+                    type_info.type = get_integral_type(type_info.name);
+                    type_info.size = get_data_size(type_info.name);
+                } else if (left_type_info.type == IntegralType::INT) {
+                    if (right_type_info.type == IntegralType::INT || right_type_info.type == IntegralType::UINT) {
+                        type_info.type = IntegralType::INT;
+                        type_info.size = std::max(left_type_info.size, right_type_info.size);
+                        type_info.name = "int" + std::to_string(type_info.size * 8);
+                    } else {
+                        success = false;
+                        throw std::runtime_error("Invalid expression: '" + left_type_info.name + "', '" + right_type_info.name + "'");
+                    }
+                } else if (left_type_info.type == IntegralType::UINT) {
+                    if (right_type_info.type == IntegralType::INT) {
+                        type_info.type = IntegralType::INT;
+                        type_info.size = std::max(left_type_info.size, right_type_info.size);
+                        type_info.name = "int" + std::to_string(type_info.size * 8);
+                    } else if (right_type_info.type == IntegralType::UINT) {
+                        type_info.type = IntegralType::UINT;
+                        type_info.size = std::max(left_type_info.size, right_type_info.size);
+                        type_info.name = "uint" + std::to_string(type_info.size * 8);
+                    } else {
+                        success = false;
+                        throw std::runtime_error("Invalid expression: '" + left_type_info.name + "', '" + right_type_info.name + "'");
+                    }
                 }
             }
+            break;
         }
-    } else if (const auto *operation = dynamic_cast<const Parser::CastOperation*>(expr)) {
-        type_info.name = operation->right;
-        type_info.type = get_integral_type(type_info.name);
-        type_info.size = get_data_size(type_info.name);
-    } else {
-        success = false;
-        throw std::runtime_error("Could not deduce type of unknown expression.");
+        case Parser::Node::CAST_OPERATION: {
+            const auto *operation = static_cast<const Parser::CastOperation*>(expr);
+            type_info.name = operation->right;
+            type_info.type = get_integral_type(type_info.name);
+            type_info.size = get_data_size(type_info.name);
+            break;
+        }
+        default:
+            success = false;
+            throw std::runtime_error("Could not deduce type of unknown expression.");
     }
     return type_info;
 }
@@ -813,6 +1362,26 @@ const IRGenerator::TypeInfo IRGenerator::get_type_info(const std::string &name)
     }
 }
 
+// Type both operands of a comparison are converted to.
+const IRGenerator::TypeInfo IRGenerator::get_common_type(const TypeInfo &left, const TypeInfo &right) {
+    if (left.type == IntegralType::BOOL && right.type == IntegralType::BOOL) return left;
+    if (left.type == IntegralType::STRING || right.type == IntegralType::STRING) {
+        if (left.type == right.type) return left;
+        success = false;
+        throw std::runtime_error("Invalid expression: '" + left.name + "', '" + right.name + "'");
+    }
+    if (!is_integral(left.name) || !is_integral(right.name)) {
+        success = false;
+        throw std::runtime_error("Invalid expression: '" + left.name + "', '" + right.name + "'");
+    }
+
+    TypeInfo type_info;
+    type_info.type = left.type == IntegralType::INT || right.type == IntegralType::INT ? IntegralType::INT : IntegralType::UINT;
+    type_info.size = std::max(left.size, right.size);
+    type_info.name = (type_info.type == IntegralType::INT ? "int" : "uint") + std::to_string(type_info.size * 8);
+    return type_info;
+}
+
 IRGenerator::IntegralType IRGenerator::get_integral_type(const std::string &name) {
     if (name == "string") return IntegralType::STRING;
     if (name == "bool") return IntegralType::BOOL;
@@ -888,7 +1457,9 @@ const bool IRGenerator::match_type(const std::string &id, const std::initializer
 
 IRGenerator::TypeInfo::TypeInfo() : name("unknown"), type(IntegralType::UNKNOWN), size(0) {}
 
-IRGenerator::StackEntry::StackEntry() : offset(0) {}
+IRGenerator::StackEntry::StackEntry() : offset(0), slot(Mir::none), is_final(false) {}
+
+IRGenerator::ExprFrame::ExprFrame(const Parser::Node *expr) : expr(expr), stage(0), left(Mir::none), value(Mir::none), slot(Mir::none), end(Mir::none) {}
 
 IRGenerator::StackInfo::StackInfo() : size(0) {}
 
@@ -913,10 +1484,12 @@ bool IRGenerator::StackInfo::exists(const std::string &id) {
     }
 }
 
-void IRGenerator::StackInfo::push(const std::string &id, const TypeInfo &type) {
+void IRGenerator::StackInfo::push(const std::string &id, const TypeInfo &type, const uint32_t &slot, const bool &is_final) {
     StackEntry entry;
     entry.offset = get_bottom();
     entry.type = type;
+    entry.slot = slot;
+    entry.is_final = is_final;
     keys.insert({id, entry});
 }
 
@@ -936,14 +1509,22 @@ const IRGenerator::Segment& IRGenerator::get_text() const {
     return text;
 }
 
-const std::vector<std::unique_ptr<IRGenerator::Declaration>>& IRGenerator::get_labels() const {
-    return labels;
+const Mir& IRGenerator::get_mir() const {
+    return mir;
 }
 
 const bool& IRGenerator::get_success() const {
     return success;
 }
 
+const double& IRGenerator::get_elapsed() const {
+    return elapsed;
+}
+
+const int& IRGenerator::get_level() const {
+    return level;
+}
+
 void IRGenerator::log() const {
     std::cout << " -- IR result -- " << '\n';
     std::cout << "extern: (";
@@ -970,9 +1551,11 @@ void IRGenerator::log() const {
     for (const auto &n : text.declarations) {
         n->log();
     }
-    for (const auto &n : labels) {
-        n->log();
+    std::cout << '\n';
+    for (size_t i = 0; i < removed.size(); ++i) {
+        std::cout << "Removed " << removed[i] << " dead instructions from '" << mir.functions[i].id << "'" << '\n';
     }
+    std::cout << "Generated in " << elapsed << " ms" << '\n';
     std::cout << '\n';
 }
 
@@ -1086,10 +1669,78 @@ void IRGenerator::Segment::log() const {
     std::cout << ")" << '\n';
 }
 
-IRGenerator::Instruction::Instruction() {}
+// Mnemonic of each opcode and the names log() gives its operands.
+static constexpr struct {
+    const char *mnemonic;
+    const char *dst;
+    const char *src;
+} opcodes[] = {
+    {"push", "src", nullptr},
+    {"mov", "dst", "src"},
+    {"movsx", "dst", "src"},
+    {"movsxd", "dst", "src"},
+    {"movzx", "dst", "src"},
+    {"lea", "dst", "src"},
+    {"neg", "dst", nullptr},
+    {"not", "dst", nullptr},
+    {"imul", "dst", "src"},
+    {"idiv", "src", nullptr},
+    {"div", "src", nullptr},
+    {"cdq", nullptr, nullptr},
+    {"cqo", nullptr, nullptr},
+    {"add", "dst", "src"},
+    {"sub", "dst", "src"},
+    {"cmp", "left", "right"},
+    {"sete", "dst", nullptr},
+    {"setne", "dst", nullptr},
+    {"setg", "dst", nullptr},
+    {"setge", "dst", nullptr},
+    {"setl", "dst", nullptr},
+    {"setle", "dst", nullptr},
+    {"seta", "dst", nullptr},
+    {"setae", "dst", nullptr},
+    {"setb", "dst", nullptr},
+    {"setbe", "dst", nullptr},
+    {"cmove", "dst", "src"},
+    {"cmovne", "dst", "src"},
+    {"xor", "dst", "src"},
+    {"and", "dst", "src"},
+    {"or", "dst", "src"},
+    {"shl", "dst", "src"},
+    {"shr", "dst", "src"},
+    {"sar", "dst", "src"},
+    {"label", "id", nullptr},
+    {"jmp", "dst", nullptr},
+    {"je", "dst", nullptr},
+    {"jne", "dst", nullptr},
+    {"jg", "dst", nullptr},
+    {"jge", "dst", nullptr},
+    {"jl", "dst", nullptr},
+    {"jle", "dst", nullptr},
+    {"ja", "dst", nullptr},
+    {"jae", "dst", nullptr},
+    {"jb", "dst", nullptr},
+    {"jbe", "dst", nullptr},
+    {"leave", nullptr, nullptr},
+    {"ret", nullptr, nullptr},
+    {"call", "id", nullptr},
+};
+
+IRGenerator::Instruction::Instruction(const Opcode &op, const Operand &dst, const Operand &src) : op(op), dst(dst), src(src) {}
+
+const char* IRGenerator::Instruction::get_mnemonic() const {
+    return opcodes[op].mnemonic;
+}
 
 void IRGenerator::Instruction::log() const {
-    std::cout << "instruction" << '\n';
+    std::cout << opcodes[op].mnemonic;
+    if (opcodes[op].dst) {
+        std::cout << ": (";
+        std::cout << opcodes[op].dst << ": '" << dst;
+        if (opcodes[op].src) std::cout << "', " << opcodes[op].src << ": '" << src;
+        std::cout << "')";
+    }
+    std::cout << '\n';
 }
 
 IRGenerator::Entry::Entry() {}
@@ -1105,285 +1756,109 @@ void IRGenerator::Entry::log() const {
         std::cout << '\n';
         for (const auto &t : instructions) {
             std::cout << '\t';
-            t->log();
+            t.log();
         }
     }
     std::cout << "))" << '\n';
 }
 
-IRGenerator::Push::Push() {}
 
-IRGenerator::Push::Push(const std::string &src) : src(src) {}
+IRGenerator::Push::Push(const Operand &src) : Instruction(PUSH, src) {}
 
-void IRGenerator::Push::log() const {
-    std::cout << "push: (";
-    std::cout << "src: '";
-    std::cout << src;
-    std::cout << "')" << '\n';
-}
+IRGenerator::Mov::Mov(const Operand &dst, const Operand &src) : Instruction(MOV, dst, src) {}
 
-IRGenerator::Mov::Mov() {}
+IRGenerator::Movsx::Movsx(const Operand &dst, const Operand &src) : Instruction(MOVSX, dst, src) {}
 
-IRGenerator::Mov::Mov(const std::string &dst, const std::string &src) : dst(dst), src(src) {}
+IRGenerator::Movsxd::Movsxd(const Operand &dst, const Operand &src) : Instruction(MOVSXD, dst, src) {}
 
-void IRGenerator::Mov::log() const {
-    std::cout << "mov: (";
-    std::cout << "dst: '";
-    std::cout << dst;
-    std::cout << "', src: '";
-    std::cout << src;
-    std::cout << "')" << '\n';
-}
+IRGenerator::Movzx::Movzx(const Operand &dst, const Operand &src) : Instruction(MOVZX, dst, src) {}
 
-IRGenerator::Movsx::Movsx() {}
+IRGenerator::Lea::Lea(const Operand &dst, const Operand &src) : Instruction(LEA, dst, src) {}
 
-IRGenerator::Movsx::Movsx(const std::string &dst, const std::string &src) : dst(dst), src(src) {}
+IRGenerator::Neg::Neg(const Operand &dst) : Instruction(NEG, dst) {}
 
-void IRGenerator::Movsx::log() const {
-    std::cout << "movsx: (";
-    std::cout << "dst: '";
-    std::cout << dst;
-    std::cout << "', src: '";
-    std::cout << src;
-    std::cout << "')" << '\n';
-}
+IRGenerator::Not::Not(const Operand &dst) : Instruction(NOT, dst) {}
 
-IRGenerator::Lea::Lea() {}
+IRGenerator::Imul::Imul(const Operand &dst, const Operand &src) : Instruction(IMUL, dst, src) {}
 
-IRGenerator::Lea::Lea(const std::string &dst, const std::string &src) : dst(dst), src(src) {}
+IRGenerator::Idiv::Idiv(const Operand &src) : Instruction(IDIV, src) {}
 
-void IRGenerator::Lea::log() const {
-    std::cout << "lea: (";
-    std::cout << "dst: '";
-    std::cout << dst;
-    std::cout << "', src: '";
-    std::cout << src;
-    std::cout << "')" << '\n';
-}
+IRGenerator::Div::Div(const Operand &src) : Instruction(DIV, src) {}
 
-IRGenerator::Neg::Neg() {}
+IRGenerator::Cdq::Cdq() : Instruction(CDQ) {}
 
-IRGenerator::Neg::Neg(const std::string &dst) : dst(dst) {}
+IRGenerator::Cqo::Cqo() : Instruction(CQO) {}
 
-void IRGenerator::Neg::log() const {
-    std::cout << "neg: (";
-    std::cout << "dst: '";
-    std::cout << dst;
-    std::cout << "')" << '\n';
-}
+IRGenerator::Add::Add(const Operand &dst, const Operand &src) : Instruction(ADD, dst, src) {}
 
-IRGenerator::Imul::Imul() {}
+IRGenerator::Sub::Sub(const Operand &dst, const Operand &src) : Instruction(SUB, dst, src) {}
 
-IRGenerator::Imul::Imul(const std::string &dst, const std::string &src) : dst(dst), src(src) {}
+IRGenerator::Cmp::Cmp(const Operand &left, const Operand &right) : Instruction(CMP, left, right) {}
 
-void IRGenerator::Imul::log() const {
-    std::cout << "imul: (";
-    std::cout << "dst: '";
-    std::cout << dst;
-    std::cout << "', src: '";
-    std::cout << src;
-    std::cout << "')" << '\n';
-}
+IRGenerator::Sete::Sete(const Operand &dst) : Instruction(SETE, dst) {}
 
-IRGenerator::Idiv::Idiv() {}
+IRGenerator::Setne::Setne(const Operand &dst) : Instruction(SETNE, dst) {}
 
-IRGenerator::Idiv::Idiv(const std::string &src) : src(src) {}
+IRGenerator::Setg::Setg(const Operand &dst) : Instruction(SETG, dst) {}
 
-void IRGenerator::Idiv::log() const {
-    std::cout << "idiv: (";
-    std::cout << "src: '";
-    std::cout << src;
-    std::cout << "')" << '\n';
-}
+IRGenerator::Setge::Setge(const Operand &dst) : Instruction(SETGE, dst) {}
 
-IRGenerator::Add::Add() {}
+IRGenerator::Setl::Setl(const Operand &dst) : Instruction(SETL, dst) {}
 
-IRGenerator::Add::Add(const std::string &dst, const std::string &src) : dst(dst), src(src) {}
+IRGenerator::Setle::Setle(const Operand &dst) : Instruction(SETLE, dst) {}
 
-void IRGenerator::Add::log() const {
-    std::cout << "add: (";
-    std::cout << "dst: '";
-    std::cout << dst;
-    std::cout << "', src: '";
-    std::cout << src;
-    std::cout << "')" << '\n';
-}
+IRGenerator::Seta::Seta(const Operand &dst) : Instruction(SETA, dst) {}
 
-IRGenerator::Sub::Sub() {}
+IRGenerator::Setae::Setae(const Operand &dst) : Instruction(SETAE, dst) {}
 
-IRGenerator::Sub::Sub(const std::string &dst, const std::string &src) : dst(dst), src(src) {}
+IRGenerator::Setb::Setb(const Operand &dst) : Instruction(SETB, dst) {}
 
-void IRGenerator::Sub::log() const {
-    std::cout << "sub: (";
-    std::cout << "dst: '";
-    std::cout << dst;
-    std::cout << "', src: '";
-    std::cout << src;
-    std::cout << "')" << '\n';
-}
+IRGenerator::Setbe::Setbe(const Operand &dst) : Instruction(SETBE, dst) {}
 
-IRGenerator::Cmp::Cmp() {}
+IRGenerator::Cmove::Cmove(const Operand &dst, const Operand &src) : Instruction(CMOVE, dst, src) {}
 
-IRGenerator::Cmp::Cmp(const std::string &left, const std::string &right) : left(left), right(right) {}
+IRGenerator::Cmovne::Cmovne(const Operand &dst, const Operand &src) : Instruction(CMOVNE, dst, src) {}
 
-void IRGenerator::Cmp::log() const {
-    std::cout << "cmp: (";
-    std::cout << "left: '";
-    std::cout << left;
-    std::cout << "', right: '";
-    std::cout << right;
-    std::cout << "')" << '\n';
-}
+IRGenerator::Xor::Xor(const Operand &dst, const Operand &src) : Instruction(XOR, dst, src) {}
 
-IRGenerator::Sete::Sete() {}
+IRGenerator::And::And(const Operand &dst, const Operand &src) : Instruction(AND, dst, src) {}
 
-IRGenerator::Sete::Sete(const std::string &dst) : dst(dst) {}
+IRGenerator::Or::Or(const Operand &dst, const Operand &src) : Instruction(OR, dst, src) {}
 
-void IRGenerator::Sete::log() const {
-    std::cout << "sete: (";
-    std::cout << "dst: '";
-    std::cout << dst;
-    std::cout << "')" << '\n';
-}
+IRGenerator::Shl::Shl(const Operand &dst, const Operand &src) : Instruction(SHL, dst, src) {}
 
-IRGenerator::Setne::Setne() {}
+IRGenerator::Shr::Shr(const Operand &dst, const Operand &src) : Instruction(SHR, dst, src) {}
 
-IRGenerator::Setne::Setne(const std::string &dst) : dst(dst) {}
+IRGenerator::Sar::Sar(const Operand &dst, const Operand &src) : Instruction(SAR, dst, src) {}
 
-void IRGenerator::Setne::log() const {
-    std::cout << "setne: (";
-    std::cout << "dst: '";
-    std::cout << dst;
-    std::cout << "')" << '\n';
-}
+IRGenerator::Label::Label(const Operand &id) : Instruction(LABEL, id) {}
 
-IRGenerator::Setg::Setg() {}
+IRGenerator::Jmp::Jmp(const Operand &dst) : Instruction(JMP, dst) {}
 
-IRGenerator::Setg::Setg(const std::string &dst) : dst(dst) {}
+IRGenerator::Je::Je(const Operand &dst) : Instruction(JE, dst) {}
 
-void IRGenerator::Setg::log() const {
-    std::cout << "setg: (";
-    std::cout << "dst: '";
-    std::cout << dst;
-    std::cout << "')" << '\n';
-}
+IRGenerator::Jne::Jne(const Operand &dst) : Instruction(JNE, dst) {}
 
-IRGenerator::Setge::Setge() {}
+IRGenerator::Jg::Jg(const Operand &dst) : Instruction(JG, dst) {}
 
-IRGenerator::Setge::Setge(const std::string &dst) : dst(dst) {}
+IRGenerator::Jge::Jge(const Operand &dst) : Instruction(JGE, dst) {}
 
-void IRGenerator::Setge::log() const {
-    std::cout << "setge: (";
-    std::cout << "dst: '";
-    std::cout << dst;
-    std::cout << "')" << '\n';
-}
+IRGenerator::Jl::Jl(const Operand &dst) : Instruction(JL, dst) {}
 
-IRGenerator::Setl::Setl() {}
+IRGenerator::Jle::Jle(const Operand &dst) : Instruction(JLE, dst) {}
 
-IRGenerator::Setl::Setl(const std::string &dst) : dst(dst) {}
+IRGenerator::Ja::Ja(const Operand &dst) : Instruction(JA, dst) {}
 
-void IRGenerator::Setl::log() const {
-    std::cout << "setl: (";
-    std::cout << "dst: '";
-    std::cout << dst;
-    std::cout << "')" << '\n';
-}
-
-IRGenerator::Setle::Setle() {}
-
-IRGenerator::Setle::Setle(const std::string &dst) : dst(dst) {}
-
-void IRGenerator::Setle::log() const {
-    std::cout << "setle: (";
-    std::cout << "dst: '";
-    std::cout << dst;
-    std::cout << "')" << '\n';
-}
-
-IRGenerator::Cmove::Cmove() {}
-
-IRGenerator::Cmove::Cmove(const std::string &dst, const std::string &src) : dst(dst), src(src) {}
-
-void IRGenerator::Cmove::log() const {
-    std::cout << "cmove: (";
-    std::cout << "dst: '";
-    std::cout << dst;
-    std::cout << "', src: '";
-    std::cout << src;
-    std::cout << "')" << '\n';
-}
+IRGenerator::Jae::Jae(const Operand &dst) : Instruction(JAE, dst) {}
 
-IRGenerator::Xor::Xor() {}
+IRGenerator::Jb::Jb(const Operand &dst) : Instruction(JB, dst) {}
 
-IRGenerator::Xor::Xor(const std::string &dst, const std::string &src) : dst(dst), src(src) {}
+IRGenerator::Jbe::Jbe(const Operand &dst) : Instruction(JBE, dst) {}
 
-void IRGenerator::Xor::log() const {
-    std::cout << "xor: (";
-    std::cout << "dst: '";
-    std::cout << dst;
-    std::cout << "', src: '";
-    std::cout << src;
-    std::cout << "')" << '\n';
-}
+IRGenerator::Leave::Leave() : Instruction(LEAVE) {}
 
-IRGenerator::Label::Label(const std::string &id) : id(id) {}
+IRGenerator::Ret::Ret() : Instruction(RET) {}
 
-void IRGenerator::Label::log() const {
-    std::cout << "label: (";
-    std::cout << "id: '";
-    std::cout << id;
-    std::cout << "')" << '\n';
-}
-
-IRGenerator::Jmp::Jmp(const std::string &dst) : dst(dst) {}
-
-void IRGenerator::Jmp::log() const {
-    std::cout << "jmp: (";
-    std::cout << "dst: '";
-    std::cout << dst;
-    std::cout << "')" << '\n';
-}
-
-IRGenerator::Je::Je(const std::string &dst) : dst(dst) {}
-
-void IRGenerator::Je::log() const {
-    std::cout << "je: (";
-    std::cout << "dst: '";
-    std::cout << dst;
-    std::cout << "')" << '\n';
-}
-
-IRGenerator::Jne::Jne(const std::string &dst) : dst(dst) {}
-
-void IRGenerator::Jne::log() const {
-    std::cout << "jne: (";
-    std::cout << "dst: '";
-    std::cout << dst;
-    std::cout << "')" << '\n';
-}
-
-IRGenerator::Leave::Leave() {}
-
-void IRGenerator::Leave::log() const {
-    std::cout << "leave" << '\n';
-}
-
-IRGenerator::Ret::Ret() {}
-
-void IRGenerator::Ret::log() const {
-    std::cout << "ret" << '\n';
-}
-
-IRGenerator::Call::Call() {}
-
-IRGenerator::Call::Call(const std::string &id) : id(id) {}
-
-void IRGenerator::Call::log() const {
-    std::cout << "call: (";
-    std::cout << "id: '";
-    std::cout << id;
-    std::cout << "')" << '\n';
-}
+IRGenerator::Call::Call(const Operand &id) : Instruction(CALL, id) {}
 
 IRGenerator::ClassInfo::ClassInfo(const std::string &id) : id(id) {}
\ No newline at end of file
@@ -1,243 +1,609 @@
 #include <program/lexer.h>
 
-const std::vector<std::string> Lexer::keywords = {
-    "use",
-
-    "module",
-    "class",
-
-    "constructor",
-    "destructor",
-
-    "if",
-    "else",
-
-    "for",
-    "while",
-
-    "return",
-    "break",
-    "continue",
-
-    "secure",
-    "limited",
-    "open",
-
-    "virtual",
-    "override",
-    "extends",
-
-    "public",
-    "private",
-
-    "static",
-    "final", // const
-    "persistent",
-
-    "new",
-    "delete",
-
-    "in",
-    "as",
-};
-
-const std::vector<std::string> Lexer::operators = {
-    "=",
-    "!",
-    "+",
-    "+=",
-    "-",
-    "-=",
-    "*",
-    "*=",
-    "**",
-    "**=",
-    "/",
-    "/=",
-    "//",
-    "//=",
-    "%",
-    "%=",
-    "==",
-    "!=",
-    "<",
-    "<=",
-    ">",
-    ">=",
-};
-
-const std::vector<std::string> Lexer::punctuators = {
-    ";",
-    ".",
-    ",",
-    "(",
-    ")",
-    "{",
-    "}",
-    "[",
-    "]",
-};
-
-Lexer::Lexer(const Source &source) {
+// Streamed sources are released behind the lexer in steps of this size,
+// token values stay valid as released pages are read back on access.
+static constexpr size_t release_step = 4 * 1024 * 1024;
+
+Lexer::Lexer(const Source &source) : source(source) {
+    init(0, source.get().length());
+
+    // Reserve for a typical token density so the arrays are not regrown over
+    // and over on large inputs.
+    categories.reserve(bytes / 4);
+    symbols.reserve(bytes / 4);
+    offsets.reserve(bytes / 4);
+
+    if (!lex(SIZE_MAX)) unknown_token();
+}
+
+Lexer::Lexer(const Source &source, const ThreadPool &pool) : source(source) {
+    init(0, source.get().length());
+
+    if (pool.get_workers() < 2 || bytes < parallel_threshold) {
+        categories.reserve(bytes / 4);
+        symbols.reserve(bytes / 4);
+        offsets.reserve(bytes / 4);
+
+        if (!lex(SIZE_MAX)) unknown_token();
+        return;
+    }
+
+    const auto start = std::chrono::high_resolution_clock::now();
+    lex_parallel(pool);
+    const auto end = std::chrono::high_resolution_clock::now();
+    elapsed = std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+Lexer::Lexer(const Source &source, const size_t &window) : source(source) {
+    init(0, source.get().length());
+    streaming = true;
+
+    // The parser looks a few tokens back or ahead at most, the floor keeps
+    // that inside the half window that stays readable.
+    size_t capacity = 16;
+    while (capacity < window) capacity <<= 1;
+    mask = capacity - 1;
+
+    categories.resize(capacity);
+    symbols.resize(capacity);
+    offsets.resize(capacity);
+}
+
+// A chunk of a parallel lex, covers tokens starting in [begin, end).
+Lexer::Lexer(const Source &source, const size_t &begin, const size_t &end) : source(source) {
+    init(begin, end);
+    release_at = SIZE_MAX;
+}
+
+void Lexer::init(const size_t &begin, const size_t &end) {
     success = true;
+    lines_indexed = false;
+    streaming = false;
+    mask = SIZE_MAX;
+    produced = 0;
+    oldest = 0;
+    cursor = begin;
+    bound = end;
+    elapsed = 0.0;
+    bytes = source.get().length();
+    release_at = source.get_mode() == Source::STREAMED ? release_step : SIZE_MAX;
+
+    if (bytes > UINT32_MAX) {
+        success = false;
+        throw std::runtime_error("Source exceeds 4 GiB and cannot be lexed.");
+    }
+}
 
-    lex(source.get());
+inline void Lexer::push(const TokenCategory &category, const size_t &offset, const uint32_t &data) const {
+    if (streaming) {
+        const size_t i = produced & mask;
+        categories[i] = category;
+        symbols[i] = data;
+        offsets[i] = static_cast<uint32_t>(offset);
+    } else {
+        categories.push_back(category);
+        symbols.push_back(data);
+        offsets.push_back(static_cast<uint32_t>(offset));
+    }
+    ++produced;
 }
 
-void Lexer::lex(const std::string &raw) {
-    Token ct;
-    line = 1;
+// Lexes from 'cursor' until 'limit' tokens have been produced in total or the
+// next token would start at or past 'bound'. Returns false when it stops on a
+// character no token starts with, leaving 'cursor' on it.
+const bool Lexer::lex(const size_t &limit) const {
+    const std::string_view raw = source.get();
+    const auto start_time = std::chrono::high_resolution_clock::now();
+
+    size_t i = cursor;
+    while (i < bound && produced < limit) {
+        if (i >= release_at) {
+            source.release(i);
+            release_at = i + release_step;
+        }
 
-    for (int i = 0; i < raw.length(); ++i) {
         const char c = raw[i];
 
         // Skip whitespace
-        if (std::isspace(c)) {
-            if (c == '\n') {
-                ++line;
-            }
+        if (Scanner::is_space(c)) {
+            i = Scanner::skip_whitespace(raw, i);
             continue;
         }
 
-        // Reset token value
-        ct.category = UNKNOWN;
-        ct.value = "";
-        ct.line = line;
+        const size_t start = i;
 
         // Comments
-        if (c == '/') {
+        if (c == '/' && i + 1 < raw.length()) {
             if (raw[i + 1] == '/') {
-                while (i + 1 < raw.length() && raw[i + 1] != '\n') {
-                    ++i;
-                }
-                ++i;
-                ++line;
+                i = Scanner::find_char(raw, i + 2, '\n');
                 continue;
             } else if (raw[i + 1] == '*') {
-                while (i + 1 < raw.length() && c != '*' && raw[i + 1] != '/') {
-                    ++i;
-                }
-                ++i;
+                i = std::min(Scanner::find_block_end(raw, i + 2) + 2, raw.length());
                 continue;
             }
         }
 
         // Keyword, identifier & boolean literal
-        if (std::isalpha(c)) {
-            ct.value += c;
-            while (i + 1 < raw.length() && (std::isalpha(raw[i + 1]) || std::isdigit(raw[i + 1]) || raw[i + 1] == '_')) {
-                ct.value += raw[++i];
-            }
-            if (ct.value == "false" || ct.value == "true") {
-                ct.category = BOOLEAN_LITERAL;
+        if (Scanner::is_alpha(c)) {
+            i = Scanner::skip_identifier(raw, i + 1);
+            const auto value = raw.substr(start, i - start);
+            const Interner::Symbol keyword = match_keyword(value);
+            if (keyword == Interner::LITERAL_TRUE || keyword == Interner::LITERAL_FALSE) {
+                push(BOOLEAN_LITERAL, start, keyword);
+            } else if (keyword != Interner::NONE) {
+                push(KEYWORD, start, keyword);
             } else {
-                ct.category = is_keyword(ct.value) ? KEYWORD : IDENTIFIER;
+                push(IDENTIFIER, start, interner.intern(value));
             }
-            tokens.push_back(ct);
             continue;
         }
 
         // Integer & float literal
-        if (std::isdigit(c)) {
-            ct.value += c;
-            while (i + 1 < raw.length() && std::isdigit(raw[i + 1])) {
-                ct.value += raw[++i];
+        if (Scanner::is_digit(c)) {
+            i = Scanner::skip_digits(raw, i + 1);
+            TokenCategory category = INTEGER_LITERAL;
+            if (i + 1 < raw.length() && raw[i] == '.' && Scanner::is_digit(raw[i + 1])) {
+                i = Scanner::skip_digits(raw, i + 2);
+                category = FLOAT_LITERAL;
             }
-            ct.category = INTEGER_LITERAL;
-            if (raw[i + 1] == '.' && std::isdigit(raw[i + 2])) {
-                ct.value += raw[++i];
-                while (i + 1 < raw.length() && std::isdigit(raw[i + 1])) {
-                    ct.value += raw[++i];
-                }
-                ct.category = FLOAT_LITERAL;
-            }
-            tokens.push_back(ct);
+            push(category, start, static_cast<uint32_t>(i - start));
             continue;
         }
 
         // Operator
-        if (is_operator(std::string(1, c))) {
-            ct.value += c;
-            while (i + 1 < raw.length() && is_operator(ct.value + raw[i + 1])) {
-                ct.value += raw[++i];
-            }
-            ct.category = OPERATOR;
-            tokens.push_back(ct);
+        Interner::Symbol symbol = Interner::NONE;
+        if (const size_t length = match_operator(raw, i, symbol)) {
+            push(OPERATOR, start, symbol);
+            i += length;
             continue;
         }
 
         // Punctuator
-        if (is_punctuator(std::string(1, c))) {
-            ct.value += c;
-            while (i + 1 < raw.length() && is_punctuator(ct.value + raw[i + 1])) {
-                ct.value += raw[++i];
-            }
-            ct.category = PUNCTUATOR;
-            tokens.push_back(ct);
+        if ((symbol = match_punctuator(c)) != Interner::NONE) {
+            push(PUNCTUATOR, start, symbol);
+            ++i;
             continue;
         }
 
         // String literal
         if (c == '"') {
-            while (i + 1 < raw.length() && raw[i + 1] != '"') {
-                ct.value += raw[++i];
-            }
-            ct.category = STRING_LITERAL;
-            tokens.push_back(ct);
-            ++i;
+            i = Scanner::find_char(raw, i + 1, '"');
+            push(STRING_LITERAL, start + 1, static_cast<uint32_t>(i - start - 1));
+            i = std::min(i + 1, raw.length());
             continue;
         }
 
         // Unknown token
-        success = false;
-        for (const auto &t : tokens) {
-            std::cout << t.value << '\n';
-        }
-        throw std::runtime_error("Unknown token: " + ct.value);
+        break;
     }
+
+    cursor = i;
+    const auto end_time = std::chrono::high_resolution_clock::now();
+    elapsed += std::chrono::duration<double, std::milli>(end_time - start_time).count();
+    return i >= bound || produced >= limit;
 }
 
-const bool Lexer::is_keyword(const std::string &value) const {
-    for (const auto &e : keywords) {
-        if (value == e) {
-            return true;
+void Lexer::unknown_token() const {
+    success = false;
+    throw std::runtime_error("[Line " + std::to_string(get_line(cursor)) + "] Unknown token: " + std::string(1, source.get()[cursor]));
+}
+
+// Splits the source at newlines and lexes the chunks speculatively in
+// parallel, each as if it started outside of any token. That only goes wrong
+// when a string literal or block comment runs over a chunk boundary, so the
+// chunks are stitched together in order: wherever the previous chunk really
+// ended past the boundary, lexing continues serially until a token lines up
+// with one of the speculative ones, from where on the chunk is known to agree.
+// Offsets are absolute so line lookups need no adjustment, chunk-local
+// identifier ids are remapped into the shared interner.
+void Lexer::lex_parallel(const ThreadPool &pool) {
+    const std::string_view raw = source.get();
+
+    const size_t count = std::max<size_t>(1, std::min(pool.get_workers() * 4, bytes / parallel_chunk));
+    std::vector<size_t> bounds = {0};
+    for (size_t k = 1; k < count; ++k) {
+        const size_t at = Scanner::find_char(raw, bytes * k / count, '\n') + 1;
+        if (at > bounds.back() && at < bytes) bounds.push_back(at);
+    }
+    bounds.push_back(bytes);
+
+    const size_t chunk_count = bounds.size() - 1;
+    std::vector<std::unique_ptr<Lexer>> chunks;
+    for (size_t k = 0; k < chunk_count; ++k) {
+        chunks.push_back(std::unique_ptr<Lexer>(new Lexer(source, bounds[k], bounds[k + 1])));
+    }
+
+    std::vector<uint8_t> complete(chunk_count, 0);
+    pool.run(chunk_count, [&](const size_t &k) {
+        Lexer &chunk = *chunks[k];
+        chunk.categories.reserve((bounds[k + 1] - bounds[k]) / 4);
+        chunk.symbols.reserve((bounds[k + 1] - bounds[k]) / 4);
+        chunk.offsets.reserve((bounds[k + 1] - bounds[k]) / 4);
+        complete[k] = chunk.lex(SIZE_MAX);
+    });
+
+    size_t total = 0;
+    for (const auto &chunk : chunks) {
+        total += chunk->size();
+    }
+    categories.reserve(total);
+    symbols.reserve(total);
+    offsets.reserve(total);
+
+    std::vector<uint32_t> remap;
+    for (size_t k = 0; k < chunk_count; ++k) {
+        const Lexer &chunk = *chunks[k];
+        size_t from = 0;
+
+        if (cursor > bounds[k]) {
+            bound = bounds[k + 1];
+            bool aligned = false;
+            while (cursor < bound && !aligned) {
+                const size_t before = produced;
+                if (!lex(produced + 1)) unknown_token();
+                if (produced == before) break;
+
+                const uint32_t offset = offsets.back();
+                while (from < chunk.size() && chunk.offsets[from] < offset) ++from;
+                aligned = from < chunk.size() && chunk.offsets[from] == offset && chunk.categories[from] == categories.back();
+            }
+            bound = bytes;
+
+            // Relexed up to the chunk's end without lining up, nothing of it is kept
+            if (!aligned) continue;
+            ++from;
+        }
+
+        remap.resize(chunk.interner.size());
+        for (uint32_t id = 0; id < remap.size(); ++id) {
+            remap[id] = id < Interner::DYNAMIC ? id : interner.intern(chunk.interner.get(id));
         }
+
+        for (size_t t = from; t < chunk.size(); ++t) {
+            const TokenCategory category = chunk.categories[t];
+            push(category, chunk.offsets[t], category == IDENTIFIER ? remap[chunk.symbols[t]] : chunk.symbols[t]);
+        }
+        cursor = chunk.cursor;
+
+        // The chunk stopped on an unknown character, which is real now that
+        // the chunk is known to be aligned.
+        if (!complete[k]) unknown_token();
     }
-    return false;
 }
 
-const bool Lexer::is_operator(const std::string &value) const {
-    for (const auto& e : operators) {
-        if (value == e) {
-            return true;
+// Relexing starts at the last token before the edit, since an edit right
+// after a token can extend it, and stops at the first new token past the
+// inserted text that lines up with an old one, shifted by the size change.
+// Lexing from the same position in the same state goes the same way, so every
+// old token from there on is kept and only has its offset shifted.
+const Lexer::Splice Lexer::relex(const size_t &offset, const size_t &removed, const size_t &inserted) {
+    if (streaming) throw std::runtime_error("A streaming lexer cannot be relexed.");
+
+    const auto start_time = std::chrono::high_resolution_clock::now();
+    bytes = source.get().length();
+    lines_indexed = false;
+    if (bytes > UINT32_MAX) {
+        success = false;
+        throw std::runtime_error("Source exceeds 4 GiB and cannot be lexed.");
+    }
+
+    const int64_t delta = static_cast<int64_t>(inserted) - static_cast<int64_t>(removed);
+    const size_t after = std::lower_bound(offsets.begin(), offsets.end(), static_cast<uint32_t>(offset)) - offsets.begin();
+
+    Splice splice;
+    splice.first = after > 0 ? after - 1 : 0;
+    const size_t restart = after > 0 ? get_start(splice.first) : 0;
+
+    Lexer scratch(source, restart, bytes);
+    size_t next = splice.first;
+    bool aligned = false;
+    while (!aligned && scratch.cursor < bytes) {
+        const size_t before = scratch.produced;
+        if (!scratch.lex(before + 1)) {
+            cursor = scratch.cursor;
+            unknown_token();
         }
+        if (scratch.produced == before) break;
+        if (scratch.get_start(before) < offset + inserted) continue;
+
+        const int64_t old = static_cast<int64_t>(scratch.offsets[before]) - delta;
+        while (next < produced && offsets[next] < old) ++next;
+        aligned = next < produced && offsets[next] == old && categories[next] == scratch.categories[before] && get_start(next) >= offset + removed;
+    }
+
+    // The aligned token is the old one, keep that instead of the relexed copy
+    if (aligned) {
+        scratch.categories.pop_back();
+        scratch.symbols.pop_back();
+        scratch.offsets.pop_back();
+        --scratch.produced;
+    } else {
+        next = produced;
+    }
+    splice.removed = next - splice.first;
+    splice.inserted = scratch.produced;
+
+    std::vector<uint32_t> remap(scratch.interner.size());
+    for (uint32_t id = 0; id < remap.size(); ++id) {
+        remap[id] = id < Interner::DYNAMIC ? id : interner.intern(scratch.interner.get(id));
+    }
+    for (size_t t = 0; t < scratch.produced; ++t) {
+        if (scratch.categories[t] == IDENTIFIER) scratch.symbols[t] = remap[scratch.symbols[t]];
+    }
+
+    const auto first = static_cast<std::ptrdiff_t>(splice.first);
+    const auto last = static_cast<std::ptrdiff_t>(next);
+    categories.erase(categories.begin() + first, categories.begin() + last);
+    categories.insert(categories.begin() + first, scratch.categories.begin(), scratch.categories.end());
+    symbols.erase(symbols.begin() + first, symbols.begin() + last);
+    symbols.insert(symbols.begin() + first, scratch.symbols.begin(), scratch.symbols.end());
+    offsets.erase(offsets.begin() + first, offsets.begin() + last);
+    offsets.insert(offsets.begin() + first, scratch.offsets.begin(), scratch.offsets.end());
+
+    for (size_t t = splice.first + splice.inserted; t < offsets.size(); ++t) {
+        offsets[t] = static_cast<uint32_t>(offsets[t] + delta);
     }
-    return false;
+
+    produced = categories.size();
+    cursor = bytes;
+    bound = bytes;
+
+    const auto end_time = std::chrono::high_resolution_clock::now();
+    elapsed = std::chrono::duration<double, std::milli>(end_time - start_time).count();
+    return splice;
+}
+
+// Offset the token's text starts at, string literals begin at their quote.
+const size_t Lexer::get_start(const size_t &i) const {
+    return offsets[i] - (categories[i] == STRING_LITERAL ? 1 : 0);
 }
 
-const bool Lexer::is_punctuator(const std::string &value) const {
-    for (const auto& e : punctuators) {
-        if (value == e) {
-            return true;
+void Lexer::index_lines() const {
+    const std::string_view raw = source.get();
+    newlines.clear();
+    for (size_t i = Scanner::find_char(raw, 0, '\n'); i < raw.length(); i = Scanner::find_char(raw, i + 1, '\n')) {
+        newlines.push_back(static_cast<uint32_t>(i));
+    }
+    lines_indexed = true;
+}
+
+// Keywords are dispatched on length and first character, so at most a couple
+// of fixed-size compares run per identifier and nothing is allocated.
+const Interner::Symbol Lexer::match_keyword(const std::string_view &value) {
+    if (value.empty()) return Interner::NONE;
+
+    const auto is = [&value](const Interner::Symbol &symbol) {
+        return value == Interner::fixed[symbol] ? symbol : Interner::NONE;
+    };
+
+    switch (value.length()) {
+        case 2:
+            switch (value[0]) {
+                case 'i': return value[1] == 'f' ? is(Interner::KEYWORD_IF) : is(Interner::KEYWORD_IN);
+                case 'a': return is(Interner::KEYWORD_AS);
+            }
+            break;
+        case 3:
+            switch (value[0]) {
+                case 'u': return is(Interner::KEYWORD_USE);
+                case 'f': return is(Interner::KEYWORD_FOR);
+                case 'n': return is(Interner::KEYWORD_NEW);
+            }
+            break;
+        case 4:
+            switch (value[0]) {
+                case 'e': return is(Interner::KEYWORD_ELSE);
+                case 'o': return is(Interner::KEYWORD_OPEN);
+                case 't': return is(Interner::LITERAL_TRUE);
+            }
+            break;
+        case 5:
+            switch (value[0]) {
+                case 'c': return is(Interner::KEYWORD_CLASS);
+                case 'w': return is(Interner::KEYWORD_WHILE);
+                case 'b': return is(Interner::KEYWORD_BREAK);
+                case 'f': return value[1] == 'i' ? is(Interner::KEYWORD_FINAL) : is(Interner::LITERAL_FALSE);
+            }
+            break;
+        case 6:
+            switch (value[0]) {
+                case 'm': return is(Interner::KEYWORD_MODULE);
+                case 'r': return is(Interner::KEYWORD_RETURN);
+                case 's': return value[1] == 'e' ? is(Interner::KEYWORD_SECURE) : is(Interner::KEYWORD_STATIC);
+                case 'p': return is(Interner::KEYWORD_PUBLIC);
+                case 'd': return is(Interner::KEYWORD_DELETE);
+            }
+            break;
+        case 7:
+            switch (value[0]) {
+                case 'l': return is(Interner::KEYWORD_LIMITED);
+                case 'v': return is(Interner::KEYWORD_VIRTUAL);
+                case 'e': return is(Interner::KEYWORD_EXTENDS);
+                case 'p': return is(Interner::KEYWORD_PRIVATE);
+            }
+            break;
+        case 8:
+            switch (value[0]) {
+                case 'c': return is(Interner::KEYWORD_CONTINUE);
+                case 'o': return is(Interner::KEYWORD_OVERRIDE);
+            }
+            break;
+        case 10:
+            switch (value[0]) {
+                case 'd': return is(Interner::KEYWORD_DESTRUCTOR);
+                case 'p': return is(Interner::KEYWORD_PERSISTENT);
+            }
+            break;
+        case 11:
+            switch (value[0]) {
+                case 'c': return is(Interner::KEYWORD_CONSTRUCTOR);
+            }
+            break;
+    }
+    return Interner::NONE;
+}
+
+// Maximal munch over the operator set as a hand-rolled DFA, returns the length
+// of the longest operator starting at 'i' or 0 if there is none. Every
+// operator's fixed symbol is directly followed by its compound assignment, and
+// '*' and '/' by their doubled forms, so symbols are picked by offset. Doubled
+// '&' and '|' are the logical operators, which have no compound assignment.
+const size_t Lexer::match_operator(const std::string_view &raw, const size_t &i, Interner::Symbol &symbol) {
+    const char c = raw[i];
+    const char c1 = i + 1 < raw.length() ? raw[i + 1] : '\0';
+    const char c2 = i + 2 < raw.length() ? raw[i + 2] : '\0';
+
+    const auto pick = [&symbol](const Interner::Symbol &base, const size_t &offset, const size_t &length) {
+        symbol = static_cast<Interner::Symbol>(base + offset);
+        return length;
+    };
+
+    switch (c) {
+        case '=': return c1 == '=' ? pick(Interner::OPERATOR_EQUAL, 0, 2) : pick(Interner::OPERATOR_ASSIGN, 0, 1);
+        case '!': return c1 == '=' ? pick(Interner::OPERATOR_NOT_EQUAL, 0, 2) : pick(Interner::OPERATOR_NOT, 0, 1);
+        case '<':
+        case '>': {
+            const Interner::Symbol base = c == '<' ? Interner::OPERATOR_LESS : Interner::OPERATOR_GREATER;
+            const Interner::Symbol shift = c == '<' ? Interner::OPERATOR_SHL : Interner::OPERATOR_SHR;
+            if (c1 == c) return c2 == '=' ? pick(shift, 1, 3) : pick(shift, 0, 2);
+            return c1 == '=' ? pick(base, 1, 2) : pick(base, 0, 1);
+        }
+        case '&':
+        case '|': {
+            const Interner::Symbol base = c == '&' ? Interner::OPERATOR_AND : Interner::OPERATOR_OR;
+            if (c1 == c) return pick(c == '&' ? Interner::OPERATOR_LOGICAL_AND : Interner::OPERATOR_LOGICAL_OR, 0, 2);
+            return c1 == '=' ? pick(base, 1, 2) : pick(base, 0, 1);
         }
+        case '^': return c1 == '=' ? pick(Interner::OPERATOR_XOR, 1, 2) : pick(Interner::OPERATOR_XOR, 0, 1);
+        case '~': return pick(Interner::OPERATOR_COMPLEMENT, 0, 1);
+        case '+': return c1 == '=' ? pick(Interner::OPERATOR_ADD, 1, 2) : pick(Interner::OPERATOR_ADD, 0, 1);
+        case '-': return c1 == '=' ? pick(Interner::OPERATOR_SUB, 1, 2) : pick(Interner::OPERATOR_SUB, 0, 1);
+        case '%': return c1 == '=' ? pick(Interner::OPERATOR_MOD, 1, 2) : pick(Interner::OPERATOR_MOD, 0, 1);
+        case '*':
+        case '/': {
+            const Interner::Symbol base = c == '*' ? Interner::OPERATOR_MUL : Interner::OPERATOR_DIV;
+            if (c1 == c) return c2 == '=' ? pick(base, 3, 3) : pick(base, 2, 2);
+            return c1 == '=' ? pick(base, 1, 2) : pick(base, 0, 1);
+        }
+    }
+    return 0;
+}
+
+const Interner::Symbol Lexer::match_punctuator(const char &c) {
+    switch (c) {
+        case ';': return Interner::PUNCTUATOR_SEMICOLON;
+        case '.': return Interner::PUNCTUATOR_DOT;
+        case ',': return Interner::PUNCTUATOR_COMMA;
+        case '(': return Interner::PUNCTUATOR_LEFT_PAREN;
+        case ')': return Interner::PUNCTUATOR_RIGHT_PAREN;
+        case '{': return Interner::PUNCTUATOR_LEFT_BRACE;
+        case '}': return Interner::PUNCTUATOR_RIGHT_BRACE;
+        case '[': return Interner::PUNCTUATOR_LEFT_BRACKET;
+        case ']': return Interner::PUNCTUATOR_RIGHT_BRACKET;
+    }
+    return Interner::NONE;
+}
+
+// Slow path of fetch(), lexes up to token 'i' if the source has one. When
+// streaming it refills half a window ahead so the parser does not stop on
+// every token.
+const bool Lexer::refill(const size_t &i) const {
+    if (i < produced) throw std::runtime_error("Token " + std::to_string(i) + " has left the lexer window.");
+    if (!streaming || cursor >= bytes) return false;
+
+    if (!lex(i + 1 + (mask + 1) / 2)) unknown_token();
+    oldest = first();
+    return i < produced;
+}
+
+// Index of the oldest token still held.
+const size_t Lexer::first() const {
+    return streaming && produced > mask ? produced - mask - 1 : 0;
+}
+
+const bool Lexer::is_end(const size_t &i) const {
+    return !fetch(i);
+}
+
+const bool Lexer::is_streaming() const {
+    return streaming;
+}
+
+const size_t Lexer::size() const {
+    return produced;
+}
+
+const Lexer::Token Lexer::get(const size_t &i) const {
+    Token token;
+    if (fetch(i)) {
+        const size_t at = i & mask;
+        token.category = categories[at];
+        token.offset = offsets[at];
+        token.symbol = has_symbol(token.category) ? symbols[at] : Interner::NONE;
+        token.value = source.get().substr(token.offset, get_length(i));
     }
-    return false;
+    return token;
 }
 
-const std::vector<Lexer::Token>& Lexer::get() const {
-    return tokens;
+const std::string_view Lexer::get_value(const size_t &i) const {
+    if (fetch(i)) {
+        return source.get().substr(offsets[i & mask], get_length(i));
+    }
+    return std::string_view();
+}
+
+const uint32_t Lexer::get_length(const size_t &i) const {
+    const size_t at = i & mask;
+    if (has_symbol(categories[at])) return static_cast<uint32_t>(interner.get(symbols[at]).length());
+    return symbols[at];
+}
+
+const size_t Lexer::get_line(const size_t &offset) const {
+    if (!lines_indexed) index_lines();
+    return std::lower_bound(newlines.begin(), newlines.end(), offset) - newlines.begin() + 1;
+}
+
+const size_t Lexer::get_column(const size_t &offset) const {
+    if (!lines_indexed) index_lines();
+    const auto it = std::lower_bound(newlines.begin(), newlines.end(), offset);
+    if (it == newlines.begin()) return offset + 1;
+    return offset - *(it - 1);
+}
+
+const Source& Lexer::get_source() const {
+    return source;
+}
+
+const Interner& Lexer::get_interner() const {
+    return interner;
 }
 
 const bool& Lexer::get_success() const {
     return success;
 }
 
+const double& Lexer::get_elapsed() const {
+    return elapsed;
+}
+
+const double Lexer::get_throughput() const {
+    if (elapsed <= 0.0) return 0.0;
+    return (bytes / (1024.0 * 1024.0)) / (elapsed / 1000.0);
+}
+
 void Lexer::log() const {
     std::cout << " -- Lex result -- " << '\n';
-    for (const auto &t : tokens) {
-        t.log();
+    for (size_t i = first(); i < size(); ++i) {
+        get(i).log();
+        std::cout << '\n';
+    }
+    std::cout << '\n';
+    if (streaming) {
+        std::cout << "Streaming through a window of " << mask + 1 << " token(s), lexed " << cursor << " of " << bytes << " byte(s) so far" << '\n';
         std::cout << '\n';
+        return;
     }
+    std::cout << "Lexed " << bytes << " byte(s) into " << size() << " token(s) and " << interner.size() - Interner::DYNAMIC << " identifier(s) in " << elapsed << " ms (" << get_throughput() << " MB/s)" << '\n';
     std::cout << '\n';
 }
 
@@ -0,0 +1,858 @@
+#include <program/mir.h>
+
+#include <algorithm>
+
+// Names log() gives the opcodes.
+static constexpr const char *names[] = {
+    "nop", "undef", "const", "string", "arg", "phi", "load", "store",
+    "add", "sub", "mul", "div", "mod", "pow", "and", "or", "xor", "shl", "shr",
+    "eq", "ne", "lt", "le", "gt", "ge", "neg", "not",
+    "cast", "select", "format", "call", "print",
+};
+
+static void write_value(const uint32_t &value) {
+    if (value == Mir::none) std::cout << '_';
+    else std::cout << '%' << value;
+}
+
+Mir::Mir() {}
+
+int64_t Mir::normalize(const int64_t &value, const int &size, const bool &sign) {
+    if (size >= 8 || size < 1) return value;
+    const int bits = size * 8;
+    const uint64_t mask = (uint64_t(1) << bits) - 1;
+    uint64_t result = uint64_t(value) & mask;
+    if (sign && (result >> (bits - 1)) & 1) result |= ~mask;
+    return int64_t(result);
+}
+
+void Mir::log() const {
+    std::cout << " -- MIR result -- " << '\n';
+    for (const auto &function : functions) {
+        function.log();
+    }
+    std::cout << '\n';
+}
+
+Mir::Inst::Inst(const Opcode &op, const uint8_t &size, const bool &sign, const uint32_t &a, const uint32_t &b) : op(op), size(size), sign(sign), a(a), b(b), block(none), value(0) {}
+
+Mir::Block::Block() : exit(RETURN), value(none), idom(none), depth(0) {}
+
+Mir::Function::Function(const std::string &id) : id(id), current(0) {
+    add_block();
+}
+
+uint32_t Mir::Function::add_block() {
+    blocks.emplace_back();
+    return blocks.size() - 1;
+}
+
+uint32_t Mir::Function::add_slot(const uint8_t &size, const bool &sign) {
+    slots.push_back({size, sign});
+    return slots.size() - 1;
+}
+
+uint32_t Mir::Function::add(const Inst &inst) {
+    const uint32_t id = insts.size();
+    insts.push_back(inst);
+    insts.back().block = current;
+    blocks[current].insts.push_back(id);
+    return id;
+}
+
+void Mir::Function::jump(const uint32_t &target) {
+    blocks[current].exit = JUMP;
+    blocks[current].value = none;
+    blocks[current].succs = {target};
+    blocks[target].preds.push_back(current);
+}
+
+void Mir::Function::branch(const uint32_t &condition, const uint32_t &pass, const uint32_t &fail) {
+    blocks[current].exit = BRANCH;
+    blocks[current].value = condition;
+    blocks[current].succs = {pass, fail};
+    blocks[pass].preds.push_back(current);
+    blocks[fail].preds.push_back(current);
+}
+
+void Mir::Function::ret(const uint32_t &value) {
+    blocks[current].exit = RETURN;
+    blocks[current].value = value;
+    blocks[current].succs.clear();
+}
+
+// Dominators by the iterative algorithm of Cooper, Harvey and Kennedy over
+// the reverse post-order, then the frontiers from the join points upwards.
+void Mir::Function::analyze() {
+    order.clear();
+    std::vector<uint8_t> seen(blocks.size(), 0);
+    std::vector<std::pair<uint32_t, size_t>> stack = {{0, 0}};
+    seen[0] = 1;
+    while (!stack.empty()) {
+        const uint32_t b = stack.back().first;
+        const size_t next = stack.back().second++;
+        if (next < blocks[b].succs.size()) {
+            const uint32_t succ = blocks[b].succs[next];
+            if (!seen[succ]) {
+                seen[succ] = 1;
+                stack.push_back({succ, 0});
+            }
+        } else {
+            order.push_back(b);
+            stack.pop_back();
+        }
+    }
+    std::reverse(order.begin(), order.end());
+
+    rank.assign(blocks.size(), none);
+    for (size_t i = 0; i < order.size(); ++i) {
+        rank[order[i]] = i;
+    }
+    for (auto &block : blocks) {
+        block.idom = none;
+        block.frontier.clear();
+        block.depth = 0;
+    }
+
+    // The entry counts as its own dominator until the tree is complete.
+    blocks[0].idom = 0;
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t i = 1; i < order.size(); ++i) {
+            Block &block = blocks[order[i]];
+            uint32_t idom = none;
+            for (const auto &pred : block.preds) {
+                if (blocks[pred].idom == none) continue;
+                if (idom == none) {
+                    idom = pred;
+                    continue;
+                }
+                uint32_t a = pred;
+                uint32_t b = idom;
+                while (a != b) {
+                    while (rank[a] > rank[b]) a = blocks[a].idom;
+                    while (rank[b] > rank[a]) b = blocks[b].idom;
+                }
+                idom = a;
+            }
+            if (block.idom != idom) {
+                block.idom = idom;
+                changed = true;
+            }
+        }
+    }
+
+    for (const auto &b : order) {
+        if (blocks[b].preds.size() < 2) continue;
+        for (const auto &pred : blocks[b].preds) {
+            if (rank[pred] == none) continue;
+            for (uint32_t runner = pred; runner != blocks[b].idom; runner = blocks[runner].idom) {
+                auto &frontier = blocks[runner].frontier;
+                if (std::find(frontier.begin(), frontier.end(), b) == frontier.end()) frontier.push_back(b);
+            }
+        }
+    }
+    blocks[0].idom = none;
+
+    for (const auto &header : order) {
+        for (const auto &b : get_loop(header)) {
+            ++blocks[b].depth;
+        }
+    }
+}
+
+// An edge to a dominator closes a loop, which holds every block reaching the
+// edge without passing the header. Only an edge from a block no earlier in
+// 'order' can go to a dominator, which spares the walk up the dominator tree
+// for all other edges.
+std::vector<uint32_t> Mir::Function::get_loop(const uint32_t &header) const {
+    std::vector<uint32_t> work;
+    for (const auto &pred : blocks[header].preds) {
+        if (rank[pred] != none && rank[pred] >= rank[header] && dominates(header, pred)) work.push_back(pred);
+    }
+    if (work.empty()) return {};
+
+    std::vector<uint32_t> loop = {header};
+    std::vector<uint8_t> seen(blocks.size(), 0);
+    seen[header] = 1;
+    while (!work.empty()) {
+        const uint32_t b = work.back();
+        work.pop_back();
+        if (seen[b]) continue;
+        seen[b] = 1;
+        loop.push_back(b);
+        for (const auto &pred : blocks[b].preds) {
+            if (!seen[pred] && rank[pred] != none) work.push_back(pred);
+        }
+    }
+    return loop;
+}
+
+const bool Mir::Function::dominates(const uint32_t &a, const uint32_t &b) const {
+    for (uint32_t block = b; block != none; block = blocks[block].idom) {
+        if (block == a) return true;
+    }
+    return false;
+}
+
+// Phis go on the iterated dominance frontier of the blocks storing a slot,
+// then a walk down the dominator tree keeps the value each slot holds on a
+// stack per slot, replacing loads with the value on top. Phis no other
+// instruction needs are dropped again.
+void Mir::Function::promote() {
+    analyze();
+
+    std::vector<std::vector<uint32_t>> stores(slots.size());
+    for (const auto &b : order) {
+        for (const auto &i : blocks[b].insts) {
+            if (insts[i].op != STORE) continue;
+            auto &storing = stores[insts[i].value];
+            if (storing.empty() || storing.back() != b) storing.push_back(b);
+        }
+    }
+
+    std::vector<uint32_t> has_phi(blocks.size(), none);
+    std::vector<uint32_t> queued(blocks.size(), none);
+    for (uint32_t slot = 0; slot < slots.size(); ++slot) {
+        std::vector<uint32_t> work = stores[slot];
+        for (const auto &b : work) {
+            queued[b] = slot;
+        }
+        while (!work.empty()) {
+            const uint32_t b = work.back();
+            work.pop_back();
+            for (const auto &join : blocks[b].frontier) {
+                if (has_phi[join] == slot) continue;
+                has_phi[join] = slot;
+
+                Inst phi(PHI, slots[slot].size, slots[slot].sign);
+                phi.value = slot;
+                phi.block = join;
+                phi.args.assign(blocks[join].preds.size(), none);
+                insts.push_back(phi);
+                blocks[join].insts.insert(blocks[join].insts.begin(), insts.size() - 1);
+
+                if (queued[join] != slot) {
+                    queued[join] = slot;
+                    work.push_back(join);
+                }
+            }
+        }
+    }
+
+    const uint32_t undef = insts.size();
+    insts.push_back(Inst(UNDEF));
+    insts.back().block = 0;
+    blocks[0].insts.insert(blocks[0].insts.begin(), undef);
+
+    std::vector<std::vector<uint32_t>> children(blocks.size());
+    for (size_t i = 1; i < order.size(); ++i) {
+        children[blocks[order[i]].idom].push_back(order[i]);
+    }
+
+    // Each block is visited on the way down, and once more on the way up to
+    // drop the values it pushed, whose slots are kept in 'trail'.
+    std::vector<std::vector<uint32_t>> values(slots.size(), std::vector<uint32_t>{undef});
+    std::vector<uint32_t> replaced(insts.size(), none);
+    std::vector<uint32_t> trail;
+    std::vector<std::pair<uint32_t, size_t>> stack = {{0, SIZE_MAX}};
+    while (!stack.empty()) {
+        const auto [b, mark] = stack.back();
+        stack.pop_back();
+        if (mark != SIZE_MAX) {
+            for (; trail.size() > mark; trail.pop_back()) {
+                values[trail.back()].pop_back();
+            }
+            continue;
+        }
+        stack.push_back({b, trail.size()});
+
+        for (const auto &i : blocks[b].insts) {
+            Inst &inst = insts[i];
+            if (inst.op == PHI) {
+                values[inst.value].push_back(i);
+                trail.push_back(inst.value);
+            } else if (inst.op == LOAD) {
+                replaced[i] = values[inst.value].back();
+                inst.op = NOP;
+            } else if (inst.op == STORE) {
+                values[inst.value].push_back(replaced[inst.a] != none ? replaced[inst.a] : inst.a);
+                trail.push_back(inst.value);
+                inst.op = NOP;
+            }
+        }
+        for (const auto &succ : blocks[b].succs) {
+            const Block &block = blocks[succ];
+            for (size_t j = 0; j < block.preds.size(); ++j) {
+                if (block.preds[j] != b) continue;
+                for (const auto &i : block.insts) {
+                    if (insts[i].op != PHI) break;
+                    insts[i].args[j] = values[insts[i].value].back();
+                }
+            }
+        }
+        for (auto it = children[b].rbegin(); it != children[b].rend(); ++it) {
+            stack.push_back({*it, SIZE_MAX});
+        }
+    }
+
+    const auto resolve = [&](uint32_t &value) {
+        if (value < replaced.size() && replaced[value] != none) value = replaced[value];
+    };
+    for (const auto &b : order) {
+        for (const auto &i : blocks[b].insts) {
+            for_each_operand(insts[i], resolve);
+        }
+        if (blocks[b].value != none) resolve(blocks[b].value);
+    }
+
+    std::vector<uint8_t> live(insts.size(), 0);
+    std::vector<uint32_t> work;
+    const auto mark = [&](uint32_t &value) {
+        if (insts[value].op == PHI && !live[value]) {
+            live[value] = 1;
+            work.push_back(value);
+        }
+    };
+    for (const auto &b : order) {
+        for (const auto &i : blocks[b].insts) {
+            if (insts[i].op != PHI) for_each_operand(insts[i], mark);
+        }
+        if (blocks[b].value != none) mark(blocks[b].value);
+    }
+    while (!work.empty()) {
+        const uint32_t phi = work.back();
+        work.pop_back();
+        for_each_operand(insts[phi], mark);
+    }
+
+    for (const auto &b : order) {
+        auto &list = blocks[b].insts;
+        for (const auto &i : list) {
+            if (insts[i].op == PHI && !live[i]) insts[i].op = NOP;
+        }
+        list.erase(std::remove_if(list.begin(), list.end(), [&](const uint32_t &i) { return insts[i].op == NOP; }), list.end());
+    }
+}
+
+void Mir::Function::split_edges() {
+    const uint32_t count = blocks.size();
+    for (uint32_t b = 0; b < count; ++b) {
+        if (blocks[b].preds.size() < 2 || blocks[b].insts.empty() || insts[blocks[b].insts[0]].op != PHI) continue;
+        for (size_t j = 0; j < blocks[b].preds.size(); ++j) {
+            const uint32_t pred = blocks[b].preds[j];
+            if (blocks[pred].succs.size() < 2) continue;
+
+            // The n-th edge from 'pred' into 'b' is the n-th time 'b' is
+            // among the successors of 'pred'.
+            const size_t nth = std::count(blocks[b].preds.begin(), blocks[b].preds.begin() + j, pred);
+            size_t k = 0;
+            for (size_t seen = 0; k < blocks[pred].succs.size(); ++k) {
+                if (blocks[pred].succs[k] == b && seen++ == nth) break;
+            }
+
+            const uint32_t edge = add_block();
+            blocks[edge].exit = JUMP;
+            blocks[edge].succs = {b};
+            blocks[edge].preds = {pred};
+            blocks[pred].succs[k] = edge;
+            blocks[b].preds[j] = edge;
+        }
+    }
+    analyze();
+}
+
+// Value of 'inst' from constant operands 'a' and 'b', as lowering computes
+// it. 'left' is the first operand, which decides the signedness of
+// comparisons. Divisions that would fault are left to run time.
+static bool fold(const Mir::Inst &inst, const Mir::Inst &left, const int64_t &a, const int64_t &b, int64_t &result) {
+    const int width = std::max<int>(inst.size, 4);
+    const uint64_t x = uint64_t(a);
+    const uint64_t y = uint64_t(b);
+    switch (inst.op) {
+        case Mir::ADD: result = int64_t(x + y); break;
+        case Mir::SUB: result = int64_t(x - y); break;
+        case Mir::MUL: result = int64_t(x * y); break;
+        case Mir::AND: result = int64_t(x & y); break;
+        case Mir::OR: result = int64_t(x | y); break;
+        case Mir::XOR: result = int64_t(x ^ y); break;
+        case Mir::DIV:
+        case Mir::MOD:
+            if (b == 0) return false;
+            if (inst.sign) {
+                if (b == -1 && a == (width == 8 ? INT64_MIN : INT32_MIN)) return false;
+                result = inst.op == Mir::DIV ? a / b : a % b;
+            } else {
+                result = int64_t(inst.op == Mir::DIV ? x / y : x % y);
+            }
+            break;
+        case Mir::POW: {
+            // A negative exponent, at the width the loop counts it in,
+            // yields 1.
+            int64_t exponent = Mir::normalize(b, width, true);
+            uint64_t base = x;
+            uint64_t power = 1;
+            for (; exponent > 0; exponent >>= 1) {
+                if (exponent & 1) power *= base;
+                base *= base;
+            }
+            result = int64_t(power);
+            break;
+        }
+        case Mir::SHL:
+        case Mir::SHR: {
+            // Counts are masked as the processor masks them.
+            const int count = b & (inst.size == 8 ? 63 : 31);
+            if (inst.op == Mir::SHL) result = int64_t(x << count);
+            else result = inst.sign ? a >> count : int64_t(x >> count);
+            break;
+        }
+        case Mir::EQ: result = a == b; break;
+        case Mir::NE: result = a != b; break;
+        case Mir::LT: result = left.sign ? a < b : x < y; break;
+        case Mir::LE: result = left.sign ? a <= b : x <= y; break;
+        case Mir::GT: result = left.sign ? a > b : x > y; break;
+        case Mir::GE: result = left.sign ? a >= b : x >= y; break;
+        case Mir::NEG: result = int64_t(0 - x); break;
+        case Mir::NOT: result = int64_t(~x); break;
+        case Mir::CAST: result = a; break;
+        default:
+            return false;
+    }
+    result = Mir::normalize(result, inst.size, inst.sign);
+    return true;
+}
+
+// Sparse conditional constant propagation of Wegman and Zadeck. Values
+// start out unknown and only ever move down to a constant and then to
+// varying, and a block is only looked at once an edge into it is found
+// executable, so the side of a branch on a constant is never reached and
+// its values do not spoil the phis after it.
+void Mir::Function::propagate_constants() {
+    analyze();
+
+    enum State : uint8_t {
+        UNKNOWN,
+        CONSTANT,
+        VARYING,
+    };
+    std::vector<State> state(insts.size(), UNKNOWN);
+    std::vector<int64_t> constant(insts.size(), 0);
+    std::vector<std::vector<uint32_t>> users(insts.size());
+    std::vector<std::vector<uint32_t>> exits(insts.size());
+    for (const auto &b : order) {
+        for (const auto &i : blocks[b].insts) {
+            for_each_operand(insts[i], [&](uint32_t &operand) {
+                users[operand].push_back(i);
+            });
+        }
+        if (blocks[b].value != none) exits[blocks[b].value].push_back(b);
+    }
+
+    const auto get = [&](const uint32_t &value) -> std::pair<State, int64_t> {
+        if (value == none) return {UNKNOWN, 0};
+        const Inst &inst = insts[value];
+        if (inst.op == CONST) return {CONSTANT, normalize(inst.value, inst.size, inst.sign)};
+        return {state[value], constant[value]};
+    };
+
+    std::vector<uint8_t> reached(blocks.size(), 0);
+    std::vector<std::vector<uint8_t>> executable(blocks.size());
+    for (uint32_t b = 0; b < blocks.size(); ++b) {
+        executable[b].assign(blocks[b].preds.size(), 0);
+    }
+
+    const auto evaluate = [&](const uint32_t &i) -> std::pair<State, int64_t> {
+        const Inst &inst = insts[i];
+        switch (inst.op) {
+            case CONST:
+                return get(i);
+            case UNDEF:
+                return {UNKNOWN, 0};
+            case PHI: {
+                std::pair<State, int64_t> meet = {UNKNOWN, 0};
+                for (size_t j = 0; j < inst.args.size(); ++j) {
+                    if (!executable[inst.block][j]) continue;
+                    const auto arg = get(inst.args[j]);
+                    if (arg.first == UNKNOWN) continue;
+                    if (arg.first == VARYING || (meet.first == CONSTANT && meet.second != arg.second)) return {VARYING, 0};
+                    meet = arg;
+                }
+                return meet;
+            }
+            case SELECT: {
+                const auto condition = get(inst.args[0]);
+                if (condition.first != CONSTANT) return {condition.first, 0};
+                return get(inst.args[condition.second != 0 ? 1 : 2]);
+            }
+            case ADD: case SUB: case MUL: case DIV: case MOD: case POW:
+            case AND: case OR: case XOR: case SHL: case SHR:
+            case EQ: case NE: case LT: case LE: case GT: case GE:
+            case NEG: case NOT: case CAST: {
+                const auto a = get(inst.a);
+                const auto b = inst.b != none ? get(inst.b) : std::pair<State, int64_t>(CONSTANT, 0);
+                if (a.first == VARYING || b.first == VARYING) return {VARYING, 0};
+                if (a.first == UNKNOWN || b.first == UNKNOWN) return {UNKNOWN, 0};
+                int64_t result;
+                if (!fold(inst, insts[inst.a], a.second, b.second, result)) return {VARYING, 0};
+                return {CONSTANT, result};
+            }
+            default:
+                return {VARYING, 0};
+        }
+    };
+
+    std::vector<uint32_t> values;
+    std::vector<std::pair<uint32_t, uint32_t>> edges = {{none, 0}};
+    const auto visit = [&](const uint32_t &i) {
+        const auto result = evaluate(i);
+        if (result.first == state[i] && (result.first != CONSTANT || result.second == constant[i])) return;
+        state[i] = result.first;
+        constant[i] = result.second;
+        values.push_back(i);
+    };
+    const auto visit_exit = [&](const uint32_t &b) {
+        const Block &block = blocks[b];
+        if (block.exit == JUMP) {
+            edges.push_back({b, block.succs[0]});
+        } else if (block.exit == BRANCH) {
+            const auto condition = get(block.value);
+            if (condition.first == VARYING || (condition.first == CONSTANT && condition.second != 0)) edges.push_back({b, block.succs[0]});
+            if (condition.first == VARYING || (condition.first == CONSTANT && condition.second == 0)) edges.push_back({b, block.succs[1]});
+        }
+    };
+
+    while (!edges.empty() || !values.empty()) {
+        if (!edges.empty()) {
+            const auto [pred, b] = edges.back();
+            edges.pop_back();
+            bool taken = false;
+            for (size_t j = 0; j < blocks[b].preds.size(); ++j) {
+                if (blocks[b].preds[j] != pred || executable[b][j]) continue;
+                executable[b][j] = 1;
+                taken = true;
+            }
+            if (pred != none && !taken) continue;
+
+            if (reached[b]) {
+                for (const auto &i : blocks[b].insts) {
+                    if (insts[i].op != PHI) break;
+                    visit(i);
+                }
+                continue;
+            }
+            reached[b] = 1;
+            for (const auto &i : blocks[b].insts) {
+                visit(i);
+            }
+            visit_exit(b);
+            continue;
+        }
+
+        const uint32_t value = values.back();
+        values.pop_back();
+        for (const auto &user : users[value]) {
+            if (reached[insts[user].block]) visit(user);
+        }
+        for (const auto &b : exits[value]) {
+            if (reached[b]) visit_exit(b);
+        }
+    }
+
+    // Selects on a constant stand for the operand they pick.
+    std::vector<uint32_t> replaced(insts.size(), none);
+    for (const auto &b : order) {
+        if (!reached[b]) continue;
+        for (const auto &i : blocks[b].insts) {
+            Inst &inst = insts[i];
+            if (state[i] == CONSTANT && inst.op != CONST) {
+                inst.op = CONST;
+                inst.value = constant[i];
+                inst.a = none;
+                inst.b = none;
+                inst.args.clear();
+            } else if (inst.op == SELECT && get(inst.args[0]).first == CONSTANT) {
+                replaced[i] = inst.args[get(inst.args[0]).second != 0 ? 1 : 2];
+            }
+        }
+        // Phis found constant are no longer phis, the rest stay in front.
+        std::vector<uint32_t> &list = blocks[b].insts;
+        list.erase(std::remove_if(list.begin(), list.end(), [&](const uint32_t &i) { return replaced[i] != none; }), list.end());
+        std::stable_partition(list.begin(), list.end(), [this](const uint32_t &i) {
+            return insts[i].op == PHI;
+        });
+    }
+    for (auto &inst : insts) {
+        for_each_operand(inst, [&](uint32_t &operand) {
+            while (replaced[operand] != none) operand = replaced[operand];
+        });
+    }
+
+    for (uint32_t b = 0; b < blocks.size(); ++b) {
+        Block &block = blocks[b];
+        if (!reached[b]) {
+            // Blocks never reached no longer feed the phis after them.
+            for (const auto &succ : block.succs) {
+                remove_edge(b, succ);
+            }
+            block.succs.clear();
+            block.exit = RETURN;
+            block.value = none;
+            continue;
+        }
+        if (block.value != none) {
+            while (replaced[block.value] != none) block.value = replaced[block.value];
+        }
+        if (block.exit != BRANCH || get(block.value).first != CONSTANT) continue;
+
+        const uint32_t pass = block.succs[0];
+        const uint32_t fail = block.succs[1];
+        const bool holds = get(block.value).second != 0;
+        remove_edge(b, holds ? fail : pass);
+        block.exit = JUMP;
+        block.value = none;
+        block.succs = {holds ? pass : fail};
+    }
+    analyze();
+}
+
+// Values are kept when calls or prints use them or an exit needs them, and
+// every other instruction goes. Phis that only ever forward one value are
+// replaced by it first, so a loop that no longer uses a variable does not
+// keep it alive through its own phis.
+uint32_t Mir::Function::remove_dead_code() {
+    analyze();
+    uint32_t removed = 0;
+
+    std::vector<uint8_t> reached(blocks.size(), 0);
+    for (const auto &b : order) {
+        reached[b] = 1;
+    }
+    for (uint32_t b = 0; b < blocks.size(); ++b) {
+        Block &block = blocks[b];
+        if (reached[b]) continue;
+        for (const auto &succ : block.succs) {
+            remove_edge(b, succ);
+        }
+        removed += block.insts.size();
+        block.insts.clear();
+        block.preds.clear();
+        block.succs.clear();
+        block.exit = RETURN;
+        block.value = none;
+    }
+
+    std::vector<uint32_t> replaced(insts.size(), none);
+    const auto resolve = [&](uint32_t &value) {
+        while (replaced[value] != none) value = replaced[value];
+    };
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (const auto &b : order) {
+            for (const auto &i : blocks[b].insts) {
+                if (insts[i].op != PHI || replaced[i] != none) continue;
+                uint32_t only = none;
+                bool trivial = true;
+                for (auto &arg : insts[i].args) {
+                    resolve(arg);
+                    if (arg == i || arg == only) continue;
+                    if (only != none) trivial = false;
+                    only = arg;
+                }
+                if (!trivial || only == none) continue;
+                replaced[i] = only;
+                changed = true;
+            }
+        }
+    }
+
+    std::vector<uint8_t> live(insts.size(), 0);
+    std::vector<uint32_t> work;
+    const auto mark = [&](uint32_t &value) {
+        resolve(value);
+        if (live[value]) return;
+        live[value] = 1;
+        work.push_back(value);
+    };
+    for (const auto &b : order) {
+        for (const auto &i : blocks[b].insts) {
+            if (replaced[i] != none) continue;
+            const auto op = insts[i].op;
+            if (op == CALL || op == PRINT || op == STORE) {
+                live[i] = 1;
+                work.push_back(i);
+            }
+        }
+        if (blocks[b].value != none) mark(blocks[b].value);
+    }
+    while (!work.empty()) {
+        const uint32_t i = work.back();
+        work.pop_back();
+        for_each_operand(insts[i], mark);
+    }
+
+    for (const auto &b : order) {
+        auto &list = blocks[b].insts;
+        const size_t count = list.size();
+        list.erase(std::remove_if(list.begin(), list.end(), [&](const uint32_t &i) { return !live[i]; }), list.end());
+        removed += count - list.size();
+    }
+
+    // A jump to a block reached from nowhere else joins the two.
+    for (const auto &b : order) {
+        Block &block = blocks[b];
+        if (block.preds.empty() && b != 0) continue;
+        while (block.exit == JUMP) {
+            const uint32_t succ = block.succs[0];
+            Block &next = blocks[succ];
+            if (succ == b || succ == 0 || next.preds.size() != 1) break;
+            block.insts.insert(block.insts.end(), next.insts.begin(), next.insts.end());
+            block.exit = next.exit;
+            block.value = next.value;
+            block.succs = next.succs;
+            for (const auto &s : next.succs) {
+                std::replace(blocks[s].preds.begin(), blocks[s].preds.end(), succ, b);
+            }
+            next.insts.clear();
+            next.preds.clear();
+            next.succs.clear();
+            next.exit = RETURN;
+            next.value = none;
+        }
+    }
+    analyze();
+    return removed;
+}
+
+void Mir::Function::remove_edge(const uint32_t &pred, const uint32_t &succ) {
+    Block &block = blocks[succ];
+    const auto it = std::find(block.preds.begin(), block.preds.end(), pred);
+    if (it == block.preds.end()) return;
+    const size_t j = it - block.preds.begin();
+    block.preds.erase(it);
+    for (const auto &i : block.insts) {
+        if (insts[i].op != PHI) break;
+        insts[i].args.erase(insts[i].args.begin() + j);
+    }
+}
+
+// Blocks keep their reverse post-order, except that the blocks of a loop are
+// kept together and its header is moved below them. The body then falls
+// through to the condition, whose branch back is the only jump an iteration
+// takes. Blocks leaving a loop only to return are taken at most once and go
+// last.
+void Mir::Function::place_blocks() {
+    analyze();
+
+    // Each block is keyed by the positions of the headers of the loops it
+    // is in, outermost first, then its own.
+    std::vector<std::vector<uint32_t>> keys(blocks.size());
+    std::vector<std::vector<uint32_t>> loops;
+    for (const auto &header : order) {
+        std::vector<uint32_t> loop = get_loop(header);
+        if (loop.empty()) continue;
+        for (const auto &b : loop) {
+            keys[b].push_back(rank[header]);
+        }
+        loops.push_back(std::move(loop));
+    }
+    for (const auto &b : order) {
+        keys[b].push_back(rank[b]);
+    }
+    layout = order;
+    std::stable_sort(layout.begin(), layout.end(), [&keys](const uint32_t &a, const uint32_t &b) {
+        return keys[a] < keys[b];
+    });
+
+    std::vector<uint8_t> inside(blocks.size(), 0);
+    for (const auto &loop : loops) {
+        const uint32_t header = loop[0];
+        for (const auto &b : loop) {
+            inside[b] = 1;
+        }
+        const Block &block = blocks[header];
+        if (header != 0 && block.exit == BRANCH && inside[block.succs[0]] != inside[block.succs[1]]) {
+            const size_t start = std::find(layout.begin(), layout.end(), header) - layout.begin();
+            size_t end = start + 1;
+            while (end < layout.size() && inside[layout[end]]) ++end;
+            std::rotate(layout.begin() + start, layout.begin() + start + 1, layout.begin() + end);
+        }
+        for (const auto &b : loop) {
+            inside[b] = 0;
+        }
+    }
+
+    std::stable_partition(layout.begin(), layout.end(), [this](const uint32_t &b) {
+        const Block &block = blocks[b];
+        return block.exit != RETURN || block.preds.size() != 1 || blocks[block.preds[0]].depth <= block.depth;
+    });
+}
+
+void Mir::Function::log() const {
+    std::cout << "function: (id: '" << id << "', blocks: (" << '\n';
+    for (const auto &b : order) {
+        const Block &block = blocks[b];
+        std::cout << '\t' << "block: (id: '" << b << "', preds: (";
+        for (size_t i = 0; i < block.preds.size(); ++i) {
+            std::cout << (i > 0 ? ", '" : "'") << block.preds[i] << '\'';
+        }
+        std::cout << "), idom: '";
+        if (block.idom == none) std::cout << "none";
+        else std::cout << block.idom;
+        std::cout << "', depth: '" << block.depth << "')" << '\n';
+
+        for (const auto &i : block.insts) {
+            const Inst &inst = insts[i];
+            std::cout << "\t\t";
+            if (inst.size > 0 || inst.op == UNDEF) std::cout << '%' << i << " = ";
+            std::cout << names[inst.op];
+            if (inst.size > 0) std::cout << ' ' << (inst.sign ? 'i' : 'u') << inst.size * 8;
+            bool first = true;
+            const auto separate = [&first]() {
+                std::cout << (first ? " " : ", ");
+                first = false;
+            };
+            if (inst.op == CONST || inst.op == ARG || inst.op == PHI || inst.op == LOAD || inst.op == STORE) {
+                separate();
+                std::cout << inst.value;
+            }
+            if (!inst.symbol.empty()) {
+                separate();
+                std::cout << inst.symbol;
+            }
+            for (const auto &operand : {inst.a, inst.b}) {
+                if (operand == none) continue;
+                separate();
+                write_value(operand);
+            }
+            for (const auto &arg : inst.args) {
+                separate();
+                write_value(arg);
+            }
+            std::cout << '\n';
+        }
+
+        std::cout << "\t\t";
+        switch (block.exit) {
+            case JUMP:
+                std::cout << "jump '" << block.succs[0] << '\'';
+                break;
+            case BRANCH:
+                std::cout << "branch ";
+                write_value(block.value);
+                std::cout << ", '" << block.succs[0] << "', '" << block.succs[1] << '\'';
+                break;
+            case RETURN:
+                std::cout << "return";
+                if (block.value != none) {
+                    std::cout << ' ';
+                    write_value(block.value);
+                }
+                break;
+        }
+        std::cout << '\n';
+    }
+    std::cout << "))" << '\n';
+}
\ No newline at end of file
@@ -3,11 +3,12 @@
 #include <program/source.h>
 #include <program/lexer.h>
 #include <program/parser.h>
+#include <program/flat_ast.h>
 #include <program/ir_generator.h>
 #include <program/compiler.h>
 // #define NLOG
 
-Object::Object(const std::string &src_id, const std::string &out_dir) : src_id(src_id), out_dir(out_dir) {
+Object::Object(const std::string &src_id, const std::string &out_dir, const bool &stats) : src_id(src_id), out_dir(out_dir), stats(stats) {
     success = true;
 }
 
@@ -38,7 +39,28 @@ void Object::compile() {
         return;
     }
 
-    Lexer lexer(source);
+    // Unchanged sources skip lexing and parsing, their tree is loaded from
+    // the cache written next to the object on the last build.
+    const std::string cache_path = out_dir + src_id + ".ast";
+    const uint64_t key = FlatAst::get_key(source.get(), Utils::get_version());
+    if (std::filesystem::exists(cache_path)) {
+        const Source cache(cache_path);
+        const FlatAst flat(cache, key);
+        if (flat.get_success()) {
+#ifndef NLOG
+            flat.log();
+#endif
+            Arena arena;
+            const IRGenerator ir_generator(flat.expand(arena), Utils::get_optimization());
+            emit(ir_generator);
+            return;
+        }
+    }
+
+    // Sources too large to keep resident are lexed on demand by the parser,
+    // holding only a window of tokens at a time.
+    const ThreadPool pool(Utils::get_workers());
+    Lexer lexer = source.get_mode() == Source::STREAMED ? Lexer(source, Lexer::default_window) : Lexer(source, pool);
     if (!lexer.get_success()) {
         std::cout << "Exiting due to lex error." << '\n';
         success = false;
@@ -49,7 +71,7 @@ void Object::compile() {
     lexer.log();
 #endif
 
-    Parser parser(lexer);
+    Parser parser(lexer, pool);
     if (!parser.get_success()) {
         std::cout << "Exiting due to parse error." << '\n';
         success = false;
@@ -60,7 +82,15 @@ void Object::compile() {
     parser.log();
 #endif
 
-    IRGenerator ir_generator(parser);
+    if (!FlatAst(parser).save(cache_path, key)) {
+        std::cout << "Could not write the syntax tree cache '" << cache_path << "'." << '\n';
+    }
+
+    const IRGenerator ir_generator(parser, Utils::get_optimization());
+    emit(ir_generator);
+}
+
+void Object::emit(const IRGenerator &ir_generator) {
     if (!ir_generator.get_success()) {
         std::cout << "Exiting due to compile error." << '\n';
         success = false;
@@ -68,10 +98,12 @@ void Object::compile() {
     }
 
 #ifndef NLOG
+    ir_generator.get_mir().log();
     ir_generator.log();
 #endif
 
     Compiler compiler(ir_generator, out_dir + src_id);
+    if (stats) compiler.get_peephole().log();
     if (!compiler.get_success()) {
         std::cout << "Exiting due to compile error." << '\n';
         success = false;
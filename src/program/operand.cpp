@@ -0,0 +1,143 @@
+#include <program/operand.h>
+
+// NASM names of every register by width: 8, 4, 2 and 1 byte(s).
+static constexpr const char *names[Operand::NO_REGISTER][4] = {
+    {"rax", "eax", "ax", "al"},
+    {"rbx", "ebx", "bx", "bl"},
+    {"rcx", "ecx", "cx", "cl"},
+    {"rdx", "edx", "dx", "dl"},
+    {"rsi", "esi", "si", "sil"},
+    {"rdi", "edi", "di", "dil"},
+    {"rbp", "ebp", "bp", "bpl"},
+    {"rsp", "esp", "sp", "spl"},
+    {"r8", "r8d", "r8w", "r8b"},
+    {"r9", "r9d", "r9w", "r9b"},
+    {"r10", "r10d", "r10w", "r10b"},
+    {"r11", "r11d", "r11w", "r11b"},
+    {"r12", "r12d", "r12w", "r12b"},
+    {"r13", "r13d", "r13w", "r13b"},
+    {"r14", "r14d", "r14w", "r14b"},
+    {"r15", "r15d", "r15w", "r15b"},
+};
+
+// Values wider than a qword use one, as the string operands did.
+static uint8_t get_width(const int &size) {
+    if (size >= 8) return 8;
+    if (size >= 4) return 4;
+    if (size >= 2) return 2;
+    if (size >= 1) return 1;
+    throw std::runtime_error("Could not deduce width of a '" + std::to_string(size) + "' byte(s) value");
+}
+
+static const char* get_word(const uint8_t &size) {
+    switch (size) {
+        case 8: return "qword";
+        case 4: return "dword";
+        case 2: return "word";
+        default: return "byte";
+    }
+}
+
+Operand::Operand() {
+    kind = NONE;
+    size = 0;
+    base = NO_REGISTER;
+    index = NO_REGISTER;
+    scale = 1;
+    value = 0;
+}
+
+const Operand Operand::reg(const Register &reg, const int &size) {
+    Operand operand;
+    operand.kind = REGISTER;
+    operand.size = get_width(size);
+    operand.base = reg;
+    return operand;
+}
+
+const Operand Operand::mem(const Register &base, const int32_t &disp, const int &size) {
+    return mem(base, NO_REGISTER, 1, disp, size);
+}
+
+const Operand Operand::mem(const Register &base, const Register &index, const uint8_t &scale, const int32_t &disp, const int &size) {
+    Operand operand;
+    operand.kind = MEMORY;
+    operand.size = size > 0 ? get_width(size) : 0;
+    operand.base = base;
+    operand.index = index;
+    operand.scale = scale;
+    operand.value = disp;
+    return operand;
+}
+
+const Operand Operand::mem(const std::string_view &symbol) {
+    Operand operand;
+    operand.kind = MEMORY;
+    operand.symbol = symbol;
+    return operand;
+}
+
+const Operand Operand::imm(const int64_t &value) {
+    Operand operand;
+    operand.kind = IMMEDIATE;
+    operand.value = value;
+    return operand;
+}
+
+const Operand Operand::label(const std::string_view &symbol) {
+    Operand operand;
+    operand.kind = LABEL;
+    operand.symbol = symbol;
+    return operand;
+}
+
+const Operand Operand::resized(const int &size) const {
+    Operand operand = *this;
+    if (kind == REGISTER || kind == MEMORY) operand.size = get_width(size);
+    return operand;
+}
+
+const bool Operand::operator==(const Operand &other) const {
+    return kind == other.kind && size == other.size && base == other.base && index == other.index &&
+        scale == other.scale && value == other.value && symbol == other.symbol;
+}
+
+const bool Operand::operator!=(const Operand &other) const {
+    return !(*this == other);
+}
+
+void Operand::write(std::ostream &os) const {
+    switch (kind) {
+        case REGISTER:
+            os << names[base][size >= 8 ? 0 : size >= 4 ? 1 : size >= 2 ? 2 : 3];
+            break;
+        case MEMORY:
+            if (size > 0) os << get_word(size) << ' ';
+            os << '[';
+            if (!symbol.empty()) {
+                os << symbol;
+            } else {
+                os << names[base][0];
+                if (index != NO_REGISTER) {
+                    os << " + " << names[index][0];
+                    if (scale > 1) os << " * " << static_cast<int>(scale);
+                }
+                os << (value < 0 ? " - " : " + ") << (value < 0 ? -value : value);
+            }
+            os << ']';
+            break;
+        case IMMEDIATE:
+            os << value;
+            break;
+        case LABEL:
+            os << symbol;
+            break;
+        default:
+            break;
+    }
+}
+
+std::ostream& operator<<(std::ostream &os, const Operand &operand) {
+    operand.write(os);
+    return os;
+}
\ No newline at end of file
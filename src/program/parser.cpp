@@ -1,58 +1,276 @@
 #include <program/parser.h>
 
-Parser::Parser(const Lexer &lexer) : tokens(lexer.get()) {
+Parser::Parser(const Lexer &lexer) : lexer(lexer) {
     success = true;
     mod_prefix = "";
+    empty = nullptr;
+    parsed_bytes = 0;
 
+    const auto start = std::chrono::high_resolution_clock::now();
     parse();
+    const auto end = std::chrono::high_resolution_clock::now();
+
+    elapsed = std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+Parser::Parser(const Lexer &lexer, const ThreadPool &pool) : lexer(lexer) {
+    success = true;
+    mod_prefix = "";
+    empty = nullptr;
+    parsed_bytes = 0;
+
+    const auto start = std::chrono::high_resolution_clock::now();
+    if (pool.get_workers() < 2 || lexer.is_streaming() || lexer.size() < parallel_threshold) parse();
+    else parse_parallel(pool);
+    const auto end = std::chrono::high_resolution_clock::now();
+
+    elapsed = std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+// A run of a parallel parse starting at token 'begin', see parse_chunk().
+Parser::Parser(const Lexer &lexer, const size_t &begin) : lexer(lexer) {
+    success = true;
+    mod_prefix = "";
+    parsed_bytes = 0;
+    elapsed = 0.0;
+    chunk = true;
+    empty = arena.make<EmptyStatement>();
+    current = begin;
 }
 
 void Parser::parse() {
-    std::vector<std::unique_ptr<Node>> statements;
-    while (match({"use"})) {
-        rewind();
-        statements.push_back(std::move(flag_statement()));
+    ast.clear();
+    starts.clear();
+    pending_nodes.clear();
+    pending_names.clear();
+    pending_operators.clear();
+    arena.reset();
+    empty = arena.make<EmptyStatement>();
+    current = 0;
+    visits = 0;
+
+    while (check(Interner::KEYWORD_USE)) {
+        starts.push_back(current);
+        ast.push_back(flag_statement());
     }
 
     while (!at_end()) {
-        statements.push_back(std::move(global_statement()));
+        starts.push_back(current);
+        ast.push_back(global_statement());
+    }
+    parsed_bytes = arena.get_bytes();
+}
+
+// Every global statement starts outside of any braces, so the pre-pass only
+// has to match braces to find where they can end. A run that ends anywhere
+// but on its bound means the pre-pass cut a statement, for example one with
+// a brace-less 'else' after a block, and then the whole file is parsed
+// serially so the tree and any errors are exactly those of parse().
+void Parser::parse_parallel(const ThreadPool &pool) {
+    std::vector<size_t> bounds;
+    if (!split(bounds, pool.get_workers() * 4) || bounds.size() < 3) {
+        parse();
+        return;
+    }
+
+    const size_t chunk_count = bounds.size() - 1;
+    std::vector<std::unique_ptr<Parser>> chunks;
+    for (size_t k = 0; k < chunk_count; ++k) {
+        chunks.push_back(std::unique_ptr<Parser>(new Parser(lexer, bounds[k])));
+    }
+
+    std::vector<uint8_t> complete(chunk_count, 0);
+    try {
+        pool.run(chunk_count, [&](const size_t &k) {
+            complete[k] = chunks[k]->parse_chunk(bounds[k + 1]);
+        });
+    } catch (const std::exception&) {
+        parse();
+        return;
+    }
+    for (const auto &c : complete) {
+        if (!c) {
+            parse();
+            return;
+        }
     }
-    ast = std::move(statements);
-}
 
-bool Parser::at_end() const {
-    return current >= tokens.size();
+    ast.clear();
+    starts.clear();
+    pending_nodes.clear();
+    pending_names.clear();
+    pending_operators.clear();
+    arena.reset();
+    empty = arena.make<EmptyStatement>();
+    visits = 0;
+    for (const auto &c : chunks) {
+        ast.insert(ast.end(), c->ast.begin(), c->ast.end());
+        starts.insert(starts.end(), c->starts.begin(), c->starts.end());
+        arena.adopt(c->arena);
+        visits += c->visits;
+    }
+    current = bounds.back();
+    parsed_bytes = arena.get_bytes();
+}
+
+// Parses global statements up to token 'end', returns whether the last one
+// ends exactly there.
+const bool Parser::parse_chunk(const size_t &end) {
+    while (current < end && !at_end()) {
+        starts.push_back(current);
+        ast.push_back(global_statement());
+    }
+    return current == end;
+}
+
+// Pre-pass of parse_parallel(), cuts the tokens into about 'count' runs that
+// end where a global statement can end: on a ';' or a '}' outside of any
+// braces. Returns false if the braces do not balance.
+const bool Parser::split(std::vector<size_t> &bounds, const size_t &count) const {
+    const size_t size = lexer.size();
+    bounds = {0};
+    size_t depth = 0;
+    for (size_t i = 0; i < size; ++i) {
+        const uint32_t symbol = lexer.get_symbol(i);
+        if (symbol == Interner::PUNCTUATOR_LEFT_BRACE) {
+            ++depth;
+            continue;
+        }
+        if (symbol == Interner::PUNCTUATOR_RIGHT_BRACE) {
+            if (depth == 0) return false;
+            if (--depth > 0) continue;
+        } else if (symbol != Interner::PUNCTUATOR_SEMICOLON || depth > 0) {
+            continue;
+        }
+
+        if (i + 1 >= size * bounds.size() / count && i + 1 < size) bounds.push_back(i + 1);
+    }
+    bounds.push_back(size);
+    return depth == 0;
 }
 
-const Lexer::Token& Parser::peek() const {
-    return tokens[current];
+// Moves the nodes pending since 'base' into the arena.
+Arena::Array<Parser::Node*> Parser::collect(const size_t &base) {
+    const auto nodes = arena.copy(pending_nodes.data() + base, pending_nodes.size() - base);
+    pending_nodes.resize(base);
+    return nodes;
 }
 
-const Lexer::Token& Parser::previous() const {
-    return tokens[current - 1];
+void Parser::parameters(FunctionDeclaration *function) {
+    const size_t base = pending_names.size();
+    consume(Interner::PUNCTUATOR_LEFT_PAREN, "Expected '('");
+    while (!check(Interner::PUNCTUATOR_RIGHT_PAREN)) {
+        pending_names.push_back(arena.copy(advance().value));
+        pending_names.push_back(arena.copy(advance().value));
+        if (!check(Interner::PUNCTUATOR_RIGHT_PAREN)) {
+            consume(Interner::PUNCTUATOR_COMMA, "Expected ','");
+        }
+    }
+    consume(Interner::PUNCTUATOR_RIGHT_PAREN, "Expected ')' after statement");
+
+    // Pending names alternate between type and identifier, gather the
+    // identifiers after them and the types in front.
+    const size_t count = (pending_names.size() - base) / 2;
+    for (size_t i = 0; i < count; ++i) {
+        pending_names.push_back(pending_names[base + i * 2 + 1]);
+    }
+    for (size_t i = 0; i < count; ++i) {
+        pending_names[base + i] = pending_names[base + i * 2];
+    }
+    function->args_types = arena.copy(pending_names.data() + base, count);
+    function->args_ids = arena.copy(pending_names.data() + base + count * 2, count);
+    pending_names.resize(base);
 }
 
-const Lexer::Token& Parser::next() const {
-    if (!at_end()) {
-        return tokens[current + 1];
-    } else {
-        return peek();
+// Parsing restarts at the last global statement starting before the splice
+// and stops once a statement ends past the new tokens exactly where an old
+// statement started, from there on the token stream and so the parse is
+// unchanged. Global statements parse the same with or without a module
+// around them being open, 'use' statements parse the same anywhere.
+void Parser::reparse(const Lexer::Splice &splice) {
+    const auto start = std::chrono::high_resolution_clock::now();
+    success = true;
+    mod_prefix = "";
+    visits = 0;
+
+    pending_nodes.clear();
+    pending_names.clear();
+    pending_operators.clear();
+
+    // Replaced statements stay in the arena, once they outweigh the live
+    // tree start over with a fresh one.
+    if (arena.get_bytes() > parsed_bytes * 2 + Arena::block_size) {
+        parse();
+        const auto end = std::chrono::high_resolution_clock::now();
+        elapsed = std::chrono::duration<double, std::milli>(end - start).count();
+        return;
+    }
+
+    const std::ptrdiff_t delta = static_cast<std::ptrdiff_t>(splice.inserted) - static_cast<std::ptrdiff_t>(splice.removed);
+    const size_t first = std::lower_bound(starts.begin(), starts.end(), splice.first) - starts.begin();
+    const size_t from = first > 0 ? first - 1 : 0;
+
+    std::vector<Node*> statements;
+    std::vector<size_t> statement_starts;
+    size_t next = from;
+    current = from < starts.size() ? starts[from] : 0;
+    while (!at_end()) {
+        if (current >= splice.first + splice.inserted) {
+            const std::ptrdiff_t old = static_cast<std::ptrdiff_t>(current) - delta;
+            while (next < starts.size() && static_cast<std::ptrdiff_t>(starts[next]) < old) ++next;
+            if (next < starts.size() && static_cast<std::ptrdiff_t>(starts[next]) == old) break;
+        }
+        statement_starts.push_back(current);
+        statements.push_back(global_statement());
     }
+    if (at_end()) next = starts.size();
+
+    for (size_t i = next; i < starts.size(); ++i) {
+        starts[i] += delta;
+    }
+    ast.erase(ast.begin() + from, ast.begin() + next);
+    ast.insert(ast.begin() + from, statements.begin(), statements.end());
+    starts.erase(starts.begin() + from, starts.begin() + next);
+    starts.insert(starts.begin() + from, statement_starts.begin(), statement_starts.end());
+
+    const auto end = std::chrono::high_resolution_clock::now();
+    elapsed = std::chrono::duration<double, std::milli>(end - start).count();
 }
 
-const Lexer::Token& Parser::rewind() {
-    if (!at_end()) current--;
-    return next();
+bool Parser::at_end() const {
+    return lexer.is_end(current);
 }
 
-const Lexer::Token& Parser::advance() {
+bool Parser::check(const Lexer::TokenCategory &category, const size_t &ahead) const {
+    ++visits;
+    return lexer.get_category(current + ahead) == category;
+}
+
+const Lexer::Token Parser::peek() const {
+    ++visits;
+    return lexer.get(current);
+}
+
+const Lexer::Token Parser::previous() const {
+    ++visits;
+    return lexer.get(current - 1);
+}
+
+const Lexer::Token Parser::advance() {
     if (!at_end()) current++;
     return previous();
 }
 
-bool Parser::match(const std::initializer_list<std::string> &values) {
-    for (const std::string &type : values) {
-        if (peek().value == type) {
+bool Parser::check(const Interner::Symbol &symbol, const size_t &ahead) const {
+    ++visits;
+    return lexer.get_symbol(current + ahead) == symbol;
+}
+
+bool Parser::match(const std::initializer_list<Interner::Symbol> &symbols) {
+    ++visits;
+    const uint32_t symbol = lexer.get_symbol(current);
+    for (const auto &s : symbols) {
+        if (symbol == s) {
             advance();
             return true;
         }
@@ -60,451 +278,605 @@ bool Parser::match(const std::initializer_list<std::string> &values) {
     return false;
 }
 
-const Lexer::Token& Parser::consume(const std::string& type, const std::string& message) {
-    if (peek().value == type) return tokens[current++];
+const Lexer::Token Parser::consume(const Interner::Symbol &symbol, const std::string& message) {
+    ++visits;
+    if (lexer.get_symbol(current) == symbol) return lexer.get(current++);
 
     error(message);
 }
 
+// Runs of a parallel parse leave out the line, the line index is built
+// lazily and not safe to build from several threads. Their errors are
+// reported again by the serial parse that follows.
 void Parser::error(const std::string &msg) {
     success = false;
-    throw std::runtime_error("[Line " + std::to_string(peek().line) + "] " + msg);
+    if (chunk) throw std::runtime_error(msg);
+    throw std::runtime_error("[Line " + std::to_string(lexer.get_line(peek().offset)) + "] " + msg);
 }
 
-std::unique_ptr<Parser::Node> Parser::flag_statement() {
-    if (match({"use"})) return extern_declaration();
+Parser::Node *Parser::flag_statement() {
+    if (match({Interner::KEYWORD_USE})) return extern_declaration();
     throw std::runtime_error("Unexpected flag statement encountered.");
 }
 
-std::unique_ptr<Parser::Node> Parser::global_statement() {
-    if (match({"use"})) return extern_declaration();
-    if (match({"module"})) return module_declaration();
-    if (match({"class"})) return class_declaration();
-    if (peek().category == Lexer::IDENTIFIER) {
-        advance();
-        if (peek().category == Lexer::IDENTIFIER) {
-            advance();
-            if (match({"("})) return function_declaration();
-        }
-    }
+Parser::Node *Parser::global_statement() {
+    if (match({Interner::KEYWORD_USE})) return extern_declaration();
+    if (match({Interner::KEYWORD_MODULE})) return module_declaration();
+    if (match({Interner::KEYWORD_CLASS})) return class_declaration();
+    if (check(Lexer::IDENTIFIER) && check(Lexer::IDENTIFIER, 1) && check(Interner::PUNCTUATOR_LEFT_PAREN, 2)) return function_declaration();
     throw std::runtime_error("Unexpected global statement encountered.");
 }
 
-std::unique_ptr<Parser::Node> Parser::statement() {
-    if (match({"{"})) return scope_declaration();
-    if (match({"if", "else"})) return conditional_statement();
-    if (match({"while"})) return while_loop_statement();
-    if (match({"return"})) return return_statement();
+Parser::Node *Parser::statement() {
+    if (match({Interner::PUNCTUATOR_LEFT_BRACE})) return scope_declaration();
+    if (match({Interner::KEYWORD_IF, Interner::KEYWORD_ELSE})) return conditional_statement();
+    if (match({Interner::KEYWORD_WHILE})) return while_loop_statement();
+    if (match({Interner::KEYWORD_RETURN})) return return_statement();
+    if (match({Interner::KEYWORD_FINAL})) {
+        auto decl = static_cast<VariableDeclaration*>(variable_declaration());
+        decl->is_final = true;
+        return decl;
+    }
 
-    if (peek().category == Lexer::IDENTIFIER) {
+    if (check(Lexer::IDENTIFIER)) {
         std::string mod = "";
-        advance();
         return modular_statement(mod);
     }
 
-    if (match({";"})) return std::make_unique<EmptyStatement>();
+    if (match({Interner::PUNCTUATOR_SEMICOLON})) return empty;
 
     return expression();
 }
 
-std::unique_ptr<Parser::Node> Parser::modular_statement(std::string &mod) {
-    if (match({"."})) {
-        rewind();
-        mod += previous().value + ".";
-        advance();
-        advance();
-        return modular_statement(mod);
+static bool is_assignment(const uint32_t &symbol) {
+    switch (symbol) {
+        case Interner::OPERATOR_ASSIGN:
+        case Interner::OPERATOR_ADD_ASSIGN:
+        case Interner::OPERATOR_SUB_ASSIGN:
+        case Interner::OPERATOR_MUL_ASSIGN:
+        case Interner::OPERATOR_POW_ASSIGN:
+        case Interner::OPERATOR_DIV_ASSIGN:
+        case Interner::OPERATOR_MOD_ASSIGN:
+        case Interner::OPERATOR_AND_ASSIGN:
+        case Interner::OPERATOR_OR_ASSIGN:
+        case Interner::OPERATOR_XOR_ASSIGN:
+        case Interner::OPERATOR_SHL_ASSIGN:
+        case Interner::OPERATOR_SHR_ASSIGN:
+            return true;
     }
+    return false;
+}
 
-    if (match({"=", "+=", "-=", "*=", "/=", "%="})) return variable_assignment(mod);
-    if (match({"("})) return function_call(mod);
-
-    if (peek().category == Lexer::IDENTIFIER) {
+// Called on an identifier, the token after it tells what kind of statement
+// this is.
+Parser::Node *Parser::modular_statement(std::string &mod) {
+    while (check(Interner::PUNCTUATOR_DOT, 1)) {
+        mod += advance().value;
+        mod += ".";
         advance();
-        if (match({"="})) return variable_declaration(true);
-        else return variable_declaration(false);
     }
 
+    ++visits;
+    if (is_assignment(lexer.get_symbol(current + 1))) return variable_assignment(mod);
+    if (check(Interner::PUNCTUATOR_LEFT_PAREN, 1)) return function_call(mod);
+    if (check(Lexer::IDENTIFIER, 1)) return variable_declaration();
+
+    advance();
     return expression();
 }
 
-std::unique_ptr<Parser::Node> Parser::variable_declaration(const bool &initialized) {
-    for (int i = 0; i < (initialized ? 3 : 2); ++i) rewind();
-    std::string type, identifier;
-    if (peek().category == Lexer::IDENTIFIER) {
-        type = advance().value;
+Parser::Node *Parser::variable_declaration() {
+    std::string_view type, identifier;
+    if (check(Lexer::IDENTIFIER)) {
+        type = arena.copy(advance().value);
     } else {
-        error("Expected variable type, not '" + peek().value + "'");
+        error("Expected variable type, not '" + std::string(peek().value) + "'");
     }
-    if (peek().category == Lexer::IDENTIFIER) {
-        identifier = advance().value;
+    if (check(Lexer::IDENTIFIER)) {
+        identifier = arena.copy(advance().value);
     } else {
-        error("Expected variable type, not '" + peek().value + "'");
+        error("Expected variable type, not '" + std::string(peek().value) + "'");
     }
 
-    if (initialized) {
-        consume("=", "Expected '='");
+    if (match({Interner::OPERATOR_ASSIGN})) {
         auto value = expression();
-        consume(";", "Expected ';' after statement");
-        return std::make_unique<VariableDeclaration>(type, identifier, std::move(value));
+        consume(Interner::PUNCTUATOR_SEMICOLON, "Expected ';' after statement");
+        return arena.make<VariableDeclaration>(type, identifier, value);
     } else {
-        auto value = std::make_unique<EmptyStatement>();
-        consume(";", "Expected ';' after statement");
-        return std::make_unique<VariableDeclaration>(type, identifier, std::move(value));
+        consume(Interner::PUNCTUATOR_SEMICOLON, "Expected ';' after statement");
+        return arena.make<VariableDeclaration>(type, identifier, empty);
     }
 }
 
-std::unique_ptr<Parser::Node> Parser::function_declaration() {
-    auto function = std::make_unique<FunctionDeclaration>();
-    for (int i = 0; i < 3; ++i) rewind();
-    if (peek().category == Lexer::IDENTIFIER) {
-        function->type = advance().value;
+Parser::Node *Parser::function_declaration() {
+    auto function = arena.make<FunctionDeclaration>();
+    if (check(Lexer::IDENTIFIER)) {
+        function->type = arena.copy(advance().value);
     } else {
         error("Expected function type");
     }
-    if (peek().category == Lexer::IDENTIFIER) {
-        function->identifier = mod_prefix + advance().value;
+    if (check(Lexer::IDENTIFIER)) {
+        function->identifier = arena.copy(mod_prefix + std::string(advance().value));
     } else {
         error("Expected function identifer");
     }
-    consume("(", "Expected '('");
-    while (peek().value != ")") {
-        function->args_types.push_back(advance().value);
-        function->args_ids.push_back(advance().value);
-        if (peek().value != ")") {
-            consume(",", "Expected ','");
-        }
-    }
-    consume(")", "Expected ')' after statement");
-    function->statement = std::move(statement());
+    parameters(function);
+    function->statement = statement();
     return function;
 }
 
-std::unique_ptr<Parser::Node> Parser::extern_declaration() {
+Parser::Node *Parser::extern_declaration() {
     std::string path = "";
-    while (!match({";"})) {
+    while (!match({Interner::PUNCTUATOR_SEMICOLON})) {
         path += peek().value;
         advance();
     }
-    return std::make_unique<Extern>(path);
+    return arena.make<Extern>(arena.copy(path));
 }
 
-std::unique_ptr<Parser::Node> Parser::module_declaration() {
-    auto mod = std::make_unique<Module>();
-    mod->id = advance().value;
-    mod_prefix += mod->id + ".";
-    if (match({"{"})) {
-        auto scope = std::make_unique<ScopeDeclaration>();
-        while (!match({"}"})) {
-            scope->ast.push_back(std::move(global_statement()));
+Parser::Node *Parser::module_declaration() {
+    auto mod = arena.make<Module>();
+    mod->id = arena.copy(advance().value);
+    mod_prefix += std::string(mod->id) + ".";
+    if (match({Interner::PUNCTUATOR_LEFT_BRACE})) {
+        auto scope = arena.make<ScopeDeclaration>();
+        const size_t base = pending_nodes.size();
+        while (!match({Interner::PUNCTUATOR_RIGHT_BRACE})) {
+            pending_nodes.push_back(global_statement());
         }
-        mod->statement = std::move(scope);
+        scope->ast = collect(base);
+        mod->statement = scope;
     } else {
-        mod->statement = std::move(global_statement());
+        mod->statement = global_statement();
     }
     mod_prefix = "";
     return mod;
 }
 
-std::unique_ptr<Parser::Node> Parser::class_declaration() {
-    auto decl = std::make_unique<ClassDeclaration>();
-    decl->identifier = advance().value;
-    if (match({"{"})) {
-        auto scope = std::make_unique<ScopeDeclaration>();
-        while (!match({"}"})) {
-            scope->ast.push_back(std::move(class_statement()));
+Parser::Node *Parser::class_declaration() {
+    auto decl = arena.make<ClassDeclaration>();
+    decl->identifier = arena.copy(advance().value);
+    if (match({Interner::PUNCTUATOR_LEFT_BRACE})) {
+        auto scope = arena.make<ScopeDeclaration>();
+        const size_t base = pending_nodes.size();
+        while (!match({Interner::PUNCTUATOR_RIGHT_BRACE})) {
+            pending_nodes.push_back(class_statement());
         }
-        decl->statement = std::move(scope);
+        scope->ast = collect(base);
+        decl->statement = scope;
     } else {
-        decl->statement = std::move(class_statement());
+        decl->statement = class_statement();
     }
     return decl;
 }
 
-std::unique_ptr<Parser::Node> Parser::class_statement() {
-    auto member = std::make_unique<ClassMember>();
+Parser::Node *Parser::class_statement() {
+    auto member = arena.make<ClassMember>();
+    member->statement = empty;
 
-    if (match({"public", "protected", "private"})) {
-        if (previous().value == "public") member->access = ClassMember::PUBLIC;
-        if (previous().value == "protected") member->access = ClassMember::PROTECTED;
-        if (previous().value == "private") member->access = ClassMember::PRIVATE;
+    if (match({Interner::KEYWORD_PUBLIC, Interner::NAME_PROTECTED, Interner::KEYWORD_PRIVATE})) {
+        if (previous().symbol == Interner::KEYWORD_PUBLIC) member->access = ClassMember::PUBLIC;
+        if (previous().symbol == Interner::NAME_PROTECTED) member->access = ClassMember::PROTECTED;
+        if (previous().symbol == Interner::KEYWORD_PRIVATE) member->access = ClassMember::PRIVATE;
     } else {
         member->access = ClassMember::PRIVATE;
     }
 
-    if (match({"constructor"})) member->statement = constructor_declaration();
-    else if (match({"destructor"})) member->statement = destructor_declaration();
-    else if (peek().category == Lexer::IDENTIFIER) {
-        advance();
-        if (peek().category == Lexer::IDENTIFIER) {
-            advance();
-            if (match({"("})) member->statement = function_declaration();
-            else if (match({"="})) member->statement = variable_declaration(true);
-            else member->statement = variable_declaration(false);
-        }
+    if (check(Interner::KEYWORD_CONSTRUCTOR)) member->statement = constructor_declaration();
+    else if (check(Interner::KEYWORD_DESTRUCTOR)) member->statement = destructor_declaration();
+    else if (check(Lexer::IDENTIFIER)) {
+        if (!check(Lexer::IDENTIFIER, 1)) advance();
+        else if (check(Interner::PUNCTUATOR_LEFT_PAREN, 2)) member->statement = function_declaration();
+        else member->statement = variable_declaration();
     } else {
-        throw std::runtime_error("Unexpected class member statement encountered: " + peek().value);
+        throw std::runtime_error("Unexpected class member statement encountered: " + std::string(peek().value));
     }
 
     return member;
 }
 
-std::unique_ptr<Parser::Node> Parser::constructor_declaration() {
-    auto function = std::make_unique<FunctionDeclaration>();
-    rewind();
-    if (peek().category == Lexer::KEYWORD) {
-        function->type = peek().value;
-        function->identifier = advance().value;
+Parser::Node *Parser::constructor_declaration() {
+    auto function = arena.make<FunctionDeclaration>();
+    if (check(Lexer::KEYWORD)) {
+        function->type = arena.copy(peek().value);
+        function->identifier = function->type;
+        advance();
     } else {
         error("Expected function type");
     }
-    consume("(", "Expected '('");
-    while (peek().value != ")") {
-        function->args_types.push_back(advance().value);
-        function->args_ids.push_back(advance().value);
-        if (peek().value != ")") {
-            consume(",", "Expected ','");
-        }
-    }
-    consume(")", "Expected ')' after statement");
-    function->statement = std::move(statement());
+    parameters(function);
+    function->statement = statement();
     return function;
 }
 
-std::unique_ptr<Parser::Node> Parser::destructor_declaration() {
-    auto function = std::make_unique<FunctionDeclaration>();
-    rewind();
-    if (peek().category == Lexer::KEYWORD) {
-        function->type = peek().value;
-        function->identifier = advance().value;
+Parser::Node *Parser::destructor_declaration() {
+    auto function = arena.make<FunctionDeclaration>();
+    if (check(Lexer::KEYWORD)) {
+        function->type = arena.copy(peek().value);
+        function->identifier = function->type;
+        advance();
     } else {
         error("Expected function type");
     }
-    consume("(", "Expected '('");
-    while (peek().value != ")") {
-        function->args_types.push_back(advance().value);
-        function->args_ids.push_back(advance().value);
-        if (peek().value != ")") {
-            consume(",", "Expected ','");
-        }
-    }
-    consume(")", "Expected ')' after statement");
-    function->statement = std::move(statement());
+    parameters(function);
+    function->statement = statement();
     return function;
 }
 
-std::unique_ptr<Parser::Node> Parser::variable_assignment(const std::string &mod) {
-    for (int i = 0; i < 2; ++i) rewind();
-    std::string identifier = advance().value;
-    std::string op;
-    if (peek().category == Lexer::OPERATOR) {
-        op = advance().value;
-    } else {
-        error("Expected operator");
-    }
+Parser::Node *Parser::variable_assignment(const std::string &mod) {
+    const std::string_view identifier = arena.copy(advance().value);
+    const uint32_t op = advance().symbol;
     auto value = expression();
-    consume(";", "Expected ';' after statement");
+    consume(Interner::PUNCTUATOR_SEMICOLON, "Expected ';' after statement");
 
-    if (op == "=") {
-        return std::make_unique<VariableAssignment>(identifier, std::move(value));
+    if (op == Interner::OPERATOR_ASSIGN) {
+        return arena.make<VariableAssignment>(identifier, value);
     } else {
-        auto expr = std::make_unique<BinaryOperation>();
-        expr->left = std::make_unique<VariableCall>(identifier);
-        if (op == "+=") {
-            expr->op = "+";
-        } else if (op == "-=") {
-            expr->op = "-";
-        } else if (op == "*=") {
-            expr->op = "*";
-        } else if (op == "/=") {
-            expr->op = "/";
-        } else if (op == "%=") {
-            expr->op = "%";
-        }
-        expr->right = std::move(value);
+        // Compound assignments directly follow their operator in the interner.
+        auto expr = arena.make<BinaryOperation>();
+        expr->left = arena.make<VariableCall>(identifier);
+        expr->op = Interner::fixed[op - 1];
+        expr->right = value;
 
-        return std::make_unique<VariableAssignment>(identifier, std::move(expr));
+        return arena.make<VariableAssignment>(identifier, expr);
     }
 }
 
-std::unique_ptr<Parser::Node> Parser::scope_declaration() {
-    auto scope = std::make_unique<ScopeDeclaration>();
-    while (!match({"}"})) {
-        scope->ast.push_back(std::move(statement()));
+Parser::Node *Parser::scope_declaration() {
+    auto scope = arena.make<ScopeDeclaration>();
+    const size_t base = pending_nodes.size();
+    while (!match({Interner::PUNCTUATOR_RIGHT_BRACE})) {
+        pending_nodes.push_back(statement());
     }
+    scope->ast = collect(base);
     return scope;
 }
 
-std::unique_ptr<Parser::Node> Parser::conditional_statement() {
-    auto conditional = std::make_unique<ConditionalStatement>();
-    consume("(", "Expected '('");
-    conditional->condition = std::move(expression());
-    consume(")", "Expected ')'");
-    conditional->pass_statement = std::move(statement());
-    if (peek().value == "else") {
+Parser::Node *Parser::conditional_statement() {
+    auto conditional = arena.make<ConditionalStatement>();
+    consume(Interner::PUNCTUATOR_LEFT_PAREN, "Expected '('");
+    conditional->condition = expression();
+    consume(Interner::PUNCTUATOR_RIGHT_PAREN, "Expected ')'");
+    conditional->pass_statement = statement();
+    conditional->fail_statement = empty;
+    if (check(Interner::KEYWORD_ELSE)) {
         advance();
-        conditional->fail_statement = std::move(statement());
+        conditional->fail_statement = statement();
     }
     return conditional;
 }
 
-std::unique_ptr<Parser::Node> Parser::while_loop_statement() {
-    auto loop_statement = std::make_unique<WhileLoopStatement>();
-    consume("(", "Expected '('");
-    loop_statement->condition = std::move(expression());
-    consume(")", "Expected ')'");
-    loop_statement->statement = std::move(statement());
+Parser::Node *Parser::while_loop_statement() {
+    auto loop_statement = arena.make<WhileLoopStatement>();
+    consume(Interner::PUNCTUATOR_LEFT_PAREN, "Expected '('");
+    loop_statement->condition = expression();
+    consume(Interner::PUNCTUATOR_RIGHT_PAREN, "Expected ')'");
+    loop_statement->statement = statement();
     return loop_statement;
 }
 
-std::unique_ptr<Parser::Node> Parser::return_statement() {
-    auto return_statement = std::make_unique<ReturnStatement>();
-    if (peek().value == ";") {
-        return_statement->expr = std::make_unique<EmptyStatement>();
+Parser::Node *Parser::return_statement() {
+    auto return_statement = arena.make<ReturnStatement>();
+    if (check(Interner::PUNCTUATOR_SEMICOLON)) {
+        return_statement->expr = empty;
     } else {
-        return_statement->expr = std::move(expression());
+        return_statement->expr = expression();
     }
-    consume(";", "Expected ';' after statement");
+    consume(Interner::PUNCTUATOR_SEMICOLON, "Expected ';' after statement");
     return return_statement;
 }
 
 
-std::unique_ptr<Parser::Node> Parser::function_call(const std::string &mod) {
-    for (int i = 0; i < 2; ++i) rewind();
-    auto function = std::make_unique<FunctionCall>(mod + advance().value);
-    consume("(", "Expected '('");
-    while (!match({")"})) {
-        function->args.push_back(std::move(expression()));
-        if (peek().value != ")") {
-            consume(",", "Expected ','");
+Parser::Node *Parser::function_call(const std::string &mod) {
+    auto function = arena.make<FunctionCall>(arena.copy(mod + std::string(advance().value)));
+    consume(Interner::PUNCTUATOR_LEFT_PAREN, "Expected '('");
+    const size_t base = pending_nodes.size();
+    while (!match({Interner::PUNCTUATOR_RIGHT_PAREN})) {
+        pending_nodes.push_back(expression());
+        if (!check(Interner::PUNCTUATOR_RIGHT_PAREN)) {
+            consume(Interner::PUNCTUATOR_COMMA, "Expected ','");
         }
     }
-    consume(";", "Expected ';' after statement");
+    function->args = collect(base);
+    consume(Interner::PUNCTUATOR_SEMICOLON, "Expected ';' after statement");
     return function;
 }
 
-std::unique_ptr<Parser::Node> Parser::expression() {
-    return equality();
-}
-
-std::unique_ptr<Parser::Node> Parser::equality() {
-    auto expr = comparison();
+// Binding power of each fixed symbol used as an infix or postfix operator,
+// higher binds tighter and 0 ends the expression. Prefix operators bind
+// tighter than every infix operator except '**'.
+static constexpr uint8_t prefix_power = 26;
+
+static constexpr std::array<uint8_t, Interner::DYNAMIC> make_powers() {
+    std::array<uint8_t, Interner::DYNAMIC> powers = {};
+    powers[Interner::OPERATOR_LOGICAL_OR] = 2;
+    powers[Interner::OPERATOR_LOGICAL_AND] = 4;
+    powers[Interner::OPERATOR_OR] = 6;
+    powers[Interner::OPERATOR_XOR] = 8;
+    powers[Interner::OPERATOR_AND] = 10;
+    powers[Interner::OPERATOR_EQUAL] = powers[Interner::OPERATOR_NOT_EQUAL] = 12;
+    powers[Interner::OPERATOR_LESS] = powers[Interner::OPERATOR_LESS_EQUAL] = 14;
+    powers[Interner::OPERATOR_GREATER] = powers[Interner::OPERATOR_GREATER_EQUAL] = 14;
+    powers[Interner::KEYWORD_AS] = 16;
+    powers[Interner::OPERATOR_SHL] = powers[Interner::OPERATOR_SHR] = 18;
+    powers[Interner::OPERATOR_ADD] = powers[Interner::OPERATOR_SUB] = 20;
+    powers[Interner::OPERATOR_MUL] = powers[Interner::OPERATOR_DIV] = powers[Interner::OPERATOR_FLOOR_DIV] = 22;
+    powers[Interner::OPERATOR_MOD] = 24;
+    powers[Interner::OPERATOR_POW] = 28;
+    return powers;
+}
+
+static constexpr std::array<uint8_t, Interner::DYNAMIC> powers = make_powers();
+
+// Precedence climbing without recursion. An operator that binds tighter than
+// 'power' waits on 'pending_operators' for its right side, together with the
+// power in effect before it, otherwise the expression read so far becomes
+// the right side of the innermost waiting operator. Nesting and runs of
+// operators take entries of that stack instead of native frames, so the
+// depth of an expression is not limited by the call stack.
+Parser::Node *Parser::expression() {
+    const size_t base = pending_operators.size();
+    uint8_t power = 0;
+
+    while (true) {
+        if (match({Interner::OPERATOR_SUB, Interner::OPERATOR_NOT, Interner::OPERATOR_COMPLEMENT})) {
+            pending_operators.push_back({nullptr, previous().symbol, power});
+            power = prefix_power;
+            continue;
+        }
+        if (match({Interner::PUNCTUATOR_LEFT_PAREN})) {
+            pending_operators.push_back({nullptr, Interner::PUNCTUATOR_LEFT_PAREN, power});
+            power = 0;
+            continue;
+        }
 
-    while (match({"==", "!="})) {
-        std::string op = previous().value;
-        auto right = comparison();
-        expr = std::make_unique<BinaryOperation>(std::move(expr), op, std::move(right));
-    }
+        Node *expr = primary();
 
-    return expr;
-}
+        while (true) {
+            const uint32_t symbol = lexer.get_symbol(current);
+            const uint8_t left = symbol < Interner::DYNAMIC ? powers[symbol] : 0;
+            if (left > power) {
+                advance();
+                if (symbol == Interner::KEYWORD_AS) {
+                    expr = arena.make<CastOperation>(expr, arena.copy(advance().value));
+                    continue;
+                }
 
-std::unique_ptr<Parser::Node> Parser::comparison() {
-    auto expr = cast();
+                // '**' is right associative, its right side may hold another '**'.
+                pending_operators.push_back({expr, symbol, power});
+                power = symbol == Interner::OPERATOR_POW ? left - 1 : left;
+                break;
+            }
 
-    while (match({"<", "<=", ">", ">="})) {
-        std::string op = previous().value;
-        auto right = cast();
-        expr = std::make_unique<BinaryOperation>(std::move(expr), op, std::move(right));
+            if (pending_operators.size() == base) return expr;
+
+            const PendingOperator op = pending_operators.back();
+            pending_operators.pop_back();
+            power = op.power;
+            if (op.symbol == Interner::PUNCTUATOR_LEFT_PAREN) {
+                consume(Interner::PUNCTUATOR_RIGHT_PAREN, "Expected ')' after expression");
+            } else if (op.left) {
+                expr = arena.make<BinaryOperation>(op.left, Interner::fixed[op.symbol], expr);
+            } else {
+                expr = arena.make<UnaryOperation>(Interner::fixed[op.symbol], expr);
+            }
+        }
     }
-
-    return expr;
 }
 
-std::unique_ptr<Parser::Node> Parser::cast() {
-    auto expr = term();
-
-    while (match({"as"})) {
-        expr = std::make_unique<CastOperation>(std::move(expr), advance().value);
+Parser::Node *Parser::primary() {
+    if (check(Lexer::INTEGER_LITERAL)) {
+        return arena.make<IntegerLiteral>(arena.copy(advance().value));
+    } else if (check(Lexer::FLOAT_LITERAL)) {
+        return arena.make<FloatLiteral>(arena.copy(advance().value));
+    } else if (check(Lexer::BOOLEAN_LITERAL)) {
+        return arena.make<BooleanLiteral>(advance().symbol == Interner::LITERAL_TRUE);
+    } else if (check(Lexer::STRING_LITERAL)) {
+        return arena.make<StringLiteral>(arena.copy(advance().value));
+    } else if (check(Lexer::IDENTIFIER)) {
+        if (check(Interner::PUNCTUATOR_LEFT_PAREN, 1)) {
+            auto function = arena.make<FunctionCall>(arena.copy(advance().value));
+            advance();
+            const size_t base = pending_nodes.size();
+            while (!check(Interner::PUNCTUATOR_RIGHT_PAREN)) {
+                pending_nodes.push_back(expression());
+                if (!check(Interner::PUNCTUATOR_RIGHT_PAREN)) {
+                    consume(Interner::PUNCTUATOR_COMMA, "Expected ','");
+                }
+            }
+            function->args = collect(base);
+            consume(Interner::PUNCTUATOR_RIGHT_PAREN, "Expected ')'");
+            return function;
+        } else {
+            return arena.make<VariableCall>(arena.copy(advance().value));
+        }
     }
-
-    return expr;
+    error("Unexpected token '" + std::string(peek().value) + "'");
 }
 
-std::unique_ptr<Parser::Node> Parser::term() {
-    auto expr = factor();
-
-    while (match({"+", "-"})) {
-        std::string op = previous().value;
-        auto right = factor();
-        expr = std::make_unique<BinaryOperation>(std::move(expr), op, std::move(right));
-    }
-
-    return expr;
+const std::vector<Parser::Node*>& Parser::get() const {
+    return ast;
 }
 
-std::unique_ptr<Parser::Node> Parser::factor() {
-    auto expr = remainder();
-
-    while (match({"*", "/"})) {
-        std::string op = previous().value;
-        auto right = remainder();
-        expr = std::make_unique<BinaryOperation>(std::move(expr), op, std::move(right));
-    }
-
-    return expr;
+const Arena& Parser::get_arena() const {
+    return arena;
 }
 
-std::unique_ptr<Parser::Node> Parser::remainder() {
-    auto expr = unary();
-
-    while (match({"%"})) {
-        std::string op = previous().value;
-        auto right = unary();
-        expr = std::make_unique<BinaryOperation>(std::move(expr), op, std::move(right));
-    }
+const bool& Parser::get_success() const {
+    return success;
+}
 
-    return expr;
+const double& Parser::get_elapsed() const {
+    return elapsed;
 }
 
-std::unique_ptr<Parser::Node> Parser::unary() {
-    if (match({"-", "!"})) {
-        std::string op = previous().value;
-        auto right = unary();
-        return std::make_unique<UnaryOperation>(op, std::move(right));
-    }
+// Each node prints what comes before its first child and leaves the rest on
+// the stack in reverse, children as nodes and everything else as text.
+void Parser::Node::log() const {
+    std::vector<std::pair<const Node*, std::string_view>> stack = {{this, {}}};
+    const auto visit = [&stack](const Node *child) {
+        stack.push_back({child, {}});
+    };
+    const auto text = [&stack](const std::string_view &value) {
+        stack.push_back({nullptr, value});
+    };
 
-    return primary();
-}
+    while (!stack.empty()) {
+        const auto [node, piece] = stack.back();
+        stack.pop_back();
+        if (!node) {
+            std::cout << piece;
+            continue;
+        }
 
-std::unique_ptr<Parser::Node> Parser::primary() {
-    if (peek().category == Lexer::INTEGER_LITERAL) {
-        return std::make_unique<IntegerLiteral>(advance().value);
-    } else if (peek().category == Lexer::FLOAT_LITERAL) {
-        return std::make_unique<FloatLiteral>(advance().value);
-    } else if (peek().category == Lexer::BOOLEAN_LITERAL) {
-        return std::make_unique<BooleanLiteral>(advance().value == "true");
-    } else if (peek().category == Lexer::STRING_LITERAL) {
-        return std::make_unique<StringLiteral>(advance().value);
-    } else if (peek().category == Lexer::IDENTIFIER) {
-        if (next().value == "(") {
-            auto function = std::make_unique<FunctionCall>(advance().value);
-            advance();
-            while (peek().value != ")") {
-                function->args.push_back(std::move(expression()));
-                if (peek().value != ")") {
-                    consume(",", "Expected ','");
+        switch (node->kind) {
+            case BINARY_OPERATION: {
+                const auto *n = static_cast<const BinaryOperation*>(node);
+                std::cout << "BinaryOperation: (left: (";
+                text("))");
+                visit(n->right);
+                text("', right: (");
+                text(n->op);
+                text("), op: '");
+                visit(n->left);
+                break;
+            }
+            case CAST_OPERATION: {
+                const auto *n = static_cast<const CastOperation*>(node);
+                std::cout << "CastOperation: (left: (";
+                text("')");
+                text(n->right);
+                text("), right: '");
+                visit(n->left);
+                break;
+            }
+            case UNARY_OPERATION: {
+                const auto *n = static_cast<const UnaryOperation*>(node);
+                std::cout << "UnaryOperation: (op: '" << n->op << "', value: (";
+                text("))");
+                visit(n->value);
+                break;
+            }
+            case INTEGER_LITERAL:
+                std::cout << "IntegerLiteral: '" << static_cast<const IntegerLiteral*>(node)->value << "'";
+                break;
+            case FLOAT_LITERAL:
+                std::cout << "FloatLiteral: '" << static_cast<const FloatLiteral*>(node)->value << "'";
+                break;
+            case BOOLEAN_LITERAL:
+                std::cout << "BooleanLiteral: '" << (static_cast<const BooleanLiteral*>(node)->value ? "true" : "false") << "'";
+                break;
+            case STRING_LITERAL:
+                std::cout << "StringLiteral: '" << static_cast<const StringLiteral*>(node)->value << "'";
+                break;
+            case VARIABLE_DECLARATION: {
+                const auto *n = static_cast<const VariableDeclaration*>(node);
+                std::cout << "VariableDeclaration: (type: '" << n->type << "', identifier: '" << n->identifier << "', final: '" << (n->is_final ? "true" : "false") << "', expr: (";
+                text("))");
+                visit(n->expr);
+                break;
+            }
+            case VARIABLE_ASSIGNMENT: {
+                const auto *n = static_cast<const VariableAssignment*>(node);
+                std::cout << "VariableAssignment: (identifier: '" << n->identifier << "', expr: (";
+                text("))");
+                visit(n->expr);
+                break;
+            }
+            case VARIABLE_CALL:
+                std::cout << "VariableCall: '" << static_cast<const VariableCall*>(node)->identifier << "'";
+                break;
+            case FUNCTION_DECLARATION: {
+                const auto *n = static_cast<const FunctionDeclaration*>(node);
+                std::cout << "FunctionDeclaration: (identifier: '" << n->identifier << "', args: (";
+                for (size_t i = 0; i < n->args_ids.size(); ++i) {
+                    if (i > 0) std::cout << ", ";
+                    std::cout << '(' << n->args_types[i] << ", " << n->args_ids[i] << ')';
                 }
+                std::cout << "), statement: (";
+                text("))");
+                visit(n->statement);
+                break;
+            }
+            case RETURN_STATEMENT:
+                std::cout << "ReturnStatement: (expr: (";
+                text("))");
+                visit(static_cast<const ReturnStatement*>(node)->expr);
+                break;
+            case FUNCTION_CALL: {
+                const auto *n = static_cast<const FunctionCall*>(node);
+                std::cout << "FunctionCall: (identifier: '" << n->identifier << "', args: (";
+                text("))");
+                for (size_t k = n->args.size(); k-- > 0;) {
+                    if (k + 1 < n->args.size()) text(", ");
+                    visit(n->args[k]);
+                }
+                break;
+            }
+            case CONDITIONAL_STATEMENT: {
+                const auto *n = static_cast<const ConditionalStatement*>(node);
+                std::cout << "ConditionalStatement: (condition: (";
+                text("))");
+                visit(n->fail_statement);
+                text("), fail_statement: (");
+                visit(n->pass_statement);
+                text("), pass_statement: (");
+                visit(n->condition);
+                break;
+            }
+            case SCOPE_DECLARATION: {
+                const auto &ast = static_cast<const ScopeDeclaration*>(node)->ast;
+                std::cout << "ScopeDeclaration: (ast: {" << '\n';
+                text("})");
+                for (size_t k = ast.size(); k-- > 0;) {
+                    text("\n");
+                    visit(ast[k]);
+                    text("\t");
+                }
+                break;
+            }
+            case EMPTY_STATEMENT:
+                std::cout << "EmptyStatement";
+                break;
+            case WHILE_LOOP_STATEMENT: {
+                const auto *n = static_cast<const WhileLoopStatement*>(node);
+                std::cout << "WhileLoopStatement: (condition: (";
+                text("))");
+                visit(n->statement);
+                text("), statement: (");
+                visit(n->condition);
+                break;
+            }
+            case CLASS_MEMBER: {
+                const auto *n = static_cast<const ClassMember*>(node);
+                std::string_view access;
+                if (n->access == ClassMember::PUBLIC) access = "public";
+                else if (n->access == ClassMember::PROTECTED) access = "protected";
+                else if (n->access == ClassMember::PRIVATE) access = "private";
+                std::cout << "ClassMember: (access: " << access << ", statement: (";
+                text(")");
+                visit(n->statement);
+                break;
+            }
+            case CLASS_DECLARATION: {
+                const auto *n = static_cast<const ClassDeclaration*>(node);
+                std::cout << "ClassDeclaration: (identifier: '" << n->identifier << "', statement:" << '\n';
+                text(")");
+                visit(n->statement);
+                break;
+            }
+            case EXTERN:
+                std::cout << "Extern: (id: '" << static_cast<const Extern*>(node)->id << "')";
+                break;
+            case MODULE: {
+                const auto *n = static_cast<const Module*>(node);
+                std::cout << "Module: (id: '" << n->id << "', statement; (";
+                text("))");
+                visit(n->statement);
+                break;
             }
-            consume(")", "Expected ')'");
-            return function;
-        } else {
-            return std::make_unique<VariableCall>(advance().value);
         }
-    } else if (match({"("})) {
-        auto expr = expression();
-        consume(")", "Expected ')' after expression");
-        return expr;
     }
-    error("Unexpected token '" + peek().value + "'");
-}
-
-const std::vector<std::unique_ptr<Parser::Node>>& Parser::get() const {
-    return ast;
-}
-
-const bool& Parser::get_success() const {
-    return success;
 }
 
 void Parser::log() const {
@@ -514,4 +886,7 @@ void Parser::log() const {
         std::cout << '\n';
     }
     std::cout << '\n';
+    std::cout << "Allocated " << arena.get_objects() << " node(s) and " << arena.get_bytes() << " byte(s) in " << arena.get_blocks() << " block(s)" << '\n';
+    std::cout << "Visited " << visits << " token(s) for " << lexer.size() << " token(s)" << '\n';
+    std::cout << '\n';
 }
\ No newline at end of file
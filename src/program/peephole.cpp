@@ -0,0 +1,258 @@
+#include <program/peephole.h>
+
+using Instruction = IRGenerator::Instruction;
+
+// Whether 'operand' is register 'reg' or addresses memory through it.
+static const bool uses(const Operand &operand, const Operand::Register &reg) {
+    if (operand.kind == Operand::REGISTER) return operand.base == reg;
+    return operand.kind == Operand::MEMORY && (operand.base == reg || operand.index == reg);
+}
+
+static const bool is_move(const Instruction &instruction) {
+    switch (instruction.op) {
+        case Instruction::MOV:
+        case Instruction::MOVSX:
+        case Instruction::MOVSXD:
+        case Instruction::MOVZX:
+        case Instruction::LEA:
+            return true;
+        default:
+            return false;
+    }
+}
+
+static const bool is_jump(const Instruction &instruction) {
+    return instruction.op >= Instruction::JMP && instruction.op <= Instruction::JBE;
+}
+
+static const bool is_scratch(const Operand &operand) {
+    if (operand.kind != Operand::REGISTER) return false;
+    switch (operand.base) {
+        case Operand::RAX:
+        case Operand::RCX:
+        case Operand::RDX:
+        case Operand::R10:
+        case Operand::R11:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Whether scratch register 'reg' is written before it is read again in the
+// instructions from 'window'. Lowering may keep a scratch register live
+// across a label or a jump, as the loop of a POW does, so reaching one
+// counts as a read. Instructions using one implicitly count as reading it.
+static const bool is_dead(const Operand::Register &reg, const Instruction *window, const size_t &count) {
+    for (size_t i = 0; i < count; ++i) {
+        const Instruction &instruction = window[i];
+        if (instruction.op == Instruction::LABEL || is_jump(instruction)) return false;
+        switch (instruction.op) {
+            case Instruction::CDQ:
+            case Instruction::CQO:
+            case Instruction::IDIV:
+            case Instruction::DIV:
+            case Instruction::CALL:
+            case Instruction::RET:
+                return false;
+            default:
+                break;
+        }
+        if (uses(instruction.src, reg)) return false;
+        if (uses(instruction.dst, reg)) {
+            return is_move(instruction) && instruction.dst.kind == Operand::REGISTER && instruction.dst.size >= 4;
+        }
+    }
+    return true;
+}
+
+// Each rule is given the instructions from the one it starts at to the end
+// of the function. It returns how many of them it matched, 0 for none, and
+// appends what replaces them to 'out'.
+using Apply = size_t (*)(const Instruction *window, const size_t &count, std::vector<Instruction> &out);
+
+// mov r, r at any width but a dword, which clears the upper half.
+static size_t self_move(const Instruction *window, const size_t &/*count*/, std::vector<Instruction> &/*out*/) {
+    const Instruction &i = window[0];
+    if (i.op != Instruction::MOV || i.dst.kind != Operand::REGISTER || i.dst != i.src || i.dst.size == 4) return 0;
+    return 1;
+}
+
+// Operations by an immediate that leave their operand as it is: adding,
+// subtracting, or, xor and shifts by 0 and multiplying by 1.
+static size_t identity(const Instruction *window, const size_t &/*count*/, std::vector<Instruction> &/*out*/) {
+    const Instruction &i = window[0];
+    if (i.src.kind != Operand::IMMEDIATE) return 0;
+    switch (i.op) {
+        case Instruction::ADD:
+        case Instruction::SUB:
+        case Instruction::OR:
+        case Instruction::XOR:
+        case Instruction::SHL:
+        case Instruction::SHR:
+        case Instruction::SAR:
+            return i.src.value == 0 ? 1 : 0;
+        case Instruction::IMUL:
+            return i.src.value == 1 ? 1 : 0;
+        default:
+            return 0;
+    }
+}
+
+// imul by a power of two as a shift, and by 0 as a move of 0.
+static size_t multiply_by_shift(const Instruction *window, const size_t &/*count*/, std::vector<Instruction> &out) {
+    const Instruction &i = window[0];
+    if (i.op != Instruction::IMUL || i.src.kind != Operand::IMMEDIATE || i.src.value < 0 || i.src.value == 1) return 0;
+    const int64_t value = i.src.value;
+    if (value == 0) {
+        out.push_back(IRGenerator::Mov(i.dst, Operand::imm(0)));
+        return 1;
+    }
+    if ((value & (value - 1)) != 0) return 0;
+    int shift = 0;
+    while ((int64_t(1) << shift) != value) ++shift;
+    out.push_back(IRGenerator::Shl(i.dst, Operand::imm(shift)));
+    return 1;
+}
+
+// mov a, x then op a, y then mov x, a on a scratch register 'a' that is not
+// read afterwards is op x, y, and mov a, x then op a, y then mov y, a is
+// op y, x when op commutes.
+static size_t in_place(const Instruction *window, const size_t &count, std::vector<Instruction> &out) {
+    if (count < 3) return 0;
+    const Instruction &load = window[0];
+    const Instruction &operation = window[1];
+    const Instruction &store = window[2];
+    if (load.op != Instruction::MOV || !is_scratch(load.dst) || store.op != Instruction::MOV) return 0;
+    if (operation.dst != load.dst || store.src != load.dst || uses(operation.src, load.dst.base)) return 0;
+
+    bool commutes;
+    switch (operation.op) {
+        case Instruction::ADD:
+        case Instruction::AND:
+        case Instruction::OR:
+        case Instruction::XOR:
+        case Instruction::IMUL:
+            commutes = true;
+            break;
+        case Instruction::SUB:
+        case Instruction::SHL:
+        case Instruction::SHR:
+        case Instruction::SAR:
+            commutes = false;
+            break;
+        default:
+            return 0;
+    }
+
+    Operand dst;
+    Operand src;
+    if (store.dst == load.src) {
+        dst = load.src;
+        src = operation.src;
+    } else if (commutes && store.dst == operation.src) {
+        dst = operation.src;
+        src = load.src;
+    } else {
+        return 0;
+    }
+    // imul only multiplies into a register, nothing works on two memory
+    // operands.
+    if (dst.kind == Operand::IMMEDIATE || (operation.op == Instruction::IMUL && dst.kind != Operand::REGISTER)) return 0;
+    if (dst.kind == Operand::MEMORY && src.kind == Operand::MEMORY) return 0;
+    if (!is_dead(load.dst.base, window + 3, count - 3)) return 0;
+    out.push_back(Instruction(operation.op, dst, src));
+    return 3;
+}
+
+// A register written by a move or zeroed by xor, then written again by a
+// move that does not read it before any other instruction reads it.
+static size_t dead_write(const Instruction *window, const size_t &count, std::vector<Instruction> &/*out*/) {
+    if (count < 2) return 0;
+    const Instruction &first = window[0];
+    const Instruction &second = window[1];
+    const bool zeroed = first.op == Instruction::XOR && first.dst.kind == Operand::REGISTER && first.dst == first.src;
+    if ((!is_move(first) && !zeroed) || first.dst.kind != Operand::REGISTER) return 0;
+    if (!is_move(second) || second.dst.kind != Operand::REGISTER || second.dst.base != first.dst.base) return 0;
+    // Dword and qword writes replace the whole register.
+    if (second.dst.size < 4 && second.dst.size < first.dst.size) return 0;
+    if (uses(second.src, first.dst.base)) return 0;
+    return 1;
+}
+
+// mov a, b then mov b, a, the second only puts back what b holds. A dword
+// register written back could be relied on to have its upper half cleared.
+static size_t move_back(const Instruction *window, const size_t &count, std::vector<Instruction> &out) {
+    if (count < 2) return 0;
+    const Instruction &first = window[0];
+    const Instruction &second = window[1];
+    if (first.op != Instruction::MOV || second.op != Instruction::MOV) return 0;
+    if (first.dst != second.src || first.src != second.dst) return 0;
+    if (second.dst.kind == Operand::REGISTER && second.dst.size == 4) return 0;
+    out.push_back(first);
+    return 2;
+}
+
+// A jump to the label right after it.
+static size_t jump_to_next(const Instruction *window, const size_t &count, std::vector<Instruction> &/*out*/) {
+    if (count < 2 || !is_jump(window[0]) || window[1].op != Instruction::LABEL || window[0].dst != window[1].dst) return 0;
+    return 1;
+}
+
+// Instructions between a jmp or ret and the next label are never run.
+static size_t unreachable(const Instruction *window, const size_t &count, std::vector<Instruction> &out) {
+    if (count < 2 || (window[0].op != Instruction::JMP && window[0].op != Instruction::RET) || window[1].op == Instruction::LABEL) return 0;
+    out.push_back(window[0]);
+    return 2;
+}
+
+static constexpr struct {
+    const char *name;
+    Apply apply;
+} rules[] = {
+    {"self move", self_move},
+    {"identity", identity},
+    {"multiply by shift", multiply_by_shift},
+    {"in place", in_place},
+    {"dead write", dead_write},
+    {"move back", move_back},
+    {"jump to next", jump_to_next},
+    {"unreachable", unreachable},
+};
+
+Peephole::Peephole() : hits(std::size(rules), 0) {}
+
+// Every pass goes over the instructions once, trying the rules in table
+// order at each one and moving past what a rule matched.
+void Peephole::run(std::vector<IRGenerator::Instruction> &instructions) {
+    std::vector<Instruction> out;
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        out.clear();
+        out.reserve(instructions.size());
+        for (size_t at = 0; at < instructions.size();) {
+            size_t matched = 0;
+            for (size_t r = 0; r < std::size(rules) && matched == 0; ++r) {
+                matched = rules[r].apply(&instructions[at], instructions.size() - at, out);
+                if (matched > 0) ++hits[r];
+            }
+            if (matched == 0) {
+                out.push_back(instructions[at]);
+                matched = 1;
+            } else {
+                changed = true;
+            }
+            at += matched;
+        }
+        instructions.swap(out);
+    }
+}
+
+void Peephole::log() const {
+    std::cout << " -- Peephole result -- " << '\n';
+    for (size_t r = 0; r < std::size(rules); ++r) {
+        std::cout << rules[r].name << ": " << hits[r] << '\n';
+    }
+    std::cout << '\n';
+}
\ No newline at end of file
@@ -0,0 +1,449 @@
+#include <program/register_allocator.h>
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_set>
+
+// Registers handed out, in the order they are tried: the caller saved ones
+// first, as they need no saving.
+static constexpr Operand::Register preferred[] = {
+    Operand::R8, Operand::R9,
+    Operand::RBX, Operand::RSI, Operand::RDI, Operand::R12, Operand::R13, Operand::R14, Operand::R15,
+};
+static constexpr uint32_t caller_saved = 2;
+static constexpr uint32_t available = sizeof(preferred) / sizeof(preferred[0]);
+
+static int align_by(const int &src, const int &size) {
+    return (src + size - 1) / size * size;
+}
+
+static const bool is_call(const Mir::Inst &inst) {
+    return inst.op == Mir::CALL || inst.op == Mir::PRINT;
+}
+
+// Set of values with constant time insertion, removal and iteration over
+// the members.
+struct LiveSet {
+    LiveSet(const size_t &count) : index(count, Mir::none) {}
+
+    void insert(const uint32_t &value) {
+        if (index[value] != Mir::none) return;
+        index[value] = members.size();
+        members.push_back(value);
+    }
+    void erase(const uint32_t &value) {
+        if (index[value] == Mir::none) return;
+        index[members.back()] = index[value];
+        members[index[value]] = members.back();
+        members.pop_back();
+        index[value] = Mir::none;
+    }
+
+    std::vector<uint32_t> members;
+    std::vector<uint32_t> index;
+};
+
+RegisterAllocator::RegisterAllocator(const Mir::Function &function, const Strategy &strategy) : function(function), strategy(strategy), frame_size(0) {
+    if (strategy == STACK) {
+        // Every value gets a slot of its own, where they are live does not
+        // matter.
+        range_of.assign(function.insts.size(), Mir::none);
+        for (const auto &b : function.order) {
+            for (const auto &i : function.blocks[b].insts) {
+                if (!needs_location(i)) continue;
+                range_of[i] = ranges.size();
+                ranges.push_back({i, 0, 0, 0.0, false});
+            }
+        }
+    } else {
+        compute_liveness();
+        compute_ranges();
+    }
+    assigned.assign(ranges.size(), Operand::NO_REGISTER);
+    if (strategy == LINEAR_SCAN) scan();
+    else if (strategy == GRAPH_COLORING) color();
+    place_spills();
+}
+
+// Each value on its own, walking up from its uses to its definition as SSA
+// allows: every block passed on the way has the value live on entry and its
+// predecessors have it live on exit. The operands of a phi are used at the
+// end of the predecessor they come from rather than in the phi's block. The
+// values are taken in increasing order, so the sets come out sorted.
+void RegisterAllocator::compute_liveness() {
+    const size_t count = function.insts.size();
+    live_in.assign(function.blocks.size(), {});
+    live_out.assign(function.blocks.size(), {});
+
+    std::vector<uint32_t> defined(count, Mir::none);
+    std::vector<uint8_t> reached(function.blocks.size(), 0);
+    for (const auto &b : function.order) {
+        reached[b] = 1;
+        for (const auto &i : function.blocks[b].insts) {
+            defined[i] = b;
+        }
+    }
+
+    // Blocks each value is used in, and the predecessors its phi uses are
+    // at the end of.
+    std::vector<std::vector<uint32_t>> used_in(count);
+    std::vector<std::vector<uint32_t>> used_out(count);
+    const auto use = [&](std::vector<std::vector<uint32_t>> &uses, const uint32_t &value, const uint32_t &b) {
+        if (value == Mir::none || !needs_location(value)) return;
+        if (uses[value].empty() || uses[value].back() != b) uses[value].push_back(b);
+    };
+    for (const auto &b : function.order) {
+        const Mir::Block &block = function.blocks[b];
+        for (const auto &i : block.insts) {
+            const Mir::Inst &inst = function.insts[i];
+            if (inst.op == Mir::PHI) {
+                for (size_t j = 0; j < inst.args.size(); ++j) {
+                    if (reached[block.preds[j]]) use(used_out, inst.args[j], block.preds[j]);
+                }
+                continue;
+            }
+            use(used_in, inst.a, b);
+            use(used_in, inst.b, b);
+            for (const auto &arg : inst.args) {
+                use(used_in, arg, b);
+            }
+        }
+        use(used_in, block.value, b);
+    }
+
+    const auto mark = [](std::vector<uint32_t> &set, const uint32_t &value) {
+        if (!set.empty() && set.back() == value) return false;
+        set.push_back(value);
+        return true;
+    };
+    std::vector<uint32_t> work;
+    for (uint32_t value = 0; value < count; ++value) {
+        if (defined[value] == Mir::none) continue;
+        for (const auto &b : used_out[value]) {
+            if (mark(live_out[b], value) && b != defined[value]) work.push_back(b);
+        }
+        for (const auto &b : used_in[value]) {
+            if (b != defined[value]) work.push_back(b);
+        }
+        while (!work.empty()) {
+            const uint32_t b = work.back();
+            work.pop_back();
+            if (!mark(live_in[b], value)) continue;
+            for (const auto &pred : function.blocks[b].preds) {
+                if (!reached[pred]) continue;
+                if (mark(live_out[pred], value) && pred != defined[value]) work.push_back(pred);
+            }
+        }
+    }
+}
+
+// Numbers the instructions in block order, two apart so the ends of blocks
+// fall between them, and takes the range of a value as everything from its
+// first to its last live position. Phis count as defined at the end of each
+// predecessor, where their copies are made.
+void RegisterAllocator::compute_ranges() {
+    const size_t count = function.insts.size();
+    std::vector<uint32_t> at(count, 0);
+    std::vector<uint32_t> block_start(function.blocks.size(), 0);
+    std::vector<uint32_t> block_end(function.blocks.size(), 0);
+    std::vector<uint32_t> calls;
+    uint32_t position = 0;
+    range_of.assign(count, Mir::none);
+    for (const auto &b : function.order) {
+        block_start[b] = position;
+        position += 2;
+        for (const auto &i : function.blocks[b].insts) {
+            if (function.insts[i].op == Mir::PHI) {
+                at[i] = block_start[b];
+            } else {
+                at[i] = position;
+                position += 2;
+            }
+            if (is_call(function.insts[i])) calls.push_back(at[i]);
+            if (needs_location(i)) {
+                range_of[i] = ranges.size();
+                ranges.push_back({i, at[i], at[i], 0.0, false});
+            }
+        }
+        block_end[b] = position;
+        position += 2;
+    }
+
+    const auto extend = [this](const uint32_t &value, const uint32_t &position, const double &weight) {
+        if (range_of[value] == Mir::none) return;
+        Range &range = ranges[range_of[value]];
+        range.start = std::min(range.start, position);
+        range.end = std::max(range.end, position);
+        range.cost += weight;
+    };
+
+    for (const auto &b : function.order) {
+        const Mir::Block &block = function.blocks[b];
+        const double weight = std::pow(10.0, std::min<uint32_t>(block.depth, 8));
+        for (const auto &i : block.insts) {
+            extend(i, at[i], weight);
+            if (function.insts[i].op == Mir::PHI) continue;
+            const Mir::Inst &inst = function.insts[i];
+            if (inst.a != Mir::none) extend(inst.a, at[i], weight);
+            if (inst.b != Mir::none) extend(inst.b, at[i], weight);
+            for (const auto &arg : inst.args) {
+                if (arg != Mir::none) extend(arg, at[i], weight);
+            }
+        }
+        if (block.value != Mir::none) extend(block.value, block_end[b], weight);
+        for (const auto &succ : block.succs) {
+            const Mir::Block &target = function.blocks[succ];
+            for (size_t j = 0; j < target.preds.size(); ++j) {
+                if (target.preds[j] != b) continue;
+                for (const auto &i : target.insts) {
+                    if (function.insts[i].op != Mir::PHI) break;
+                    extend(i, block_end[b], 0.0);
+                    if (function.insts[i].args[j] != Mir::none) extend(function.insts[i].args[j], block_end[b], weight);
+                }
+            }
+        }
+        for (const auto &value : live_in[b]) {
+            extend(value, block_start[b], 0.0);
+        }
+        for (const auto &value : live_out[b]) {
+            extend(value, block_end[b], 0.0);
+        }
+    }
+
+    for (auto &range : ranges) {
+        const auto call = std::upper_bound(calls.begin(), calls.end(), range.start);
+        range.crosses_call = call != calls.end() && *call < range.end;
+    }
+}
+
+// Linear scan of Poletto and Sarkar: ranges in order of their start take a
+// free register, and when none is left the range with the lowest spill cost
+// per position it covers gives up its register.
+void RegisterAllocator::scan() {
+    std::vector<uint32_t> sorted(ranges.size());
+    for (uint32_t r = 0; r < ranges.size(); ++r) {
+        sorted[r] = r;
+    }
+    std::stable_sort(sorted.begin(), sorted.end(), [this](const uint32_t &a, const uint32_t &b) {
+        return ranges[a].start < ranges[b].start;
+    });
+    const auto weight = [this](const uint32_t &r) {
+        return ranges[r].cost / (ranges[r].end - ranges[r].start + 1);
+    };
+
+    std::vector<uint32_t> active;
+    std::vector<bool> used(Operand::NO_REGISTER, false);
+    for (const auto &r : sorted) {
+        const Range &range = ranges[r];
+        for (size_t k = 0; k < active.size();) {
+            if (ranges[active[k]].end <= range.start) {
+                used[assigned[active[k]]] = false;
+                active[k] = active.back();
+                active.pop_back();
+            } else {
+                ++k;
+            }
+        }
+
+        for (const auto &reg : preferred) {
+            if (used[reg] || !allows(range, reg)) continue;
+            assigned[r] = reg;
+            used[reg] = true;
+            active.push_back(r);
+            break;
+        }
+        if (assigned[r] != Operand::NO_REGISTER) continue;
+
+        size_t victim = active.size();
+        double lowest = weight(r);
+        for (size_t k = 0; k < active.size(); ++k) {
+            if (allows(range, assigned[active[k]]) && weight(active[k]) < lowest) {
+                victim = k;
+                lowest = weight(active[k]);
+            }
+        }
+        if (victim == active.size()) continue;
+        assigned[r] = assigned[active[victim]];
+        assigned[active[victim]] = Operand::NO_REGISTER;
+        active[victim] = r;
+    }
+}
+
+// Chaitin's graph coloring with the optimistic select of Briggs. Values
+// interfere when one is defined while the other is live, found by a walk
+// backwards over each block. Nodes with fewer neighbours than registers
+// are removed first, otherwise the one with the lowest spill cost per
+// neighbour, and the nodes are colored in the reverse order of removal.
+void RegisterAllocator::color() {
+    const size_t count = function.insts.size();
+    std::vector<std::vector<uint32_t>> adjacent(ranges.size());
+    std::unordered_set<uint64_t> edges;
+    const auto interfere = [&](const uint32_t &a, const uint32_t &b) {
+        const uint32_t x = range_of[a];
+        const uint32_t y = range_of[b];
+        if (x == y) return;
+        const uint64_t key = uint64_t(std::min(x, y)) << 32 | std::max(x, y);
+        if (!edges.insert(key).second) return;
+        adjacent[x].push_back(y);
+        adjacent[y].push_back(x);
+    };
+
+    // Calls are found again as well, ranges only cover a call when they hold
+    // it between their ends.
+    for (auto &range : ranges) {
+        range.crosses_call = false;
+    }
+
+    LiveSet live(count);
+    for (const auto &b : function.order) {
+        const Mir::Block &block = function.blocks[b];
+        while (!live.members.empty()) {
+            live.erase(live.members.back());
+        }
+        for (const auto &value : live_out[b]) {
+            live.insert(value);
+        }
+        if (block.value != Mir::none && needs_location(block.value)) live.insert(block.value);
+
+        std::vector<uint32_t> phis;
+        for (auto it = block.insts.rbegin(); it != block.insts.rend(); ++it) {
+            const uint32_t i = *it;
+            const Mir::Inst &inst = function.insts[i];
+            if (inst.op == Mir::PHI) {
+                phis.push_back(i);
+                continue;
+            }
+            if (needs_location(i)) {
+                for (const auto &value : live.members) {
+                    interfere(i, value);
+                }
+                live.erase(i);
+            }
+            if (is_call(inst)) {
+                for (const auto &value : live.members) {
+                    ranges[range_of[value]].crosses_call = true;
+                }
+            }
+            if (inst.a != Mir::none && needs_location(inst.a)) live.insert(inst.a);
+            if (inst.b != Mir::none && needs_location(inst.b)) live.insert(inst.b);
+            for (const auto &arg : inst.args) {
+                if (arg != Mir::none && needs_location(arg)) live.insert(arg);
+            }
+        }
+
+        // The phis are written together at the end of every predecessor.
+        for (const auto &phi : phis) {
+            live.erase(phi);
+        }
+        for (size_t k = 0; k < phis.size(); ++k) {
+            for (const auto &value : live.members) {
+                interfere(phis[k], value);
+            }
+            for (size_t m = k + 1; m < phis.size(); ++m) {
+                interfere(phis[k], phis[m]);
+            }
+        }
+    }
+
+    const auto colors = [this](const uint32_t &r) {
+        return ranges[r].crosses_call ? available - caller_saved : available;
+    };
+    std::vector<uint32_t> degree(ranges.size());
+    std::vector<uint32_t> low;
+    for (uint32_t r = 0; r < ranges.size(); ++r) {
+        degree[r] = adjacent[r].size();
+        if (degree[r] < colors(r)) low.push_back(r);
+    }
+
+    std::vector<bool> removed(ranges.size(), false);
+    std::vector<uint32_t> stack;
+    while (stack.size() < ranges.size()) {
+        uint32_t pick = Mir::none;
+        while (!low.empty() && pick == Mir::none) {
+            if (!removed[low.back()]) pick = low.back();
+            low.pop_back();
+        }
+        if (pick == Mir::none) {
+            double lowest = 0.0;
+            for (uint32_t r = 0; r < ranges.size(); ++r) {
+                if (removed[r]) continue;
+                const double weight = ranges[r].cost / (degree[r] + 1);
+                if (pick == Mir::none || weight < lowest) {
+                    pick = r;
+                    lowest = weight;
+                }
+            }
+        }
+
+        removed[pick] = true;
+        stack.push_back(pick);
+        for (const auto &r : adjacent[pick]) {
+            if (!removed[r] && degree[r]-- == colors(r)) low.push_back(r);
+        }
+    }
+
+    while (!stack.empty()) {
+        const uint32_t r = stack.back();
+        stack.pop_back();
+        std::vector<bool> taken(Operand::NO_REGISTER, false);
+        for (const auto &neighbour : adjacent[r]) {
+            if (assigned[neighbour] != Operand::NO_REGISTER) taken[assigned[neighbour]] = true;
+        }
+        for (const auto &reg : preferred) {
+            if (taken[reg] || !allows(ranges[r], reg)) continue;
+            assigned[r] = reg;
+            break;
+        }
+    }
+}
+
+// Saved registers go first below rbp, then a slot for every spilled value.
+void RegisterAllocator::place_spills() {
+    for (const auto &reg : preferred) {
+        if (reg == Operand::R8 || reg == Operand::R9) continue;
+        if (std::find(assigned.begin(), assigned.end(), reg) != assigned.end()) saved.push_back(reg);
+    }
+    frame_size = saved.size() * 8;
+
+    locations.assign(function.insts.size(), Operand());
+    for (uint32_t r = 0; r < ranges.size(); ++r) {
+        const Mir::Inst &inst = function.insts[ranges[r].value];
+        if (assigned[r] != Operand::NO_REGISTER) {
+            locations[ranges[r].value] = Operand::reg(assigned[r], inst.size);
+        } else {
+            frame_size = align_by(frame_size + inst.size, inst.size);
+            locations[ranges[r].value] = Operand::mem(Operand::RBP, -frame_size, inst.size);
+        }
+    }
+}
+
+const bool RegisterAllocator::needs_location(const uint32_t &value) const {
+    const Mir::Inst &inst = function.insts[value];
+    if (inst.size == 0) return false;
+    switch (inst.op) {
+        case Mir::NOP:
+        case Mir::UNDEF:
+        case Mir::CONST:
+        case Mir::STRING:
+        case Mir::FORMAT:
+            return false;
+        default:
+            return true;
+    }
+}
+
+const bool RegisterAllocator::allows(const Range &range, const Operand::Register &reg) const {
+    return !range.crosses_call || (reg != Operand::R8 && reg != Operand::R9);
+}
+
+const std::vector<Operand>& RegisterAllocator::get_locations() const {
+    return locations;
+}
+
+const std::vector<Operand::Register>& RegisterAllocator::get_saved() const {
+    return saved;
+}
+
+const int& RegisterAllocator::get_frame_size() const {
+    return frame_size;
+}
\ No newline at end of file
@@ -0,0 +1,259 @@
+#include <program/scanner.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(_M_X64))
+#define SCANNER_SIMD
+#include <immintrin.h>
+#endif
+
+static constexpr uint8_t class_of(const int c) {
+    return (c == ' ' || (c >= '\t' && c <= '\r') ? Scanner::SPACE : 0)
+        | ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ? Scanner::ALPHA : 0)
+        | (c >= '0' && c <= '9' ? Scanner::DIGIT : 0)
+        | (c == '_' ? Scanner::UNDERSCORE : 0);
+}
+
+template <size_t... I>
+static constexpr std::array<uint8_t, sizeof...(I)> make_classes(std::index_sequence<I...>) {
+    return {{class_of(static_cast<int>(I))...}};
+}
+
+const std::array<uint8_t, 256> Scanner::classes = make_classes(std::make_index_sequence<256>{});
+
+// Scalar implementations, also used for the tails the vector paths leave over.
+
+static size_t scalar_skip_whitespace(const char *raw, size_t i, const size_t length) {
+    while (i < length && Scanner::is_space(raw[i])) ++i;
+    return i;
+}
+
+static size_t scalar_skip_identifier(const char *raw, size_t i, const size_t length) {
+    while (i < length && Scanner::is_identifier(raw[i])) ++i;
+    return i;
+}
+
+static size_t scalar_skip_digits(const char *raw, size_t i, const size_t length) {
+    while (i < length && Scanner::is_digit(raw[i])) ++i;
+    return i;
+}
+
+static size_t scalar_find_char(const char *raw, size_t i, const size_t length, const char c) {
+    while (i < length && raw[i] != c) ++i;
+    return i;
+}
+
+static size_t scalar_find_block_end(const char *raw, size_t i, const size_t length) {
+    for (; i + 1 < length; ++i) {
+        if (raw[i] == '*' && raw[i + 1] == '/') return i;
+    }
+    return length;
+}
+
+#ifdef SCANNER_SIMD
+// Bytes in [lo, hi] are found with a signed compare after biasing lo to -128,
+// SSE2 and AVX2 have no unsigned byte compares.
+
+static inline __m128i sse2_in_range(const __m128i &v, const char lo, const char hi) {
+    const __m128i biased = _mm_add_epi8(v, _mm_set1_epi8(static_cast<char>(0x80 - lo)));
+    return _mm_cmplt_epi8(biased, _mm_set1_epi8(static_cast<char>(-128 + (hi - lo) + 1)));
+}
+
+static inline uint32_t sse2_space_mask(const __m128i &v) {
+    return _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')), sse2_in_range(v, '\t', '\r')));
+}
+
+static inline uint32_t sse2_identifier_mask(const __m128i &v) {
+    const __m128i alpha = sse2_in_range(_mm_or_si128(v, _mm_set1_epi8(0x20)), 'a', 'z');
+    const __m128i digit = sse2_in_range(v, '0', '9');
+    const __m128i underscore = _mm_cmpeq_epi8(v, _mm_set1_epi8('_'));
+    return _mm_movemask_epi8(_mm_or_si128(_mm_or_si128(alpha, digit), underscore));
+}
+
+static size_t sse2_skip_whitespace(const char *raw, size_t i, const size_t length) {
+    for (; i + 16 <= length; i += 16) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(raw + i));
+        const uint32_t stop = ~sse2_space_mask(v) & 0xFFFF;
+        if (stop) return i + __builtin_ctz(stop);
+    }
+    return scalar_skip_whitespace(raw, i, length);
+}
+
+static size_t sse2_skip_identifier(const char *raw, size_t i, const size_t length) {
+    for (; i + 16 <= length; i += 16) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(raw + i));
+        const uint32_t stop = ~sse2_identifier_mask(v) & 0xFFFF;
+        if (stop) return i + __builtin_ctz(stop);
+    }
+    return scalar_skip_identifier(raw, i, length);
+}
+
+static size_t sse2_skip_digits(const char *raw, size_t i, const size_t length) {
+    for (; i + 16 <= length; i += 16) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(raw + i));
+        const uint32_t stop = ~_mm_movemask_epi8(sse2_in_range(v, '0', '9')) & 0xFFFF;
+        if (stop) return i + __builtin_ctz(stop);
+    }
+    return scalar_skip_digits(raw, i, length);
+}
+
+static size_t sse2_find_char(const char *raw, size_t i, const size_t length, const char c) {
+    const __m128i target = _mm_set1_epi8(c);
+    for (; i + 16 <= length; i += 16) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(raw + i));
+        const uint32_t found = _mm_movemask_epi8(_mm_cmpeq_epi8(v, target));
+        if (found) return i + __builtin_ctz(found);
+    }
+    return scalar_find_char(raw, i, length, c);
+}
+
+static size_t sse2_find_block_end(const char *raw, size_t i, const size_t length) {
+    for (; i + 17 <= length; i += 16) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(raw + i));
+        const __m128i next = _mm_loadu_si128(reinterpret_cast<const __m128i*>(raw + i + 1));
+        const uint32_t found = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('*')), _mm_cmpeq_epi8(next, _mm_set1_epi8('/'))));
+        if (found) return i + __builtin_ctz(found);
+    }
+    return scalar_find_block_end(raw, i, length);
+}
+
+#define SCANNER_AVX2 __attribute__((target("avx2")))
+
+SCANNER_AVX2 static inline __m256i avx2_in_range(const __m256i &v, const char lo, const char hi) {
+    const __m256i biased = _mm256_add_epi8(v, _mm256_set1_epi8(static_cast<char>(0x80 - lo)));
+    return _mm256_cmpgt_epi8(_mm256_set1_epi8(static_cast<char>(-128 + (hi - lo) + 1)), biased);
+}
+
+SCANNER_AVX2 static inline uint32_t avx2_space_mask(const __m256i &v) {
+    return _mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')), avx2_in_range(v, '\t', '\r')));
+}
+
+SCANNER_AVX2 static inline uint32_t avx2_identifier_mask(const __m256i &v) {
+    const __m256i alpha = avx2_in_range(_mm256_or_si256(v, _mm256_set1_epi8(0x20)), 'a', 'z');
+    const __m256i digit = avx2_in_range(v, '0', '9');
+    const __m256i underscore = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('_'));
+    return _mm256_movemask_epi8(_mm256_or_si256(_mm256_or_si256(alpha, digit), underscore));
+}
+
+SCANNER_AVX2 static size_t avx2_skip_whitespace(const char *raw, size_t i, const size_t length) {
+    for (; i + 32 <= length; i += 32) {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(raw + i));
+        const uint32_t stop = ~avx2_space_mask(v);
+        if (stop) return i + __builtin_ctz(stop);
+    }
+    return sse2_skip_whitespace(raw, i, length);
+}
+
+SCANNER_AVX2 static size_t avx2_skip_identifier(const char *raw, size_t i, const size_t length) {
+    for (; i + 32 <= length; i += 32) {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(raw + i));
+        const uint32_t stop = ~avx2_identifier_mask(v);
+        if (stop) return i + __builtin_ctz(stop);
+    }
+    return sse2_skip_identifier(raw, i, length);
+}
+
+SCANNER_AVX2 static size_t avx2_skip_digits(const char *raw, size_t i, const size_t length) {
+    for (; i + 32 <= length; i += 32) {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(raw + i));
+        const uint32_t stop = ~static_cast<uint32_t>(_mm256_movemask_epi8(avx2_in_range(v, '0', '9')));
+        if (stop) return i + __builtin_ctz(stop);
+    }
+    return sse2_skip_digits(raw, i, length);
+}
+
+SCANNER_AVX2 static size_t avx2_find_char(const char *raw, size_t i, const size_t length, const char c) {
+    const __m256i target = _mm256_set1_epi8(c);
+    for (; i + 32 <= length; i += 32) {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(raw + i));
+        const uint32_t found = _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, target));
+        if (found) return i + __builtin_ctz(found);
+    }
+    return sse2_find_char(raw, i, length, c);
+}
+
+SCANNER_AVX2 static size_t avx2_find_block_end(const char *raw, size_t i, const size_t length) {
+    for (; i + 33 <= length; i += 32) {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(raw + i));
+        const __m256i next = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(raw + i + 1));
+        const uint32_t found = _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('*')), _mm256_cmpeq_epi8(next, _mm256_set1_epi8('/'))));
+        if (found) return i + __builtin_ctz(found);
+    }
+    return sse2_find_block_end(raw, i, length);
+}
+#endif
+
+Scanner::Table Scanner::table = {
+    scalar_skip_whitespace,
+    scalar_skip_identifier,
+    scalar_skip_digits,
+    scalar_find_char,
+    scalar_find_block_end,
+};
+
+Scanner::Backend Scanner::backend = Scanner::detect();
+
+Scanner::Backend Scanner::detect() {
+#ifdef SCANNER_SIMD
+    __builtin_cpu_init();
+    const Backend best = __builtin_cpu_supports("avx2") ? AVX2 : SSE2;
+#else
+    const Backend best = SCALAR;
+#endif
+    backend = SCALAR;
+    set_backend(best);
+    return backend;
+}
+
+bool Scanner::is_supported(const Backend &backend) {
+    switch (backend) {
+        case SCALAR: return true;
+#ifdef SCANNER_SIMD
+        case SSE2: return true;
+        case AVX2: return __builtin_cpu_supports("avx2");
+#endif
+        default: return false;
+    }
+}
+
+bool Scanner::set_backend(const Backend &target) {
+    if (!is_supported(target)) return false;
+
+    switch (target) {
+        case SCALAR:
+            table = { scalar_skip_whitespace, scalar_skip_identifier, scalar_skip_digits, scalar_find_char, scalar_find_block_end };
+            break;
+#ifdef SCANNER_SIMD
+        case SSE2:
+            table = { sse2_skip_whitespace, sse2_skip_identifier, sse2_skip_digits, sse2_find_char, sse2_find_block_end };
+            break;
+        case AVX2:
+            table = { avx2_skip_whitespace, avx2_skip_identifier, avx2_skip_digits, avx2_find_char, avx2_find_block_end };
+            break;
+#endif
+        default:
+            return false;
+    }
+
+    backend = target;
+    return true;
+}
+
+Scanner::Backend Scanner::get_backend() {
+    return backend;
+}
+
+const std::vector<Scanner::Backend> Scanner::get_supported() {
+    std::vector<Backend> supported;
+    for (const auto &b : {SCALAR, SSE2, AVX2}) {
+        if (is_supported(b)) supported.push_back(b);
+    }
+    return supported;
+}
+
+const char* Scanner::get_name(const Backend &backend) {
+    switch (backend) {
+        case SCALAR: return "scalar";
+        case SSE2: return "sse2";
+        case AVX2: return "avx2";
+    }
+    return "unknown";
+}
\ No newline at end of file
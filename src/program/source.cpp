@@ -1,29 +1,185 @@
 #include <program/source.h>
 
+#include <algorithm>
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 Source::Source(const std::string &fp) {
     success = false;
-    read_source(fp);
-}
-
-void Source::read_source(const std::string &fp) {
-    std::ifstream file(fp);
+    mode = BUFFERED;
+    data = nullptr;
+    length = 0;
+    released = 0;
+#ifdef _WIN32
+    file = INVALID_HANDLE_VALUE;
+    mapping = nullptr;
+#else
+    fd = -1;
+#endif
 
-    if (file.is_open()) {
+    if (fp != "-" && map_source(fp)) {
         success = true;
-    } else {
-        std::cerr << "Failed to open file '" << fp << "'" << '\n';
         return;
     }
+    read_source(fp);
+}
 
+Source::~Source() {
+    unmap_source();
+}
+
+// Fallback for anything that cannot be mapped: stdin, pipes, character
+// devices and empty files.
+void Source::read_source(const std::string &fp) {
     std::ostringstream ss;
-    ss << file.rdbuf();
+    if (fp == "-") {
+        ss << std::cin.rdbuf();
+    } else {
+        std::ifstream file(fp, std::ios::binary);
+
+        if (!file.is_open()) {
+            std::cerr << "Failed to open file '" << fp << "'" << '\n';
+            return;
+        }
+
+        ss << file.rdbuf();
+        file.close();
+    }
 
-    file.close();
+    success = true;
+    mode = BUFFERED;
     raw = ss.str();
+    data = raw.data();
+    length = raw.length();
+}
+
+#ifdef _WIN32
+bool Source::map_source(const std::string &fp) {
+    file = CreateFileA(fp.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER size;
+    if (GetFileType(file) != FILE_TYPE_DISK || !GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+        unmap_source();
+        return false;
+    }
+
+    mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping == nullptr) {
+        unmap_source();
+        return false;
+    }
+
+    data = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    if (data == nullptr) {
+        unmap_source();
+        return false;
+    }
+
+    length = static_cast<size_t>(size.QuadPart);
+    mode = length >= stream_threshold ? STREAMED : MAPPED;
+    return true;
+}
+
+void Source::unmap_source() {
+    if (mode != BUFFERED && data != nullptr) UnmapViewOfFile(data);
+    if (mapping != nullptr) CloseHandle(mapping);
+    if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+    mapping = nullptr;
+    file = INVALID_HANDLE_VALUE;
+    if (mode != BUFFERED) data = nullptr;
+}
+#else
+bool Source::map_source(const std::string &fp) {
+    fd = open(fp.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+        unmap_source();
+        return false;
+    }
+
+    length = static_cast<size_t>(st.st_size);
+    void *view = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (view == MAP_FAILED) {
+        length = 0;
+        unmap_source();
+        return false;
+    }
+
+    data = static_cast<const char*>(view);
+    mode = length >= stream_threshold ? STREAMED : MAPPED;
+    madvise(view, length, mode == STREAMED ? MADV_SEQUENTIAL : MADV_WILLNEED);
+    return true;
+}
+
+void Source::unmap_source() {
+    if (mode != BUFFERED && data != nullptr) munmap(const_cast<char*>(data), length);
+    if (fd >= 0) close(fd);
+    fd = -1;
+    if (mode != BUFFERED) data = nullptr;
+}
+#endif
+
+// Streamed sources drop the whole pages below 'offset' from memory, other
+// modes keep everything resident and ignore this.
+void Source::release(const size_t &offset) const {
+    if (mode != STREAMED) return;
+
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    const size_t page = info.dwPageSize;
+#else
+    const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+
+    const size_t end = std::min(offset, length) / page * page;
+    if (end <= released) return;
+
+#ifdef _WIN32
+    // Unlocking pages that are not locked removes them from the working set.
+    VirtualUnlock(const_cast<char*>(data) + released, end - released);
+#else
+    madvise(const_cast<char*>(data) + released, end - released, MADV_DONTNEED);
+#endif
+    released = end;
+}
+
+// Replaces 'removed' bytes at 'offset' with 'text'. Mapped sources are copied
+// into a buffer on the first edit, the file itself is never written.
+void Source::replace(const size_t &offset, const size_t &removed, const std::string_view &text) {
+    if (offset > length) throw std::runtime_error("Edit at " + std::to_string(offset) + " is past the end of the source.");
+
+    if (mode != BUFFERED) {
+        std::string copy(data, length);
+        unmap_source();
+        mode = BUFFERED;
+        raw = std::move(copy);
+    }
+
+    raw.replace(offset, std::min(removed, length - offset), text);
+    data = raw.data();
+    length = raw.length();
+}
+
+const std::string_view Source::get() const {
+    return std::string_view(data == nullptr ? "" : data, length);
 }
 
-const std::string& Source::get() const {
-    return raw;
+const Source::Mode& Source::get_mode() const {
+    return mode;
 }
 
 const bool& Source::get_success() const {
@@ -0,0 +1,84 @@
+#include <program/thread_pool.h>
+
+// A worker count of 0 uses one thread per hardware thread.
+ThreadPool::ThreadPool(const size_t &workers) : workers(workers), task(nullptr), tasks(0), next(0), batch(0), busy(0), error(nullptr), stopping(false) {
+    if (this->workers == 0) this->workers = std::max(1u, std::thread::hardware_concurrency());
+    for (size_t i = 1; i < this->workers; ++i) {
+        threads.emplace_back(&ThreadPool::work, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        const std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto &thread : threads) {
+        thread.join();
+    }
+}
+
+const size_t& ThreadPool::get_workers() const {
+    return workers;
+}
+
+void ThreadPool::run(const size_t &tasks, const std::function<void(const size_t&)> &task) const {
+    if (tasks == 0) return;
+
+    const std::lock_guard<std::mutex> batch_lock(batch_mutex);
+    {
+        const std::lock_guard<std::mutex> lock(mutex);
+        this->task = &task;
+        this->tasks = tasks;
+        next = 0;
+        error = nullptr;
+        busy = threads.size();
+        ++batch;
+    }
+    wake.notify_all();
+
+    drain();
+
+    std::exception_ptr failure;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this]() { return busy == 0; });
+        this->task = nullptr;
+        failure = error;
+        error = nullptr;
+    }
+
+    if (failure) std::rethrow_exception(failure);
+}
+
+// Worker loop: sleeps until a new batch starts or the pool is destroyed.
+void ThreadPool::work() const {
+    size_t seen = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&]() { return stopping || batch != seen; });
+            if (stopping) return;
+            seen = batch;
+        }
+
+        drain();
+
+        const std::lock_guard<std::mutex> lock(mutex);
+        if (--busy == 0) done.notify_one();
+    }
+}
+
+// Runs tasks of the current batch until none are left.
+void ThreadPool::drain() const {
+    for (size_t i = next++; i < tasks; i = next++) {
+        try {
+            (*task)(i);
+        } catch (...) {
+            const std::lock_guard<std::mutex> lock(mutex);
+            if (!error) error = std::current_exception();
+            next = tasks;
+        }
+    }
+}
\ No newline at end of file
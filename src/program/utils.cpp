@@ -69,6 +69,24 @@ const std::string Utils::src_id_to_path(const std::string &id) {
     return path;
 }
 
+// Worker threads from "detail.worker", 0 or a missing entry leaves the choice
+// to the hardware.
+const size_t Utils::get_workers() {
+    const int workers = project["detail"].value("worker", 0);
+    return workers > 0 ? workers : 0;
+}
+
+// Optimization level from "detail.optimization", 1 when missing.
+const int Utils::get_optimization() {
+    return project["detail"].value("optimization", 1);
+}
+
+// Compiler version from the bundled "los.json", read once.
+const std::string& Utils::get_version() {
+    static const std::string version = read_json("src/resources/los.json", false)["los"]["version"].get<std::string>();
+    return version;
+}
+
 const std::string Utils::capitalize(const std::string &value) {
     std::string capitalized = "";
     bool should_capitalize = true;